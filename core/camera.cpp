@@ -54,6 +54,12 @@ void Camera::setOffsetPx(double x, double y) {
     offsetPx_.y = y;
 }
 
+void Camera::setState(double zoomExp, const Vec2& offsetPx, const Vec2& worldCenter) {
+    zoomExp_ = std::clamp(zoomExp, kMinZoomExp, kMaxZoomExp);
+    offsetPx_ = offsetPx;
+    worldCenter_ = worldCenter;
+}
+
 bool Camera::needsRecenter() const {
     const double threshold = 1e6;
     return std::fabs(worldCenter_.x) > threshold || std::fabs(worldCenter_.y) > threshold;
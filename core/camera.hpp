@@ -9,6 +9,8 @@ public:
     void zoomAt(double screenX, double screenY, double deltaExp);
     void panPx(double dx, double dy);
     void setOffsetPx(double x, double y);
+    // Restores a state captured with zoomExp()/offsetPx()/worldCenter().
+    void setState(double zoomExp, const Vec2& offsetPx, const Vec2& worldCenter);
 
     double scale() const { return std::exp2(zoomExp_); }
     double zoomExp() const { return zoomExp_; }
@@ -22,6 +24,8 @@ public:
     bool needsRecenter() const;
     void shiftWorldCenter(const Vec2& delta);
 
+    bool operator==(const Camera& o) const = default;
+
 private:
     double zoomExp_{0.0};
     Vec2   offsetPx_{0.0, 0.0};
@@ -0,0 +1,122 @@
+#include "element_store.hpp"
+#include <algorithm>
+#include <cmath>
+
+ElementStore::Id ElementStore::addShape(const Shape& shape, const ElementStyle& style, std::uint32_t z) {
+    const std::uint32_t slot = takeSlot(freeShapes_, shapes_.size());
+    if (slot == shapes_.size()) shapes_.push_back(shape); else shapes_[slot] = shape;
+    const Rect box = shape.bounds().inflated(std::exp2(style.strokeWidthExp) * 0.5);
+    return appendRow(ElementKind::Shape, slot, box, z, internStyle(style));
+}
+
+ElementStore::Id ElementStore::addImage(const ImageElement& image, std::uint32_t z) {
+    const std::uint32_t slot = takeSlot(freeImages_, images_.size());
+    if (slot == images_.size()) images_.push_back(image); else images_[slot] = image;
+    return appendRow(ElementKind::Image, slot, image.bounds(), z, internStyle(ElementStyle{}));
+}
+
+ElementStore::Id ElementStore::addText(const TextElement& text, std::uint32_t z) {
+    const std::uint32_t slot = takeSlot(freeTexts_, texts_.size());
+    if (slot == texts_.size()) texts_.push_back(text); else texts_[slot] = text;
+    return appendRow(ElementKind::Text, slot, text.bounds(), z, internStyle(ElementStyle{}));
+}
+
+bool ElementStore::remove(Id id) {
+    const auto found = rowOf_.find(id);
+    if (found == rowOf_.end()) return false;
+    const std::uint32_t row = found->second;
+    rowOf_.erase(found);
+
+    switch (kind_[row]) {
+    case ElementKind::Shape: freeShapes_.push_back(slot_[row]); break;
+    case ElementKind::Image: freeImages_.push_back(slot_[row]); break;
+    case ElementKind::Text:
+        freeTexts_.push_back(slot_[row]);
+        texts_[slot_[row]] = TextElement{}; // release the strings
+        break;
+    }
+
+    // Stable erase keeps draw order; removal is rare next to drawing.
+    const auto at = [row](auto& column) { column.erase(column.begin() + row); };
+    at(kind_);
+    at(slot_);
+    at(bounds_);
+    at(z_);
+    at(style_);
+    at(id_);
+    for (std::uint32_t r = row; r < id_.size(); ++r) rowOf_[id_[r]] = r;
+    ++revision_;
+    return true;
+}
+
+void ElementStore::translate(const Vec2& delta) {
+    if (delta.x == 0.0 && delta.y == 0.0) return;
+    const Vec2 shift{-delta.x, -delta.y};
+    for (Rect& box : bounds_) box = box.translated(shift);
+    for (Shape& s : shapes_) s.pos += shift;
+    for (ImageElement& im : images_) im.pos += shift;
+    for (TextElement& t : texts_) t.pos += shift;
+    ++revision_;
+}
+
+void ElementStore::query(const Rect& worldRect, std::vector<std::uint32_t>& out) const {
+    const std::size_t n = bounds_.size();
+    for (std::size_t r = 0; r < n; ++r) {
+        if (bounds_[r].intersects(worldRect)) out.push_back(static_cast<std::uint32_t>(r));
+    }
+}
+
+std::uint32_t ElementStore::internStyle(const ElementStyle& style) {
+    // Boards use a handful of styles; a scan beats hashing doubles.
+    const auto found = std::find(styles_.begin(), styles_.end(), style);
+    if (found != styles_.end()) return static_cast<std::uint32_t>(found - styles_.begin());
+    styles_.push_back(style);
+    return static_cast<std::uint32_t>(styles_.size() - 1);
+}
+
+std::uint32_t ElementStore::takeSlot(std::vector<std::uint32_t>& freeList, std::size_t arraySize) {
+    if (freeList.empty()) return static_cast<std::uint32_t>(arraySize);
+    const std::uint32_t slot = freeList.back();
+    freeList.pop_back();
+    return slot;
+}
+
+ElementStore::Id ElementStore::appendRow(ElementKind kind, std::uint32_t slot, const Rect& bounds,
+                                         std::uint32_t z, std::uint32_t style) {
+    // Keep rows sorted by z; new elements normally go last.
+    auto pos = static_cast<std::size_t>(std::upper_bound(z_.begin(), z_.end(), z) - z_.begin());
+    const Id id = nextId_++;
+    const auto insert = [pos](auto& column, auto value) { column.insert(column.begin() + pos, value); };
+    insert(kind_, kind);
+    insert(slot_, slot);
+    insert(bounds_, bounds);
+    insert(z_, z);
+    insert(style_, style);
+    insert(id_, id);
+    for (std::size_t r = pos; r < id_.size(); ++r) rowOf_[id_[r]] = static_cast<std::uint32_t>(r);
+    ++revision_;
+    return id;
+}
+
+MemoryUsage ElementStore::memoryUsage() const {
+    MemoryUsage u;
+    u.addVector(kind_);
+    u.addVector(slot_);
+    u.addVector(bounds_);
+    u.addVector(z_);
+    u.addVector(style_);
+    u.addVector(id_);
+    u.addMap(rowOf_);
+    u.addVector(styles_);
+    u.addVector(shapes_);
+    u.addVector(freeShapes_);
+    u.addVector(images_);
+    u.addVector(freeImages_);
+    u.addVector(texts_);
+    u.addVector(freeTexts_);
+    for (const TextElement& t : texts_) {
+        u.addString(t.text);
+        u.addString(t.family);
+    }
+    return u;
+}
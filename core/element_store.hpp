@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "elements/element.hpp"
+#include "memory_usage.hpp"
+
+// Non-stroke elements in data-oriented form. Each kind lives in its own
+// contiguous typed array; the columns below are shared by all kinds and
+// indexed by row. Rows are kept in draw order, so culling is one linear
+// pass over the bounds column and drawing walks runs of one kind with no
+// per-element dispatch.
+//
+// Elements interleave with strokes through z: a row draws after strokes
+// [0, z) and before the rest. Scene stamps new elements with its stroke
+// count, so they land on top, and rows stay sorted by z.
+class ElementStore {
+public:
+    using Id = std::uint32_t;
+
+    Id addShape(const Shape& shape, const ElementStyle& style, std::uint32_t z);
+    Id addImage(const ImageElement& image, std::uint32_t z);
+    Id addText(const TextElement& text, std::uint32_t z);
+    bool remove(Id id);
+    void translate(const Vec2& delta);
+
+    std::size_t size() const { return kind_.size(); }
+    std::uint64_t revision() const { return revision_; }
+
+    // Rows whose bounds intersect worldRect, in draw order.
+    void query(const Rect& worldRect, std::vector<std::uint32_t>& out) const;
+
+    // Columns, indexed by row.
+    ElementKind kind(std::uint32_t row) const { return kind_[row]; }
+    std::uint32_t slot(std::uint32_t row) const { return slot_[row]; }
+    const Rect& bounds(std::uint32_t row) const { return bounds_[row]; }
+    std::uint32_t z(std::uint32_t row) const { return z_[row]; }
+    const ElementStyle& style(std::uint32_t row) const { return styles_[style_[row]]; }
+    Id id(std::uint32_t row) const { return id_[row]; }
+
+    // Typed arrays, indexed by slot.
+    const std::vector<Shape>& shapes() const { return shapes_; }
+    const std::vector<ImageElement>& images() const { return images_; }
+    const std::vector<TextElement>& texts() const { return texts_; }
+
+    MemoryUsage memoryUsage() const;
+
+private:
+    std::uint32_t internStyle(const ElementStyle& style);
+    std::uint32_t takeSlot(std::vector<std::uint32_t>& freeList, std::size_t arraySize);
+    Id appendRow(ElementKind kind, std::uint32_t slot, const Rect& bounds, std::uint32_t z, std::uint32_t style);
+
+    std::vector<ElementKind> kind_;
+    std::vector<std::uint32_t> slot_;
+    std::vector<Rect> bounds_;
+    std::vector<std::uint32_t> z_;
+    std::vector<std::uint32_t> style_;
+    std::vector<Id> id_;
+    std::unordered_map<Id, std::uint32_t> rowOf_;
+    Id nextId_ = 1;
+    std::uint64_t revision_ = 0;
+
+    std::vector<ElementStyle> styles_;
+
+    std::vector<Shape> shapes_;
+    std::vector<std::uint32_t> freeShapes_;
+    std::vector<ImageElement> images_;
+    std::vector<std::uint32_t> freeImages_;
+    std::vector<TextElement> texts_;
+    std::vector<std::uint32_t> freeTexts_;
+};
@@ -1,8 +1,51 @@
 #pragma once
+#include <cstdint>
+#include <string>
 #include "../types.hpp"
 
 struct Element {
     // базовая «тупая» сущность: позиция/размер в world, без знания масштаба
     Vec2 pos{0,0};
     Vec2 size{0,0};
+
+    Rect bounds() const { return Rect(pos.x, pos.y, pos.x + size.x, pos.y + size.y); }
+};
+
+// Element kinds kept by ElementStore, one typed array each.
+enum class ElementKind : std::uint8_t {
+    Shape = 0,
+    Image = 1,
+    Text = 2,
+};
+inline constexpr std::size_t kElementKindCount = 3;
+
+struct Shape : Element {
+    enum class Kind : std::uint8_t { Rect, Ellipse, Line };
+    Kind kind = Kind::Rect; // Line runs from pos to pos + size
+};
+
+// A raster placed on the board. Pixels live outside the scene, in a tiled
+// pyramid keyed by imageId; pos/size give the placement in world units.
+struct ImageElement : Element {
+    std::uint64_t imageId = 0;
+    std::uint32_t pixelWidth = 0;
+    std::uint32_t pixelHeight = 0;
+};
+
+// A text label. size is its layout box in world units, measured by the UI
+// when the label is placed; lines are separated by '\n'.
+struct TextElement : Element {
+    std::string text;          // UTF-8
+    std::string family;        // empty = application font
+    double fontSizeExp = 0.0;  // log2(em size in world units)
+    std::uint32_t colorRGB = 0xE6E6E6;
+};
+
+// Shared by every element kind; stored once per distinct value.
+struct ElementStyle {
+    std::uint32_t strokeRGB = 0xE6E6E6;
+    std::uint32_t fillRGB = 0x000000;
+    double strokeWidthExp = 0.0; // log2(width_world)
+    bool filled = false;
+    bool operator==(const ElementStyle&) const = default;
 };
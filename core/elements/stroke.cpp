@@ -1,6 +1,9 @@
 #include "stroke.hpp"
 #include "../camera.hpp"
+#include "../memory_usage.hpp"
+#include "../point_codec.hpp"
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <limits>
 
@@ -12,6 +15,63 @@ constexpr double kMaxWorldExp = 60.0;
 constexpr double kMinScreenExp = -24.0;
 constexpr double kMaxScreenExp = 12.0;
 constexpr double kMinBrushPx = 1e-12;
+constexpr int    kColdQuantumBits = 8;
+// LOD tolerances as fractions of the stroke extent, finest first. A level is
+// kept only if it has at most half the points of the previous one.
+constexpr double kLodFractions[] = {1.0 / 1024.0, 1.0 / 128.0, 1.0 / 16.0};
+constexpr std::size_t kMinLodPoints = 32;
+
+std::atomic<std::uint64_t> nextRevision{1};
+std::atomic<std::uint64_t> nextId{1};
+
+double segmentDistance(const Vec2& p, const Vec2& a, const Vec2& b) {
+    const double dx = b.x - a.x;
+    const double dy = b.y - a.y;
+    const double len2 = dx * dx + dy * dy;
+    double t = len2 > 0.0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / len2 : 0.0;
+    t = std::clamp(t, 0.0, 1.0);
+    const double ex = a.x + t * dx - p.x;
+    const double ey = a.y + t * dy - p.y;
+    return std::sqrt(ex * ex + ey * ey);
+}
+
+// Douglas-Peucker with an explicit stack.
+void simplify(const std::vector<Vec2>& in, double tol, std::vector<Vec2>& out) {
+    out.clear();
+    if (in.size() < 3) {
+        out = in;
+        return;
+    }
+    std::vector<bool> keep(in.size(), false);
+    keep.front() = keep.back() = true;
+    std::vector<std::pair<std::size_t, std::size_t>> stack{{0, in.size() - 1}};
+    while (!stack.empty()) {
+        const auto [a, b] = stack.back();
+        stack.pop_back();
+        double worst = 0.0;
+        std::size_t split = a;
+        for (std::size_t i = a + 1; i < b; ++i) {
+            const double d = segmentDistance(in[i], in[a], in[b]);
+            if (d > worst) { worst = d; split = i; }
+        }
+        if (worst > tol) {
+            keep[split] = true;
+            stack.push_back({a, split});
+            stack.push_back({split, b});
+        }
+    }
+    for (std::size_t i = 0; i < in.size(); ++i) {
+        if (keep[i]) out.push_back(in[i]);
+    }
+}
+}
+
+std::uint64_t Stroke::newId() {
+    return nextId.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Stroke::touch() {
+    revision_ = nextRevision.fetch_add(1, std::memory_order_relaxed);
 }
 
 static inline double hypot2(double dx, double dy){ return std::sqrt(dx*dx + dy*dy); }
@@ -20,14 +80,33 @@ void Stroke::begin(double brushPx, std::uint32_t colorRGB, const Camera& cam) {
     const double safePx = std::max(brushPx, kMinBrushPx);
     widthExp_ = std::clamp(std::log2(safePx) - cam.zoomExp(), kMinWorldExp, kMaxWorldExp);
     points_.clear();
+    bounds_ = Rect{};
+    lod_.clear();
     colorRGB_ = colorRGB;
+    touch();
+}
+
+void Stroke::beginWorld(double widthExp, std::uint32_t colorRGB) {
+    widthExp_ = std::clamp(widthExp, kMinWorldExp, kMaxWorldExp);
+    points_.clear();
+    bounds_ = Rect{};
+    lod_.clear();
+    colorRGB_ = colorRGB;
+    touch();
+}
+
+void Stroke::setBrush(BrushKind brush) {
+    if (brush == brush_) return;
+    brush_ = brush;
+    touch();
 }
 
 void Stroke::addScreenPoint(double sx, double sy, const Camera& cam, double minStepPx) {
+    if (cold_) thaw();
     Vec2 w = cam.worldFromScreen(sx, sy);
 
     if (points_.empty()) {
-        points_.push_back(w);
+        addWorldPoint(w);
         return;
     }
 
@@ -36,20 +115,86 @@ void Stroke::addScreenPoint(double sx, double sy, const Camera& cam, double minS
     double dx = sx - lastS.x;
     double dy = sy - lastS.y;
     if (hypot2(dx, dy) >= minStepPx) {
-        points_.push_back(w);
+        addWorldPoint(w);
+    }
+}
+
+void Stroke::addWorldPoint(const Vec2& w) {
+    if (cold_) thaw();
+    if (!lod_.empty()) lod_.clear();
+    points_.push_back(w);
+    bounds_.expand(w);
+    touch();
+}
+
+void Stroke::assignWorld(double widthExp, std::uint32_t colorRGB, std::vector<Vec2>&& points) {
+    beginWorld(widthExp, colorRGB);
+    cold_ = false;
+    std::vector<std::uint8_t>().swap(packed_);
+    points_ = std::move(points);
+    for (const Vec2& w : points_) bounds_.expand(w);
+    touch();
+}
+
+void Stroke::buildLod() {
+    lod_.clear();
+    touch();
+    thaw();
+    const auto& pts = points_;
+    if (pts.size() < kMinLodPoints) return;
+
+    const double extent = std::max(bounds_.width(), bounds_.height());
+    const std::vector<Vec2>* source = &pts;
+    double carried = 0.0; // error already in the source level
+    std::vector<Vec2> simplified;
+    lod_.reserve(std::size(kLodFractions)); // source points into lod_
+    for (double fraction : kLodFractions) {
+        const double tol = extent * fraction;
+        simplify(*source, tol, simplified);
+        if (simplified.size() * 2 > source->size()) continue;
+        carried += tol;
+        lod_.push_back(LodLevel{carried, std::move(simplified)});
+        source = &lod_.back().points;
+        simplified = {};
     }
 }
 
-void Stroke::finish() {
-    if (points_.size() < 2) points_.clear();
+const std::vector<Vec2>* Stroke::lodFor(double worldTol) const {
+    const std::vector<Vec2>* best = nullptr;
+    for (const LodLevel& level : lod_) {
+        if (level.tolerance > worldTol) break;
+        best = &level.points;
+    }
+    return best;
+}
+
+void Stroke::finish(bool buildLevels) {
+    if (pointCount() < 2) {
+        points_.clear();
+        bounds_ = Rect{};
+        touch();
+        return;
+    }
+    if (buildLevels) buildLod();
 }
 
 void Stroke::translate(const Vec2& delta) {
     if (delta.x == 0.0 && delta.y == 0.0) return;
+    if (cold_) {
+        packedAnchor_ -= delta;
+    }
     for (auto& pt : points_) {
         pt.x -= delta.x;
         pt.y -= delta.y;
     }
+    bounds_ = bounds_.translated(Vec2{-delta.x, -delta.y});
+    touch();
+    for (auto& level : lod_) {
+        for (auto& pt : level.points) {
+            pt.x -= delta.x;
+            pt.y -= delta.y;
+        }
+    }
 }
 
 double Stroke::widthScreen(double currentZoomExp) const {
@@ -58,3 +203,73 @@ double Stroke::widthScreen(double currentZoomExp) const {
     expSum = std::clamp(expSum, kMinScreenExp, kMaxScreenExp);
     return std::exp2(expSum);
 }
+
+Rect Stroke::inkBounds() const {
+    return bounds_.inflated(std::exp2(widthExp_) * 0.5);
+}
+
+bool Stroke::freeze() {
+    if (cold_ || points_.size() < 2) return false;
+
+    PointQuantizer q(points_.front(), PointQuantizer::quantumForWidthExp(widthExp_, kColdQuantumBits));
+    std::vector<std::uint8_t> packed;
+    packed.reserve(points_.size() * 3);
+    for (std::size_t i = 1; i < points_.size(); ++i) {
+        if (!q.encode(points_[i], packed)) return false; // too far from the anchor: stay hot
+    }
+    packed.shrink_to_fit();
+
+    packed_ = std::move(packed);
+    packedAnchor_ = points_.front();
+    packedCount_ = points_.size();
+    std::vector<Vec2>().swap(points_);
+    std::vector<LodLevel>().swap(lod_);
+    cold_ = true;
+    return true;
+}
+
+void Stroke::copyPointsWorld(std::vector<Vec2>& out) const {
+    out.clear();
+    if (cold_) {
+        decodePacked(out);
+    } else {
+        out.assign(points_.begin(), points_.end());
+    }
+}
+
+const std::vector<Vec2>& Stroke::pointsWorld(std::vector<Vec2>& scratch) const {
+    if (!cold_) return points_;
+    copyPointsWorld(scratch);
+    return scratch;
+}
+
+void Stroke::decodePacked(std::vector<Vec2>& out) const {
+    PointQuantizer q(packedAnchor_, PointQuantizer::quantumForWidthExp(widthExp_, kColdQuantumBits));
+    out.reserve(out.size() + packedCount_);
+    const std::size_t target = out.size() + packedCount_;
+    out.push_back(packedAnchor_);
+    const std::uint8_t* p = packed_.data();
+    const std::uint8_t* end = p + packed_.size();
+    Vec2 w;
+    while (out.size() < target && q.decode(p, end, w)) {
+        out.push_back(w);
+    }
+}
+
+void Stroke::thaw() {
+    if (!cold_) return;
+    decodePacked(points_);
+    std::vector<std::uint8_t>().swap(packed_);
+    cold_ = false;
+}
+
+void Stroke::memoryUsage(MemoryUsage& geometry, MemoryUsage& lod) const {
+    geometry.addVector(points_);
+    geometry.addVector(packed_);
+    geometry.points += pointCount();
+    lod.addVector(lod_);
+    for (const LodLevel& level : lod_) {
+        lod.addVector(level.points);
+        lod.points += level.points.size();
+    }
+}
@@ -1,28 +1,122 @@
 #pragma once
 #include <vector>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include "../types.hpp"
 
 class Camera;
+struct MemoryUsage;
+
+// How ink is laid down: a uniform round pen, or overlapping dabs of a soft
+// or grainy tip (see BrushEngine).
+enum class BrushKind : std::uint8_t { Pen = 0, Soft = 1, Grain = 2 };
+constexpr int kBrushKindCount = 3;
 
 class Stroke {
 public:
     Stroke() = default;
 
     void begin(double brushPx, std::uint32_t colorRGB, const Camera& cam);
+    void beginWorld(double widthExp, std::uint32_t colorRGB);
     void addScreenPoint(double sx, double sy, const Camera& cam, double minStepPx = 1.5);
-    void finish();
+    void addWorldPoint(const Vec2& w);
+    // Replaces the stroke with ready-made world points in one step.
+    void assignWorld(double widthExp, std::uint32_t colorRGB, std::vector<Vec2>&& points);
+    // Without buildLevels the LOD is left for a later buildLod() call.
+    void finish(bool buildLevels = true);
 
+    // Hot strokes only: a cold stroke has no points here until thaw(). Owners
+    // thaw explicitly; readers of shared strokes use the scratch overload.
     const std::vector<Vec2>& pointsWorld() const { return points_; }
+    // Copies the points into out without changing the storage tier, for
+    // one-off readers such as export that must not inflate memory.
+    void copyPointsWorld(std::vector<Vec2>& out) const;
+    // Never changes the storage tier, so it is safe on strokes shared with
+    // other threads: cold points are decoded into scratch.
+    const std::vector<Vec2>& pointsWorld(std::vector<Vec2>& scratch) const;
     void translate(const Vec2& delta);
-    bool empty() const { return points_.size() < 2; }
+    bool empty() const { return pointCount() < 2; }
+    std::size_t pointCount() const { return cold_ ? packedCount_ : points_.size(); }
 
     double widthScreen(double currentZoomExp) const;
+    double widthExp() const { return widthExp_; }
     std::uint32_t colorRGB() const { return colorRGB_; }
+    BrushKind brush() const { return brush_; }
+    void setBrush(BrushKind brush);
+
+    // Level of detail: simplified copies of the polyline, each within a
+    // fixed fraction of the stroke's extent. lodFor() returns the coarsest
+    // one whose error stays under worldTol, or nullptr to use all points.
+    void buildLod();
+    const std::vector<Vec2>* lodFor(double worldTol) const;
+    std::size_t lodLevelCount() const { return lod_.size(); }
+
+    Rect bounds() const { return bounds_; }
+    // Changes whenever the geometry, style or LOD does, and is unique across
+    // all strokes; copies keep it. Storage tier changes leave it alone.
+    std::uint64_t revision() const { return revision_; }
+    // Unique per stroke and fixed for its lifetime, whatever its index;
+    // copies keep it, as they do the revision.
+    std::uint64_t id() const { return id_; }
+
+    // Strokes draw in index order, except pieces an erase split off: they
+    // keep the index of the stroke they came from as their slot and draw
+    // right after it, in index order among themselves.
+    std::size_t drawSlot(std::size_t index) const { return drawSlot_ == kOwnSlot ? index : drawSlot_; }
+    void setDrawSlot(std::size_t slot) { drawSlot_ = slot; }
+    Rect inkBounds() const; // bounds grown by half the world width
+
+    // Tiered storage: freeze() replaces the point vector with quantized
+    // zigzag varint deltas (1/256 of the stroke width per step) and drops
+    // the LOD levels; build them again with buildLod() after thawing.
+    bool freeze();
+    // Expands a cold stroke back into its point vector. A write like any
+    // other, so never on strokes other threads may be reading.
+    void thaw();
+    bool isCold() const { return cold_; }
+    // Heap held by the points, in whichever tier, and by the LOD levels.
+    void memoryUsage(MemoryUsage& geometry, MemoryUsage& lod) const;
+    // The usage stamp is not part of the stroke's value: the owner stamps
+    // strokes it shares with snapshots, so it is atomic and copies start
+    // from the current stamp.
+    std::uint64_t lastUsed() const { return lastUsed_.value.load(std::memory_order_relaxed); }
+    void markUsed(std::uint64_t epoch) const { lastUsed_.value.store(epoch, std::memory_order_relaxed); }
 
 private:
+    static std::uint64_t newId();
+    void touch();
+    void decodePacked(std::vector<Vec2>& out) const;
+
+private:
+    struct LodLevel {
+        double tolerance = 0.0;
+        std::vector<Vec2> points;
+    };
+    struct UseStamp {
+        mutable std::atomic<std::uint64_t> value{0};
+        UseStamp() = default;
+        UseStamp(const UseStamp& o) : value(o.value.load(std::memory_order_relaxed)) {}
+        UseStamp& operator=(const UseStamp& o) {
+            value.store(o.value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+    };
+
     double widthExp_{0.0}; // log2(width_world)
     std::vector<Vec2> points_;
     std::uint32_t colorRGB_{0xFFFFFF};
+    BrushKind brush_{BrushKind::Pen};
+    Rect bounds_;
+    std::vector<LodLevel> lod_; // finest first
+    std::uint64_t revision_{0};
+    std::uint64_t id_{newId()};
+    static constexpr std::size_t kOwnSlot = ~std::size_t{0};
+    std::size_t drawSlot_{kOwnSlot};
+
+    std::vector<std::uint8_t> packed_;
+    Vec2 packedAnchor_;
+    std::size_t packedCount_{0};
+    bool cold_{false};
+    UseStamp lastUsed_;
 };
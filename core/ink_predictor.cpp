@@ -0,0 +1,50 @@
+#include "ink_predictor.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr std::int64_t kMaxSampleAgeNs = 60'000'000;  // ignore samples older than 60 ms
+constexpr std::int64_t kMaxHorizonNs = 40'000'000;
+constexpr double kMaxLeadPx = 48.0;
+}
+
+void InkPredictor::addSample(std::int64_t timeNs, double sx, double sy) {
+    samples_[head_] = Sample{timeNs, Vec2{sx, sy}};
+    head_ = (head_ + 1) % kHistory;
+    count_ = std::min(count_ + 1, kHistory);
+}
+
+bool InkPredictor::predict(std::int64_t horizonNs, Vec2& out) const {
+    if (count_ < 3 || horizonNs <= 0) return false;
+
+    const Sample& newest = samples_[(head_ + kHistory - 1) % kHistory];
+    // Least-squares velocity over recent samples, time relative to the newest.
+    double st = 0, sx = 0, sy = 0, stt = 0, stx = 0, sty = 0;
+    int n = 0;
+    for (std::size_t k = 0; k < count_; ++k) {
+        const Sample& s = samples_[(head_ + kHistory - 1 - k) % kHistory];
+        const std::int64_t age = newest.t - s.t;
+        if (age > kMaxSampleAgeNs) break;
+        const double t = -static_cast<double>(age) / 1e9;
+        st += t; sx += s.p.x; sy += s.p.y;
+        stt += t * t; stx += t * s.p.x; sty += t * s.p.y;
+        ++n;
+    }
+    if (n < 3) return false;
+    const double denom = n * stt - st * st;
+    if (denom <= 0.0) return false;
+    const double vx = (n * stx - st * sx) / denom;
+    const double vy = (n * sty - st * sy) / denom;
+
+    const double h = static_cast<double>(std::min(horizonNs, kMaxHorizonNs)) / 1e9;
+    double dx = vx * h;
+    double dy = vy * h;
+    const double lead = std::hypot(dx, dy);
+    if (lead < 0.5) return false;
+    if (lead > kMaxLeadPx) {
+        dx *= kMaxLeadPx / lead;
+        dy *= kMaxLeadPx / lead;
+    }
+    out = Vec2{newest.p.x + dx, newest.p.y + dy};
+    return true;
+}
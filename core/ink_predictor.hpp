@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "types.hpp"
+
+// Short-horizon pen position predictor. Fits a velocity to the last few
+// screen samples and extrapolates it; the result is provisional ink only
+// and is never stored in the scene.
+class InkPredictor {
+public:
+    void reset() { count_ = 0; }
+    void addSample(std::int64_t timeNs, double sx, double sy);
+
+    // Predicted screen position horizonNs after the newest sample. Returns
+    // false when there is not enough recent motion to extrapolate.
+    bool predict(std::int64_t horizonNs, Vec2& out) const;
+
+private:
+    static constexpr std::size_t kHistory = 6;
+
+    struct Sample {
+        std::int64_t t = 0;
+        Vec2 p;
+    };
+    Sample samples_[kHistory];
+    std::size_t head_ = 0;  // next write slot
+    std::size_t count_ = 0;
+};
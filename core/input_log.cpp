@@ -0,0 +1,204 @@
+#include "input_log.hpp"
+#include "elements/stroke.hpp"
+#include "scene_io.hpp"
+#include "varint.hpp"
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace {
+constexpr std::uint8_t kMagic[4] = {'C', 'N', 'V', 'I'};
+// 2: ViewState records. 3: the brush kind in the header.
+constexpr std::uint64_t kVersion = 3;
+// Positions are stored on a 1/256 px grid as deltas to the previous one.
+constexpr double kPosScale = 256.0;
+
+bool hasPosition(InputRecord::Type t) {
+    using T = InputRecord::Type;
+    return t == T::MousePress || t == T::MouseMove || t == T::MouseRelease || t == T::Wheel;
+}
+
+bool getU32(const std::uint8_t*& p, const std::uint8_t* end, std::uint32_t& v) {
+    std::uint64_t raw = 0;
+    if (!getVarint(p, end, raw)) return false;
+    v = static_cast<std::uint32_t>(raw);
+    return true;
+}
+
+bool getInt(const std::uint8_t*& p, const std::uint8_t* end, std::int64_t& v) {
+    std::uint64_t raw = 0;
+    if (!getVarint(p, end, raw)) return false;
+    v = unzigzag(raw);
+    return true;
+}
+}
+
+void InputLogWriter::begin(const InputLogHeader& h, const Scene& scene) {
+    lastTimeNs_ = 0;
+    lastX_ = 0;
+    lastY_ = 0;
+
+    buf_.assign(std::begin(kMagic), std::end(kMagic));
+    putVarint(buf_, kVersion);
+    putVarint(buf_, zigzag(h.width));
+    putVarint(buf_, zigzag(h.height));
+    putDouble(buf_, h.zoomExp);
+    putDouble(buf_, h.offsetPx.x);
+    putDouble(buf_, h.offsetPx.y);
+    putDouble(buf_, h.worldCenter.x);
+    putDouble(buf_, h.worldCenter.y);
+    putVarint(buf_, zigzag(h.mode));
+    putDouble(buf_, h.brushPx);
+    putVarint(buf_, h.brushColorRGB);
+    putVarint(buf_, h.brushKind);
+    writeScene(scene, buf_);
+}
+
+void InputLogWriter::append(const InputRecord& r) {
+    using T = InputRecord::Type;
+    buf_.push_back(static_cast<std::uint8_t>(r.type));
+    putVarint(buf_, zigzag(r.timeNs - lastTimeNs_));
+    lastTimeNs_ = r.timeNs;
+
+    if (hasPosition(r.type)) {
+        const auto x = static_cast<std::int64_t>(std::llround(r.pos.x * kPosScale));
+        const auto y = static_cast<std::int64_t>(std::llround(r.pos.y * kPosScale));
+        putVarint(buf_, zigzag(x - lastX_));
+        putVarint(buf_, zigzag(y - lastY_));
+        lastX_ = x;
+        lastY_ = y;
+        putVarint(buf_, r.buttons);
+        putVarint(buf_, r.modifiers);
+    }
+    switch (r.type) {
+    case T::MousePress:
+    case T::MouseRelease:
+        putVarint(buf_, r.button);
+        break;
+    case T::Wheel:
+        putVarint(buf_, zigzag(r.wheelDelta));
+        break;
+    case T::KeyPress:
+    case T::KeyRelease:
+        putVarint(buf_, r.key);
+        putVarint(buf_, r.modifiers);
+        break;
+    case T::Resize:
+        putVarint(buf_, zigzag(r.width));
+        putVarint(buf_, zigzag(r.height));
+        break;
+    case T::ViewState:
+        putVarint(buf_, zigzag(r.mode));
+        putDouble(buf_, r.brushPx);
+        putVarint(buf_, r.brushColorRGB);
+        putVarint(buf_, r.brushKind);
+        putDouble(buf_, r.zoomExp);
+        putDouble(buf_, r.offsetPx.x);
+        putDouble(buf_, r.offsetPx.y);
+        putDouble(buf_, r.worldCenter.x);
+        putDouble(buf_, r.worldCenter.y);
+        break;
+    case T::MouseMove:
+    case T::Paint:
+        break;
+    }
+}
+
+std::vector<std::uint8_t> InputLogWriter::takeBytes() {
+    std::vector<std::uint8_t> out;
+    out.swap(buf_);
+    return out;
+}
+
+bool readInputLog(const std::vector<std::uint8_t>& bytes, InputLogHeader& h,
+                  Scene& scene, std::vector<InputRecord>& records) {
+    using T = InputRecord::Type;
+    const std::uint8_t* p = bytes.data();
+    const std::uint8_t* end = p + bytes.size();
+    if (end - p < 4 || !std::equal(std::begin(kMagic), std::end(kMagic), p)) return false;
+    p += 4;
+
+    std::uint64_t version = 0;
+    std::int64_t width = 0, height = 0, mode = 0;
+    if (!getVarint(p, end, version) || version < 1 || version > kVersion) return false;
+    if (!getInt(p, end, width) || !getInt(p, end, height) ||
+        !getDouble(p, end, h.zoomExp) ||
+        !getDouble(p, end, h.offsetPx.x) || !getDouble(p, end, h.offsetPx.y) ||
+        !getDouble(p, end, h.worldCenter.x) || !getDouble(p, end, h.worldCenter.y) ||
+        !getInt(p, end, mode) || !getDouble(p, end, h.brushPx) ||
+        !getU32(p, end, h.brushColorRGB)) {
+        return false;
+    }
+    h.brushKind = 0;
+    if (version >= 3 && (!getU32(p, end, h.brushKind) || h.brushKind >= kBrushKindCount)) return false;
+    h.width = static_cast<int>(width);
+    h.height = static_cast<int>(height);
+    h.mode = static_cast<int>(mode);
+    if (!readScene(p, end, scene)) return false;
+
+    std::int64_t timeNs = 0, x = 0, y = 0;
+    while (p < end) {
+        InputRecord r;
+        const std::uint8_t type = *p++;
+        if (type < static_cast<std::uint8_t>(T::MousePress) || type > static_cast<std::uint8_t>(T::ViewState)) {
+            return false;
+        }
+        r.type = static_cast<T>(type);
+        std::int64_t dt = 0;
+        if (!getInt(p, end, dt)) return false;
+        timeNs += dt;
+        r.timeNs = timeNs;
+
+        if (hasPosition(r.type)) {
+            std::int64_t dx = 0, dy = 0;
+            if (!getInt(p, end, dx) || !getInt(p, end, dy)) return false;
+            x += dx;
+            y += dy;
+            r.pos = {static_cast<double>(x) / kPosScale, static_cast<double>(y) / kPosScale};
+            if (!getU32(p, end, r.buttons) || !getU32(p, end, r.modifiers)) return false;
+        }
+        std::int64_t a = 0, b = 0;
+        switch (r.type) {
+        case T::MousePress:
+        case T::MouseRelease:
+            if (!getU32(p, end, r.button)) return false;
+            break;
+        case T::Wheel:
+            if (!getInt(p, end, a)) return false;
+            r.wheelDelta = static_cast<std::int32_t>(a);
+            break;
+        case T::KeyPress:
+        case T::KeyRelease:
+            if (!getU32(p, end, r.key) || !getU32(p, end, r.modifiers)) return false;
+            break;
+        case T::Resize:
+            if (!getInt(p, end, a) || !getInt(p, end, b)) return false;
+            r.width = static_cast<int>(a);
+            r.height = static_cast<int>(b);
+            break;
+        case T::ViewState:
+            if (!getInt(p, end, a) || !getDouble(p, end, r.brushPx) || !getU32(p, end, r.brushColorRGB) ||
+                !getU32(p, end, r.brushKind) || r.brushKind >= kBrushKindCount || !getDouble(p, end, r.zoomExp) ||
+                !getDouble(p, end, r.offsetPx.x) || !getDouble(p, end, r.offsetPx.y) ||
+                !getDouble(p, end, r.worldCenter.x) || !getDouble(p, end, r.worldCenter.y)) {
+                return false;
+            }
+            r.mode = static_cast<int>(a);
+            break;
+        case T::MouseMove:
+        case T::Paint:
+            break;
+        }
+        records.push_back(r);
+    }
+    return true;
+}
+
+bool readInputLogFile(const std::string& path, InputLogHeader& header,
+                      Scene& scene, std::vector<InputRecord>& records) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    const std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    return readInputLog(bytes, header, scene, records);
+}
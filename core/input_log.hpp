@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "types.hpp"
+
+class Scene;
+
+// Recorded canvas input session: the view state and board at the start,
+// followed by timestamped input and paint events. Toolkit-neutral; the UI
+// maps its own event types onto InputRecord.
+struct InputLogHeader {
+    int width = 0;
+    int height = 0;
+    double zoomExp = 0.0;
+    Vec2 offsetPx;
+    Vec2 worldCenter;
+    int mode = 0;
+    double brushPx = 4.0;
+    std::uint32_t brushColorRGB = 0xFFFFFF;
+    std::uint32_t brushKind = 0; // BrushKind; logs before version 3 draw with the pen
+};
+
+struct InputRecord {
+    enum class Type : std::uint8_t {
+        MousePress = 1,
+        MouseMove,
+        MouseRelease,
+        Wheel,
+        KeyPress,
+        KeyRelease,
+        Resize,
+        Paint,
+        ViewState, // settings changed from outside the view's own events
+    };
+
+    Type type = Type::Paint;
+    std::int64_t timeNs = 0;  // since recording started
+    Vec2 pos;                 // mouse and wheel
+    std::uint32_t button = 0;
+    std::uint32_t buttons = 0;
+    std::uint32_t modifiers = 0;
+    std::uint32_t key = 0;
+    std::int32_t wheelDelta = 0; // angle delta, 1/8 degree
+    int width = 0;               // resize
+    int height = 0;
+    // ViewState: the whole state after the change, applied as is.
+    int mode = 0;
+    double brushPx = 0.0;
+    std::uint32_t brushColorRGB = 0;
+    std::uint32_t brushKind = 0;
+    double zoomExp = 0.0;
+    Vec2 offsetPx;
+    Vec2 worldCenter;
+};
+
+class InputLogWriter {
+public:
+    // Starts a log with the initial view state and a snapshot of the board.
+    void begin(const InputLogHeader& header, const Scene& scene);
+    void append(const InputRecord& rec);
+
+    // Encoded bytes not yet taken; lets the recorder stream to disk.
+    std::vector<std::uint8_t> takeBytes();
+    std::size_t pendingBytes() const { return buf_.size(); }
+
+private:
+    std::vector<std::uint8_t> buf_;
+    std::int64_t lastTimeNs_ = 0;
+    std::int64_t lastX_ = 0;
+    std::int64_t lastY_ = 0;
+};
+
+// Decodes a whole log. The initial board is appended to scene.
+bool readInputLog(const std::vector<std::uint8_t>& bytes, InputLogHeader& header,
+                  Scene& scene, std::vector<InputRecord>& records);
+bool readInputLogFile(const std::string& path, InputLogHeader& header,
+                      Scene& scene, std::vector<InputRecord>& records);
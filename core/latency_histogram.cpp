@@ -0,0 +1,50 @@
+#include "latency_histogram.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr double kFirstBucketMs = 1.0 / 16.0;
+}
+
+std::size_t LatencyHistogram::bucketFor(std::int64_t ns) {
+    const double ms = static_cast<double>(std::max<std::int64_t>(ns, 0)) / 1e6;
+    if (!(ms > kFirstBucketMs)) return 0;
+    const double pos = std::ceil(std::log2(ms / kFirstBucketMs) * kBucketsPerOctave);
+    return std::min(static_cast<std::size_t>(pos), kBucketCount - 1);
+}
+
+void LatencyHistogram::record(std::int64_t ns) {
+    ns = std::max<std::int64_t>(ns, 0);
+    ++buckets_[bucketFor(ns)];
+    ++count_;
+    sumNs_ += ns;
+    maxNs_ = std::max(maxNs_, ns);
+}
+
+void LatencyHistogram::reset() {
+    buckets_.fill(0);
+    count_ = 0;
+    sumNs_ = 0;
+    maxNs_ = 0;
+}
+
+double LatencyHistogram::meanMs() const {
+    return count_ ? static_cast<double>(sumNs_) / static_cast<double>(count_) / 1e6 : 0.0;
+}
+
+double LatencyHistogram::bucketUpperMs(std::size_t i) {
+    return kFirstBucketMs * std::exp2(static_cast<double>(i) / kBucketsPerOctave);
+}
+
+double LatencyHistogram::percentileMs(double q) const {
+    if (count_ == 0) return 0.0;
+    const auto rank = static_cast<std::uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(count_)));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBucketCount; ++i) {
+        seen += buckets_[i];
+        if (seen >= std::max<std::uint64_t>(rank, 1)) {
+            return std::min(bucketUpperMs(i), maxMs());
+        }
+    }
+    return maxMs();
+}
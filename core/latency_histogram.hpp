@@ -0,0 +1,32 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Log-bucketed latency histogram: 4 buckets per octave from 1/16 ms up to
+// ~8 s. Recording is O(1) and allocation-free.
+class LatencyHistogram {
+public:
+    static constexpr int kBucketsPerOctave = 4;
+    static constexpr int kOctaves = 17;
+    static constexpr std::size_t kBucketCount = kBucketsPerOctave * kOctaves + 1;
+
+    void record(std::int64_t ns);
+    void reset();
+
+    std::uint64_t count() const { return count_; }
+    double meanMs() const;
+    double maxMs() const { return static_cast<double>(maxNs_) / 1e6; }
+    // Upper edge of the bucket holding quantile q (0..1), in milliseconds.
+    double percentileMs(double q) const;
+
+    std::uint64_t bucketCount(std::size_t i) const { return buckets_[i]; }
+    static double bucketUpperMs(std::size_t i);
+    static std::size_t bucketFor(std::int64_t ns);
+
+private:
+    std::array<std::uint64_t, kBucketCount> buckets_{};
+    std::uint64_t count_ = 0;
+    std::int64_t sumNs_ = 0;
+    std::int64_t maxNs_ = 0;
+};
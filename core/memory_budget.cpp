@@ -0,0 +1,143 @@
+#include "memory_budget.hpp"
+#include <utility>
+
+MemoryBudget& MemoryBudget::instance() {
+    static MemoryBudget budget;
+    return budget;
+}
+
+void MemoryBudget::setBudget(std::size_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        budget_ = bytes;
+    }
+    evictOverflow(EntryId{~ClientId{0}, 0});
+}
+
+std::size_t MemoryBudget::budget() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return budget_;
+}
+
+MemoryBudget::ClientId MemoryBudget::registerClient(const std::string& name, Evictor evictor) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Client c;
+    c.name = name;
+    c.evictor = std::move(evictor);
+    c.live = true;
+    clients_.push_back(std::move(c));
+    return static_cast<ClientId>(clients_.size() - 1);
+}
+
+void MemoryBudget::unregisterClient(ClientId client) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (client >= clients_.size()) return;
+    for (auto it = lru_.begin(); it != lru_.end();) {
+        if (it->client == client) {
+            total_ -= it->bytes;
+            entries_.erase(EntryId{it->client, it->key});
+            it = lru_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    clients_[client].live = false;
+    evicted_.wait(lock, [&] { return clients_[client].evicting == 0; });
+    Client& c = clients_[client];
+    c.evictor = nullptr;
+    c.bytes = 0;
+    c.entries = 0;
+}
+
+void MemoryBudget::charge(ClientId client, Key key, std::size_t bytes) {
+    const EntryId id{client, key};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (client >= clients_.size() || !clients_[client].live) return;
+        Client& c = clients_[client];
+        auto found = entries_.find(id);
+        if (found != entries_.end()) {
+            Entry& e = *found->second;
+            total_ = total_ - e.bytes + bytes;
+            c.bytes = c.bytes - e.bytes + bytes;
+            e.bytes = bytes;
+            lru_.splice(lru_.end(), lru_, found->second);
+        } else {
+            lru_.push_back(Entry{client, key, bytes});
+            entries_.emplace(id, std::prev(lru_.end()));
+            total_ += bytes;
+            c.bytes += bytes;
+            ++c.entries;
+        }
+        if (total_ <= budget_) return;
+    }
+    evictOverflow(id);
+}
+
+void MemoryBudget::touch(ClientId client, Key key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = entries_.find(EntryId{client, key});
+    if (found == entries_.end()) return;
+    lru_.splice(lru_.end(), lru_, found->second);
+}
+
+void MemoryBudget::release(ClientId client, Key key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = entries_.find(EntryId{client, key});
+    if (found == entries_.end()) return;
+    const Entry& e = *found->second;
+    total_ -= e.bytes;
+    clients_[client].bytes -= e.bytes;
+    --clients_[client].entries;
+    lru_.erase(found->second);
+    entries_.erase(found);
+}
+
+std::size_t MemoryBudget::usage() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return total_;
+}
+
+std::vector<MemoryBudget::ClientUsage> MemoryBudget::usageByClient() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<ClientUsage> out;
+    for (const Client& c : clients_) {
+        if (!c.live) continue;
+        out.push_back(ClientUsage{c.name, c.bytes, c.entries, c.evictions});
+    }
+    return out;
+}
+
+void MemoryBudget::evictOverflow(const EntryId& keep) {
+    struct Victim {
+        ClientId client;
+        Evictor evictor;
+        Key key;
+    };
+    std::vector<Victim> victims;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = lru_.begin();
+        while (total_ > budget_ && it != lru_.end()) {
+            if (it->client == keep.client && it->key == keep.key) {
+                ++it;
+                continue;
+            }
+            Client& c = clients_[it->client];
+            total_ -= it->bytes;
+            c.bytes -= it->bytes;
+            --c.entries;
+            ++c.evictions;
+            ++c.evicting;
+            victims.push_back(Victim{it->client, c.evictor, it->key});
+            entries_.erase(EntryId{it->client, it->key});
+            it = lru_.erase(it);
+        }
+    }
+    for (Victim& v : victims) {
+        if (v.evictor) v.evictor(v.key);
+        std::lock_guard<std::mutex> lock(mutex_);
+        --clients_[v.client].evicting;
+    }
+    if (!victims.empty()) evicted_.notify_all();
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Process-wide byte budget shared by all caches. A cache registers as a
+// client and charges every entry it keeps; whenever the total goes over the
+// budget, the least recently used entries across all clients are evicted.
+//
+// Evictors run on the thread that caused the overflow, after the budget's own
+// lock is released. Caches that are not thread-safe should only queue the key
+// and drop the entry on their own thread. Keys must name the same entry for
+// as long as it is charged, so they cannot be positions that shift.
+class MemoryBudget {
+public:
+    using ClientId = std::uint32_t;
+    using Key = std::uint64_t;
+    using Evictor = std::function<void(Key)>;
+
+    struct ClientUsage {
+        std::string name;
+        std::size_t bytes = 0;
+        std::size_t entries = 0;
+        std::uint64_t evictions = 0;
+    };
+
+    static constexpr std::size_t kDefaultBudget = std::size_t{1} << 30;
+
+    static MemoryBudget& instance();
+
+    void setBudget(std::size_t bytes);
+    std::size_t budget() const;
+
+    ClientId registerClient(const std::string& name, Evictor evictor);
+    // Forgets the client's entries without calling its evictor, and waits
+    // for evictor calls already under way on other threads, so the owner
+    // may be destroyed as soon as it returns.
+    void unregisterClient(ClientId client);
+
+    // Adds or resizes an entry and marks it most recently used. The entry
+    // being charged is never evicted by this call.
+    void charge(ClientId client, Key key, std::size_t bytes);
+    void touch(ClientId client, Key key);
+    // The owner dropped the entry itself.
+    void release(ClientId client, Key key);
+
+    std::size_t usage() const;
+    std::vector<ClientUsage> usageByClient() const;
+
+private:
+    struct Entry {
+        ClientId client;
+        Key key;
+        std::size_t bytes;
+    };
+    struct EntryId {
+        ClientId client;
+        Key key;
+        bool operator==(const EntryId& o) const { return client == o.client && key == o.key; }
+    };
+    struct EntryIdHash {
+        std::size_t operator()(const EntryId& id) const {
+            return std::hash<Key>()(id.key * 0x9E3779B97F4A7C15ull ^ id.client);
+        }
+    };
+    struct Client {
+        std::string name;
+        Evictor evictor;
+        std::size_t bytes = 0;
+        std::size_t entries = 0;
+        std::uint64_t evictions = 0;
+        std::size_t evicting = 0; // evictor calls in flight
+        bool live = false;
+    };
+    using Lru = std::list<Entry>; // front = least recently used
+
+    void evictOverflow(const EntryId& keep);
+
+    mutable std::mutex mutex_;
+    std::condition_variable evicted_;
+    std::size_t budget_ = kDefaultBudget;
+    std::size_t total_ = 0;
+    std::vector<Client> clients_;
+    Lru lru_;
+    std::unordered_map<EntryId, Lru::iterator, EntryIdHash> entries_;
+};
@@ -0,0 +1,46 @@
+#include "memory_usage.hpp"
+#include <cstdio>
+
+void MemoryReport::add(const std::string& name, const MemoryUsage& usage) {
+    for (auto& [n, u] : entries_) {
+        if (n == name) {
+            u += usage;
+            return;
+        }
+    }
+    entries_.emplace_back(name, usage);
+}
+
+void MemoryReport::merge(const MemoryReport& other) {
+    for (const auto& [name, usage] : other.entries_) add(name, usage);
+}
+
+MemoryUsage MemoryReport::total() const {
+    MemoryUsage t;
+    for (const auto& entry : entries_) t += entry.second;
+    return t;
+}
+
+namespace {
+void appendUsage(std::string& out, const MemoryUsage& u) {
+    char buf[160];
+    std::snprintf(buf, sizeof(buf), "{\"usedBytes\": %zu, \"reservedBytes\": %zu, \"allocations\": %zu, \"points\": %zu}",
+                  u.usedBytes, u.reservedBytes, u.allocations, u.points);
+    out += buf;
+}
+}
+
+std::string MemoryReport::toJson() const {
+    // Subsystem names are plain identifiers with dots, so need no escaping.
+    std::string out = "{\n  \"total\": ";
+    appendUsage(out, total());
+    out += ",\n  \"subsystems\": {";
+    for (std::size_t i = 0; i < entries_.size(); ++i) {
+        out += i == 0 ? "\n    \"" : ",\n    \"";
+        out += entries_[i].first;
+        out += "\": ";
+        appendUsage(out, entries_[i].second);
+    }
+    out += entries_.empty() ? "}\n}\n" : "\n  }\n}\n";
+    return out;
+}
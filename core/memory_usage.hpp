@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Heap memory of one subsystem, counted by walking its containers. It is
+// what the subsystem asked the allocator for, not what the OS charged the
+// process; node sizes of hash containers are estimated. Header-only, so
+// the element library can report without linking the core.
+struct MemoryUsage {
+    std::size_t usedBytes = 0;     // live elements
+    std::size_t reservedBytes = 0; // allocated, with capacity slack and node overhead
+    std::size_t allocations = 0;   // live heap blocks
+    std::size_t points = 0;        // stroke points, where the subsystem holds any
+
+    MemoryUsage& operator+=(const MemoryUsage& o) {
+        usedBytes += o.usedBytes;
+        reservedBytes += o.reservedBytes;
+        allocations += o.allocations;
+        points += o.points;
+        return *this;
+    }
+
+    // One heap block of which used bytes are live.
+    void addBlock(std::size_t used, std::size_t reserved) {
+        usedBytes += used;
+        reservedBytes += reserved;
+        ++allocations;
+    }
+
+    void addString(const std::string& s) {
+        // Short strings live inside the object itself.
+        const char* self = reinterpret_cast<const char*>(&s);
+        const std::less<const char*> before;
+        if (!before(s.data(), self) && before(s.data(), self + sizeof(s))) return;
+        addBlock(s.size() + 1, s.capacity() + 1);
+    }
+
+    template <class T>
+    void addVector(const std::vector<T>& v) {
+        if (v.capacity() == 0) return;
+        if constexpr (std::is_same_v<T, bool>) {
+            addBlock((v.size() + 7) / 8, (v.capacity() + 7) / 8);
+        } else {
+            addBlock(v.size() * sizeof(T), v.capacity() * sizeof(T));
+        }
+    }
+
+    template <class K, class V, class... Rest>
+    void addMap(const std::unordered_map<K, V, Rest...>& m) {
+        addHashed(m.size(), sizeof(typename std::unordered_map<K, V, Rest...>::value_type), m.bucket_count());
+    }
+    template <class K, class... Rest>
+    void addSet(const std::unordered_set<K, Rest...>& s) {
+        addHashed(s.size(), sizeof(K), s.bucket_count());
+    }
+
+private:
+    void addHashed(std::size_t size, std::size_t valueBytes, std::size_t buckets) {
+        // A node is the value plus a next pointer, rounded to pointer
+        // alignment; the bucket array is one more block.
+        const std::size_t node = (valueBytes + 2 * sizeof(void*) - 1) / sizeof(void*) * sizeof(void*);
+        usedBytes += size * valueBytes;
+        reservedBytes += size * node + buckets * sizeof(void*);
+        allocations += size + (buckets > 1 ? 1 : 0);
+    }
+};
+
+// Usage by named subsystem ("scene.strokes", "render.display_list", ...),
+// in the order they were first added.
+class MemoryReport {
+public:
+    // Adds to the subsystem of that name, creating it if needed.
+    void add(const std::string& name, const MemoryUsage& usage);
+    void merge(const MemoryReport& other);
+
+    bool empty() const { return entries_.empty(); }
+    const std::vector<std::pair<std::string, MemoryUsage>>& entries() const { return entries_; }
+    MemoryUsage total() const;
+
+    // {"total": {...}, "subsystems": {"name": {...}, ...}} with usedBytes,
+    // reservedBytes, allocations and points in every object.
+    std::string toJson() const;
+
+private:
+    std::vector<std::pair<std::string, MemoryUsage>> entries_;
+};
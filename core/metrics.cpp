@@ -0,0 +1,184 @@
+#include "metrics.hpp"
+#include "latency_histogram.hpp"
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <deque>
+#include <mutex>
+
+namespace {
+constexpr std::size_t kCounters = static_cast<std::size_t>(Metrics::Counter::Count);
+constexpr std::size_t kTimings = static_cast<std::size_t>(Metrics::Timing::Count);
+// Histograms are exported at octave edges, where the cumulative counts of
+// the finer buckets are exact.
+constexpr std::size_t kExportStep = LatencyHistogram::kBucketsPerOctave;
+
+struct Histogram {
+    std::array<std::atomic<std::uint64_t>, LatencyHistogram::kBucketCount> buckets{};
+    std::atomic<std::int64_t> sumNs{0};
+};
+
+struct alignas(64) Slot {
+    std::array<std::atomic<std::uint64_t>, kCounters> counters{};
+    std::array<Histogram, kTimings> timings;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::deque<Slot> slots; // stable addresses for the threads' pointers
+};
+
+// Never destroyed: threads may still count during static destruction.
+Registry& registry() {
+    static Registry* r = new Registry;
+    return *r;
+}
+
+Slot& mySlot() {
+    thread_local Slot* slot = nullptr;
+    if (!slot) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        slot = &r.slots.emplace_back();
+    }
+    return *slot;
+}
+
+// Single writer: no read-modify-write instruction is needed.
+template <class T>
+void bump(std::atomic<T>& a, T n) {
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+struct CounterInfo {
+    const char* name;
+    const char* labels;
+    const char* help;
+};
+
+// Counters sharing a name are written under one header, so they are listed
+// next to each other.
+constexpr std::array<CounterInfo, kCounters> kCounterInfo = {{
+    {"cancans_frames_total", "", "Paint events that drew the view."},
+    {"cancans_recenters_total", "", "Moves of the scene origin to keep coordinates small."},
+    {"cancans_input_events_total", "kind=\"pointer\"", "Input events handled by the view."},
+    {"cancans_input_events_total", "kind=\"wheel\"", ""},
+    {"cancans_input_events_total", "kind=\"key\"", ""},
+    {"cancans_display_list_lookups_total", "result=\"hit\"", "Strokes drawn from a retained display list, or compiled first."},
+    {"cancans_display_list_lookups_total", "result=\"miss\"", ""},
+    {"cancans_image_tile_lookups_total", "result=\"hit\"", "Image tile requests, resident or not."},
+    {"cancans_image_tile_lookups_total", "result=\"miss\"", ""},
+    {"cancans_glyph_lookups_total", "result=\"hit\"", "Glyph atlas lookups, cached or rasterized."},
+    {"cancans_glyph_lookups_total", "result=\"miss\"", ""},
+}};
+
+constexpr std::array<CounterInfo, kTimings> kTimingInfo = {{
+    {"cancans_paint_seconds", "", "Time in the view's paint event."},
+    {"cancans_render_frame_seconds", "", "Time to render one frame on the render thread."},
+    {"cancans_input_latency_seconds", "", "From input to the paint event that first shows it."},
+}};
+
+void appendNumber(std::string& out, double v) {
+    char buf[32];
+    const auto r = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, r.ptr);
+}
+}
+
+void Metrics::add(Counter c, std::uint64_t n) {
+    bump(mySlot().counters[static_cast<std::size_t>(c)], n);
+}
+
+void Metrics::record(Timing t, std::int64_t ns) {
+    Histogram& h = mySlot().timings[static_cast<std::size_t>(t)];
+    bump(h.buckets[LatencyHistogram::bucketFor(ns)], std::uint64_t{1});
+    bump(h.sumNs, ns);
+}
+
+std::uint64_t Metrics::total(Counter c) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::uint64_t sum = 0;
+    for (const Slot& s : r.slots) sum += s.counters[static_cast<std::size_t>(c)].load(std::memory_order_relaxed);
+    return sum;
+}
+
+void Metrics::writeHeader(std::string& out, std::string_view name, std::string_view type, std::string_view help) {
+    out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+void Metrics::writeSample(std::string& out, std::string_view name, std::string_view labels, double value) {
+    out.append(name);
+    if (!labels.empty()) out.append("{").append(labels).append("}");
+    out.append(" ");
+    appendNumber(out, value);
+    out.append("\n");
+}
+
+std::string Metrics::labelValue(std::string_view v) {
+    std::string out;
+    out.reserve(v.size());
+    for (char c : v) {
+        if (c == '\\' || c == '"') out.push_back('\\');
+        if (c == '\n') {
+            out.append("\\n");
+            continue;
+        }
+        out.push_back(c);
+    }
+    return out;
+}
+
+void Metrics::writePrometheus(std::string& out) {
+    std::array<std::uint64_t, kCounters> counters{};
+    struct Summed {
+        std::array<std::uint64_t, LatencyHistogram::kBucketCount> buckets{};
+        std::int64_t sumNs = 0;
+    };
+    std::array<Summed, kTimings> timings{};
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (const Slot& s : r.slots) {
+            for (std::size_t c = 0; c < kCounters; ++c) counters[c] += s.counters[c].load(std::memory_order_relaxed);
+            for (std::size_t t = 0; t < kTimings; ++t) {
+                const Histogram& h = s.timings[t];
+                for (std::size_t b = 0; b < LatencyHistogram::kBucketCount; ++b) {
+                    timings[t].buckets[b] += h.buckets[b].load(std::memory_order_relaxed);
+                }
+                timings[t].sumNs += h.sumNs.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    for (std::size_t c = 0; c < kCounters; ++c) {
+        const CounterInfo& info = kCounterInfo[c];
+        if (c == 0 || std::string_view(info.name) != kCounterInfo[c - 1].name) {
+            writeHeader(out, info.name, "counter", info.help);
+        }
+        writeSample(out, info.name, info.labels, static_cast<double>(counters[c]));
+    }
+
+    for (std::size_t t = 0; t < kTimings; ++t) {
+        const CounterInfo& info = kTimingInfo[t];
+        const Summed& h = timings[t];
+        const std::string name(info.name);
+        writeHeader(out, name, "histogram", info.help);
+        // The last bucket also holds everything beyond it, so it is +Inf.
+        std::uint64_t cumulative = 0;
+        std::string le;
+        for (std::size_t b = 0; b + 1 < LatencyHistogram::kBucketCount; ++b) {
+            cumulative += h.buckets[b];
+            if (b % kExportStep != 0) continue;
+            le = "le=\"";
+            appendNumber(le, LatencyHistogram::bucketUpperMs(b) / 1000.0);
+            le += "\"";
+            writeSample(out, name + "_bucket", le, static_cast<double>(cumulative));
+        }
+        cumulative += h.buckets[LatencyHistogram::kBucketCount - 1];
+        writeSample(out, name + "_bucket", "le=\"+Inf\"", static_cast<double>(cumulative));
+        writeSample(out, name + "_sum", "", static_cast<double>(h.sumNs) / 1e9);
+        writeSample(out, name + "_count", "", static_cast<double>(cumulative));
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Process-wide performance counters for scraping by a metrics endpoint.
+// Every thread counts into a slot of its own, registered on its first count
+// and kept after the thread exits, so totals never go back. Only the owner
+// writes a slot, with relaxed atomic loads and stores: counting takes no
+// lock and shares no cache line with other threads. Scrapes sum the slots.
+class Metrics {
+public:
+    enum class Counter : std::uint8_t {
+        Frames,            // paint events that drew the view
+        Recenters,         // scene origin moves
+        PointerEvents,
+        WheelEvents,
+        KeyEvents,
+        DisplayListHits,   // strokes a Renderer replayed as compiled
+        DisplayListMisses, // strokes it had to compile or draw directly
+        ImageTileHits,
+        ImageTileMisses,
+        GlyphHits,
+        GlyphMisses,
+        Count
+    };
+    enum class Timing : std::uint8_t {
+        Paint,        // a paint event on the GUI thread
+        RenderFrame,  // a frame on the render thread
+        InputLatency, // input to the paint event that first shows it
+        Count
+    };
+
+    static void add(Counter c, std::uint64_t n = 1);
+    static void record(Timing t, std::int64_t ns);
+    // Summed over threads.
+    static std::uint64_t total(Counter c);
+
+    // Appends every counter and timing in the Prometheus text format
+    // (0.0.4), named cancans_*; timings become histograms in seconds.
+    static void writePrometheus(std::string& out);
+    // Helpers for gauges sampled by the caller. labels is empty or a
+    // comma-separated list such as cache="scene.strokes".
+    static void writeHeader(std::string& out, std::string_view name, std::string_view type, std::string_view help);
+    static void writeSample(std::string& out, std::string_view name, std::string_view labels, double value);
+    // Escapes a label value for use between double quotes.
+    static std::string labelValue(std::string_view v);
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+// Minimal fork-join helpers for bulk work (imports, index rebuilds). Work
+// smaller than minChunk per thread stays on the calling thread.
+
+inline std::size_t parallelWorkers(std::size_t count, std::size_t minChunk) {
+    const std::size_t hw = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    return std::clamp<std::size_t>(count / std::max<std::size_t>(1, minChunk), 1, hw);
+}
+
+// Calls fn(begin, end) on disjoint ranges covering [0, count).
+template <typename Fn>
+void parallelFor(std::size_t count, std::size_t minChunk, Fn&& fn) {
+    const std::size_t workers = parallelWorkers(count, minChunk);
+    if (workers <= 1) {
+        if (count > 0) fn(std::size_t{0}, count);
+        return;
+    }
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    const std::size_t step = (count + workers - 1) / workers;
+    for (std::size_t w = 1; w < workers; ++w) {
+        const std::size_t begin = std::min(count, w * step);
+        const std::size_t end = std::min(count, begin + step);
+        if (begin < end) threads.emplace_back([&fn, begin, end]() { fn(begin, end); });
+    }
+    fn(std::size_t{0}, std::min(count, step));
+    for (auto& t : threads) t.join();
+}
+
+// Sorts chunks concurrently, then merges them pairwise, each round in parallel.
+template <typename It, typename Less>
+void parallelSort(It first, It last, Less less, std::size_t minChunk = 1 << 14) {
+    const auto count = static_cast<std::size_t>(std::distance(first, last));
+    const std::size_t workers = parallelWorkers(count, minChunk);
+    if (workers <= 1) {
+        std::sort(first, last, less);
+        return;
+    }
+    const std::size_t step = (count + workers - 1) / workers;
+    std::vector<std::size_t> bounds;
+    for (std::size_t b = 0; b < count; b += step) bounds.push_back(b);
+    bounds.push_back(count);
+
+    auto at = [first](std::size_t i) { return first + static_cast<std::ptrdiff_t>(i); };
+    parallelFor(bounds.size() - 1, 1, [&](std::size_t b, std::size_t e) {
+        for (std::size_t i = b; i < e; ++i) std::sort(at(bounds[i]), at(bounds[i + 1]), less);
+    });
+    while (bounds.size() > 2) {
+        std::vector<std::size_t> merged;
+        const std::size_t pairs = (bounds.size() - 1) / 2;
+        parallelFor(pairs, 1, [&](std::size_t b, std::size_t e) {
+            for (std::size_t p = b; p < e; ++p) {
+                std::inplace_merge(at(bounds[2 * p]), at(bounds[2 * p + 1]), at(bounds[2 * p + 2]), less);
+            }
+        });
+        for (std::size_t i = 0; i < bounds.size(); i += 2) merged.push_back(bounds[i]);
+        if (merged.back() != count) merged.push_back(count);
+        bounds.swap(merged);
+    }
+}
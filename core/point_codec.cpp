@@ -0,0 +1,55 @@
+#include "point_codec.hpp"
+#include "varint.hpp"
+#include <cmath>
+
+namespace {
+// Keep grid coordinates well inside the exactly representable double range.
+constexpr double kMaxGridCoord = 4503599627370496.0; // 2^52
+
+bool toGrid(double v, double anchor, double quantum, std::int64_t& q) {
+    const double r = std::round((v - anchor) / quantum);
+    if (!std::isfinite(r) || std::fabs(r) > kMaxGridCoord) return false;
+    q = static_cast<std::int64_t>(r);
+    return true;
+}
+
+bool onGrid(std::int64_t q) {
+    constexpr auto kMax = static_cast<std::int64_t>(kMaxGridCoord);
+    return q >= -kMax && q <= kMax;
+}
+}
+
+PointQuantizer::PointQuantizer(const Vec2& anchor, double quantum)
+    : anchor_(anchor)
+    , quantum_(quantum > 0.0 && std::isfinite(quantum) ? quantum : 1.0) {}
+
+double PointQuantizer::quantumForWidthExp(double widthExp, int bitsPerWidth) {
+    return std::exp2(widthExp - bitsPerWidth);
+}
+
+bool PointQuantizer::encode(const Vec2& p, std::vector<std::uint8_t>& out) {
+    std::int64_t qx = 0, qy = 0;
+    if (!toGrid(p.x, anchor_.x, quantum_, qx) || !toGrid(p.y, anchor_.y, quantum_, qy)) {
+        return false;
+    }
+    putVarint(out, zigzag(qx - qx_));
+    putVarint(out, zigzag(qy - qy_));
+    qx_ = qx;
+    qy_ = qy;
+    return true;
+}
+
+bool PointQuantizer::decode(const std::uint8_t*& p, const std::uint8_t* end, Vec2& out) {
+    std::uint64_t dx = 0, dy = 0;
+    if (!getVarint(p, end, dx) || !getVarint(p, end, dy)) return false;
+    // Corrupt or hostile input may carry any delta: add with wrap-around,
+    // then refuse what no encoder could have produced.
+    const auto qx = static_cast<std::int64_t>(static_cast<std::uint64_t>(qx_) + static_cast<std::uint64_t>(unzigzag(dx)));
+    const auto qy = static_cast<std::int64_t>(static_cast<std::uint64_t>(qy_) + static_cast<std::uint64_t>(unzigzag(dy)));
+    if (!onGrid(qx) || !onGrid(qy)) return false;
+    qx_ = qx;
+    qy_ = qy;
+    out = Vec2{anchor_.x + static_cast<double>(qx_) * quantum_,
+               anchor_.y + static_cast<double>(qy_) * quantum_};
+    return true;
+}
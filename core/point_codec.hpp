@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "types.hpp"
+
+// Delta + zigzag varint coding of points snapped to a grid anchored at the
+// first point. The grid step follows the stroke width, so precision is
+// relative to the ink and independent of where on the board it lives.
+class PointQuantizer {
+public:
+    PointQuantizer() = default;
+    PointQuantizer(const Vec2& anchor, double quantum);
+
+    // Grid step of 2^-bitsPerWidth stroke widths.
+    static double quantumForWidthExp(double widthExp, int bitsPerWidth);
+
+    // Appends p as a delta against the previously coded point. Returns false
+    // (and writes nothing) when p is too far from the anchor for the grid.
+    bool encode(const Vec2& p, std::vector<std::uint8_t>& out);
+    bool decode(const std::uint8_t*& p, const std::uint8_t* end, Vec2& out);
+
+    const Vec2& anchor() const { return anchor_; }
+    double quantum() const { return quantum_; }
+
+private:
+    Vec2 anchor_;
+    double quantum_{1.0};
+    std::int64_t qx_{0};
+    std::int64_t qy_{0};
+};
@@ -0,0 +1,95 @@
+#include "polyline_cut.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Cut segments are walked in steps of this fraction of the radius, so a
+// cut end lands at most that far from the capsule edge.
+constexpr double kStepOfRadius = 0.25;
+constexpr int kMaxStepsPerSegment = 1024;
+
+double dot(const Vec2& a, const Vec2& b) { return a.x * b.x + a.y * b.y; }
+double cross(const Vec2& a, const Vec2& b) { return a.x * b.y - a.y * b.x; }
+
+double distSqPointSegment(const Vec2& p, const Vec2& a, const Vec2& b) {
+    const Vec2 ab = b - a;
+    const Vec2 ap = p - a;
+    const double len = dot(ab, ab);
+    const double t = len > 0.0 ? std::clamp(dot(ap, ab) / len, 0.0, 1.0) : 0.0;
+    const Vec2 d{ap.x - ab.x * t, ap.y - ab.y * t};
+    return dot(d, d);
+}
+
+double distSqSegments(const Vec2& p, const Vec2& q, const Vec2& a, const Vec2& b) {
+    const Vec2 pq = q - p;
+    const Vec2 ab = b - a;
+    const double d1 = cross(pq, a - p), d2 = cross(pq, b - p);
+    const double d3 = cross(ab, p - a), d4 = cross(ab, q - a);
+    if (((d1 > 0.0 && d2 < 0.0) || (d1 < 0.0 && d2 > 0.0)) && ((d3 > 0.0 && d4 < 0.0) || (d3 < 0.0 && d4 > 0.0))) {
+        return 0.0;
+    }
+    return std::min({distSqPointSegment(p, a, b), distSqPointSegment(q, a, b),
+                     distSqPointSegment(a, p, q), distSqPointSegment(b, p, q)});
+}
+
+Vec2 lerp(const Vec2& a, const Vec2& b, double t) {
+    return {a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t};
+}
+}
+
+bool cutPolyline(const std::vector<Vec2>& pts, const Capsule& capsule, double grow,
+                 std::vector<std::vector<Vec2>>& spans) {
+    if (pts.empty()) return false;
+    const double r = capsule.radius + grow;
+    const double rSq = r * r;
+    auto inside = [&](const Vec2& p) { return distSqPointSegment(p, capsule.a, capsule.b) < rSq; };
+
+    // Most candidates from the index only come near the eraser; check before copying.
+    bool hit = inside(pts[0]);
+    for (std::size_t j = 1; j < pts.size() && !hit; ++j) {
+        hit = distSqSegments(pts[j - 1], pts[j], capsule.a, capsule.b) < rSq;
+    }
+    if (!hit) return false;
+
+    std::vector<Vec2> current;
+    auto emit = [&](const Vec2& p) {
+        if (current.empty() || !(current.back() == p)) current.push_back(p);
+    };
+    auto close = [&]() {
+        if (current.size() >= 2) spans.push_back(std::move(current));
+        current.clear();
+    };
+
+    bool prevIn = inside(pts[0]);
+    if (!prevIn) emit(pts[0]);
+    const double step = std::max(r * kStepOfRadius, 1e-12);
+    for (std::size_t j = 1; j < pts.size(); ++j) {
+        const Vec2& q = pts[j - 1];
+        const Vec2& p = pts[j];
+        const bool pIn = inside(p);
+        if (!prevIn && !pIn && distSqSegments(q, p, capsule.a, capsule.b) >= rSq) {
+            emit(p);
+            continue;
+        }
+
+        // The segment enters or leaves the capsule: find where by walking it.
+        const double len = std::hypot(p.x - q.x, p.y - q.y);
+        const int steps = std::clamp(static_cast<int>(std::ceil(len / step)), 1, kMaxStepsPerSegment);
+        Vec2 last = q;
+        for (int k = 1; k <= steps; ++k) {
+            const Vec2 x = k == steps ? p : lerp(q, p, static_cast<double>(k) / steps);
+            const bool xIn = k == steps ? pIn : inside(x);
+            if (prevIn && !xIn) {
+                emit(x);
+            } else if (!prevIn && xIn) {
+                emit(last);
+                close();
+            }
+            prevIn = xIn;
+            last = x;
+        }
+        if (!pIn) emit(p);
+    }
+    close();
+    return true;
+}
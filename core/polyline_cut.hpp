@@ -0,0 +1,20 @@
+#pragma once
+#include <vector>
+#include "types.hpp"
+
+// The area swept by a round eraser moving from a to b.
+struct Capsule {
+    Vec2 a;
+    Vec2 b;
+    double radius = 0.0;
+
+    Rect bounds() const { return Rect(a.x, a.y, b.x, b.y).inflated(radius); }
+};
+
+// Removes the parts of a polyline within the capsule grown by `grow` (half
+// the ink width, so anything the eraser touches goes). The remaining pieces
+// are appended to spans, each with at least two points, in order. Returns
+// false and leaves spans alone when the capsule misses the polyline. Cost
+// is linear in the points plus the length of the segments that are cut.
+bool cutPolyline(const std::vector<Vec2>& pts, const Capsule& capsule, double grow,
+                 std::vector<std::vector<Vec2>>& spans);
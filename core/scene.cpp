@@ -1,30 +1,409 @@
 #include "scene.hpp"
 #include "camera.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <cmath>
 
-void Scene::beginStroke(double brushPx, std::uint32_t colorRGB, const Camera& cam) {
+namespace {
+constexpr std::size_t kMinPendingForRebuild = 256;
+constexpr std::size_t kMinStrokesPerWorker = 256;
+
+// What a thawed stroke holds beyond its cold copy: points and LOD levels.
+std::size_t hotBytes(const Stroke& s) {
+    MemoryUsage geometry;
+    MemoryUsage lod;
+    s.memoryUsage(geometry, lod);
+    return geometry.reservedBytes + lod.reservedBytes;
+}
+}
+
+Scene::Scene() {
+    // Eviction may be requested from any thread; queue it for our own.
+    budgetClient_ = MemoryBudget::instance().registerClient("scene.thawed_strokes",
+        [this](MemoryBudget::Key key) {
+            std::lock_guard<std::mutex> lock(evictMutex_);
+            evicted_.push_back(key);
+        });
+    auto empty = std::make_shared<SceneSnapshot>();
+    empty->elements = std::make_shared<const ElementStore>();
+    published_.store(std::move(empty));
+}
+
+Scene::~Scene() {
+    MemoryBudget::instance().unregisterClient(budgetClient_);
+}
+
+void Scene::beginStroke(double brushPx, std::uint32_t colorRGB, const Camera& cam, BrushKind brush) {
     if (drawing_) return;
-    strokes_.emplace_back();
-    strokes_.back().begin(brushPx, colorRGB, cam);
+    ++revision_;
+    Stroke& s = strokes_.emplace_back();
+    s.begin(brushPx, colorRGB, cam);
+    s.setBrush(brush);
+    active_ = strokes_.size() - 1;
     drawing_ = true;
 }
 
-void Scene::addScreenPoint(double sx, double sy, const Camera& cam) {
-    if (!drawing_ || strokes_.empty()) return;
-    strokes_.back().addScreenPoint(sx, sy, cam, /*minStepPx=*/1.5);
+void Scene::addScreenPoint(double sx, double sy, const Camera& cam, std::int64_t inputTimeNs) {
+    if (!drawing_ || active_ >= strokes_.size()) return;
+    ++revision_;
+    if (inputTimeNs != 0 && inputStampNs_ == 0) inputStampNs_ = inputTimeNs;
+    Stroke& s = strokes_.mutate(active_);
+    const std::size_t before = s.pointCount();
+    s.addScreenPoint(sx, sy, cam, /*minStepPx=*/1.5);
+    pointCount_ += s.pointCount() - before;
+    s.markUsed(frame_);
+    markIndexDirty(active_);
 }
 
 void Scene::endStroke() {
-    if (!drawing_ || strokes_.empty()) return;
-    strokes_.back().finish();
-    if (strokes_.back().empty()) {
+    if (!drawing_ || active_ >= strokes_.size()) return;
+    ++revision_;
+    Stroke& s = strokes_.mutate(active_);
+    pointCount_ -= s.pointCount();
+    s.finish(/*buildLevels=*/false);
+    pointCount_ += s.pointCount();
+    // Remote strokes may have been opened after ours; only drop an empty
+    // stroke when that does not shift anyone else's index.
+    if (strokes_[active_].empty() && active_ + 1 == strokes_.size()) {
         strokes_.pop_back();
+        if (active_ < index_.indexedCount()) indexStale_ = true;
+        if (indexBuilding_ && active_ < indexBuildSize_) indexBuildBroken_ = true;
+    } else {
+        lodPending_.push_back(active_);
     }
     drawing_ = false;
 }
 
+void Scene::publish() {
+    const auto current = published_.load(std::memory_order_relaxed);
+    if (current->revision == revision_ && current->origin == origin_) return;
+    auto snap = std::make_shared<SceneSnapshot>();
+    snap->revision = revision_;
+    snap->origin = origin_;
+    snap->strokes = strokes_;
+    snap->elements = current->elements->revision() == elements_.revision()
+        ? current->elements
+        : std::make_shared<const ElementStore>(elements_);
+    published_.store(std::move(snap), std::memory_order_release);
+}
+
+std::int64_t Scene::takeInputStamp() {
+    const std::int64_t stamp = inputStampNs_;
+    inputStampNs_ = 0;
+    return stamp;
+}
+
 void Scene::translate(const Vec2& delta) {
     if (delta.x == 0.0 && delta.y == 0.0) return;
-    for (auto& stroke : strokes_) {
-        stroke.translate(delta);
+    ++revision_;
+    // Every stroke moves, so every chunk shared with a snapshot is copied.
+    for (std::size_t i = 0; i < strokes_.size(); ++i) {
+        strokes_.mutate(i).translate(delta);
+    }
+    index_.translate(delta);
+    if (indexBuilding_) indexBuildShift_ += delta;
+    elements_.translate(delta);
+    origin_ += delta;
+}
+
+std::size_t Scene::openStroke(double widthExp, std::uint32_t colorRGB) {
+    ++revision_;
+    strokes_.emplace_back().beginWorld(widthExp, colorRGB);
+    return strokes_.size() - 1;
+}
+
+void Scene::appendWorldPoint(std::size_t index, const Vec2& w) {
+    if (index >= strokes_.size()) return;
+    ++revision_;
+    strokes_.mutate(index).addWorldPoint(w);
+    ++pointCount_;
+    markIndexDirty(index);
+}
+
+void Scene::closeStroke(std::size_t index) {
+    if (index >= strokes_.size()) return;
+    ++revision_;
+    Stroke& s = strokes_.mutate(index);
+    pointCount_ -= s.pointCount();
+    s.finish(/*buildLevels=*/false);
+    pointCount_ += s.pointCount();
+    lodPending_.push_back(index);
+}
+
+void Scene::setStrokeBrush(std::size_t index, BrushKind brush) {
+    if (index >= strokes_.size() || strokes_[index].brush() == brush) return;
+    ++revision_;
+    strokes_.mutate(index).setBrush(brush);
+}
+
+Rect Scene::erase(const Capsule& capsule) {
+    Rect damaged;
+    if (drawing_) return damaged;
+
+    eraseCandidates_.clear();
+    queryRect(capsule.bounds(), eraseCandidates_);
+    for (std::size_t i : eraseCandidates_) {
+        const Stroke& old = strokes_[i];
+        const double halfWidth = 0.5 * std::exp2(old.widthExp());
+        eraseSpans_.clear();
+        if (!cutPolyline(old.pointsWorld(eraseScratch_), capsule, halfWidth, eraseSpans_)) continue;
+
+        damaged.expand(capsule.bounds().inflated(halfWidth));
+        releaseCharge(old);
+        pointCount_ -= old.pointCount();
+        const double widthExp = old.widthExp();
+        const std::uint32_t color = old.colorRGB();
+        const BrushKind brush = old.brush();
+        const std::size_t slot = old.drawSlot(i);
+        Stroke& s = strokes_.mutate(i);
+        s.assignWorld(widthExp, color, eraseSpans_.empty() ? std::vector<Vec2>{} : std::move(eraseSpans_[0]));
+        s.finish(/*buildLevels=*/false);
+        s.markUsed(frame_);
+        pointCount_ += s.pointCount();
+        markIndexDirty(i);
+        lodPending_.push_back(i);
+        for (std::size_t k = 1; k < eraseSpans_.size(); ++k) {
+            Stroke& piece = strokes_.emplace_back();
+            piece.assignWorld(widthExp, color, std::move(eraseSpans_[k]));
+            piece.setBrush(brush);
+            piece.setDrawSlot(slot);
+            splitPieces_ = true;
+            piece.finish(/*buildLevels=*/false);
+            piece.markUsed(frame_);
+            pointCount_ += piece.pointCount();
+            lodPending_.push_back(strokes_.size() - 1);
+        }
+    }
+    if (!damaged.empty()) ++revision_;
+    return damaged;
+}
+
+ElementStore::Id Scene::addShape(const Shape& shape, const ElementStyle& style) {
+    ++revision_;
+    return elements_.addShape(shape, style, static_cast<std::uint32_t>(strokes_.size()));
+}
+
+ElementStore::Id Scene::addImage(const ImageElement& image) {
+    ++revision_;
+    return elements_.addImage(image, static_cast<std::uint32_t>(strokes_.size()));
+}
+
+ElementStore::Id Scene::addText(const TextElement& text) {
+    ++revision_;
+    return elements_.addText(text, static_cast<std::uint32_t>(strokes_.size()));
+}
+
+bool Scene::removeElement(ElementStore::Id id) {
+    if (!elements_.remove(id)) return false;
+    ++revision_;
+    return true;
+}
+
+std::size_t Scene::addStrokes(std::vector<StrokeData>&& data) {
+    const std::size_t first = strokes_.size();
+    data.erase(std::remove_if(data.begin(), data.end(),
+                              [](const StrokeData& d) { return d.points.size() < 2; }),
+               data.end());
+    if (data.empty()) return first;
+
+    for (const StrokeData& d : data) pointCount_ += d.points.size();
+    strokes_.resize(first + data.size());
+    parallelFor(data.size(), kMinStrokesPerWorker, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            Stroke& s = strokes_.mutate(first + i);
+            s.assignWorld(data[i].widthExp, data[i].colorRGB, std::move(data[i].points));
+            s.finish();
+            s.markUsed(frame_);
+        }
+    });
+    data.clear();
+
+    ++revision_;
+    rebuildIndex();
+    return first;
+}
+
+void Scene::ensureIndex() {
+    const std::size_t pending = index_.pendingCount(strokes_.size());
+    if (indexStale_ || pending > std::max(kMinPendingForRebuild, index_.indexedCount() / 8)) rebuildIndex();
+}
+
+std::size_t Scene::indexPendingCount() const {
+    return indexStale_ ? strokes_.size() : index_.pendingCount(strokes_.size());
+}
+
+void Scene::rebuildIndex() {
+    index_.rebuild(strokes_);
+    indexStale_ = false;
+    if (drawing_) index_.markDirty(active_);
+}
+
+void Scene::markIndexDirty(std::size_t index) {
+    index_.markDirty(index);
+    // Points arrive one at a time; log each stroke once per run of them.
+    if (!indexBuilding_ || index >= indexBuildSize_) return;
+    if (indexBuildDirty_.empty() || indexBuildDirty_.back() != index) indexBuildDirty_.push_back(index);
+}
+
+void Scene::beginIndexBuild(IndexBuild& build) {
+    build.strokes = strokes_;
+    build.index.clear();
+    build.serial = ++indexBuildSerial_;
+    indexBuilding_ = true;
+    indexBuildBroken_ = false;
+    indexBuildSize_ = strokes_.size();
+    indexBuildDirty_.clear();
+    indexBuildShift_ = Vec2{0.0, 0.0};
+}
+
+bool Scene::finishIndexBuild(IndexBuild& build) {
+    build.strokes.clear(); // stop sharing, so our writes stop copying
+    if (build.serial != indexBuildSerial_ || !indexBuilding_) return false;
+    indexBuilding_ = false;
+    if (indexBuildBroken_ || strokes_.size() < indexBuildSize_) return false;
+    build.index.translate(indexBuildShift_);
+    for (std::size_t i : indexBuildDirty_) build.index.markDirty(i);
+    std::vector<std::size_t>().swap(indexBuildDirty_);
+    index_ = std::move(build.index);
+    indexStale_ = false;
+    if (drawing_) index_.markDirty(active_);
+    return true;
+}
+
+std::size_t Scene::buildPendingLod(std::size_t maxStrokes) {
+    for (std::size_t n = 0; n < maxStrokes && !lodPending_.empty(); ++n) {
+        const std::size_t i = lodPending_.back();
+        lodPending_.pop_back();
+        if (i >= strokes_.size() || (drawing_ && i == active_) || strokes_[i].empty()) continue;
+        if (strokes_[i].lodLevelCount() > 0) continue; // queued twice
+        // Building would thaw it uncharged; markVisible queues it again
+        // when it thaws.
+        if (strokes_[i].isCold()) continue;
+        Stroke& s = strokes_.mutate(i);
+        s.buildLod();
+        if (charged_.count(s.id())) MemoryBudget::instance().charge(budgetClient_, s.id(), hotBytes(s));
+    }
+    return lodPending_.size();
+}
+
+void Scene::memoryUsage(MemoryReport& report) const {
+    MemoryUsage geometry;
+    MemoryUsage lod;
+    for (const Stroke& s : strokes_) s.memoryUsage(geometry, lod);
+    report.add("scene.stroke_list", strokes_.memoryUsage());
+    report.add("scene.points", geometry);
+    report.add("scene.lod", lod);
+    report.add("scene.index", index_.memoryUsage());
+    report.add("scene.elements", elements_.memoryUsage());
+
+    MemoryUsage scratch;
+    scratch.addVector(lodPending_);
+    scratch.addVector(eraseCandidates_);
+    scratch.addVector(eraseSpans_);
+    for (const auto& span : eraseSpans_) scratch.addVector(span);
+    scratch.addVector(eraseScratch_);
+    scratch.addMap(charged_);
+    scratch.addVector(touchedKeys_);
+    scratch.addVector(indexBuildDirty_);
+    report.add("scene.scratch", scratch);
+}
+
+void Scene::queryRect(const Rect& worldRect, std::vector<std::size_t>& out) {
+    ensureIndex();
+    const std::size_t first = out.size();
+    index_.query(strokes_, worldRect, out);
+    if (splitPieces_) strokes_.sortDrawOrder(out.begin() + static_cast<std::ptrdiff_t>(first), out.end());
+}
+
+void Scene::queryVisible(const Rect& worldRect, std::vector<std::size_t>& out) {
+    ++frame_;
+    applyEvictions();
+    const std::size_t first = out.size();
+    queryRect(worldRect, out);
+    markVisible(out, first);
+}
+
+void Scene::queryVisible(const std::vector<Rect>& areas, std::size_t from, const Rect& worldRect,
+                         std::vector<std::size_t>& out) {
+    ++frame_;
+    applyEvictions();
+    const std::size_t first = out.size();
+    for (const Rect& r : areas) queryRect(r, out);
+    // queryRect() brought the index up to date.
+    if (areas.empty()) ensureIndex();
+    index_.query(strokes_, worldRect, out, from);
+    const auto begin = out.begin() + static_cast<std::ptrdiff_t>(first);
+    std::sort(begin, out.end());
+    out.erase(std::unique(begin, out.end()), out.end());
+    if (splitPieces_) strokes_.sortDrawOrder(out.begin() + static_cast<std::ptrdiff_t>(first), out.end());
+    markVisible(out, first);
+}
+
+void Scene::markVisible(const std::vector<std::size_t>& out, std::size_t first) {
+    auto& budget = MemoryBudget::instance();
+    touchedKeys_.clear();
+    for (std::size_t k = first; k < out.size(); ++k) {
+        const std::size_t i = out[k];
+        const Stroke& s = strokes_[i];
+        s.markUsed(frame_);
+        if (s.isCold()) {
+            // Thaw now rather than in the middle of painting. Snapshots keep
+            // sharing the cold copy; only the live scene gets the points.
+            Stroke& hot = strokes_.mutate(i);
+            hot.thaw();
+            budget.charge(budgetClient_, hot.id(), hotBytes(hot));
+            charged_[hot.id()] = i;
+            // Freezing dropped the LOD; it is charged too once rebuilt.
+            lodPending_.push_back(i);
+        } else if (charged_.count(s.id())) {
+            touchedKeys_.push_back(s.id());
+        }
+    }
+    for (MemoryBudget::Key key : touchedKeys_) budget.touch(budgetClient_, key);
+}
+
+std::size_t Scene::compactColdStrokes(std::uint64_t idleFrames, std::size_t maxVisits) {
+    if (strokes_.empty()) return 0;
+    std::size_t frozen = 0;
+    const std::size_t visits = std::min(maxVisits, strokes_.size());
+    for (std::size_t n = 0; n < visits; ++n) {
+        if (compactCursor_ >= strokes_.size()) compactCursor_ = 0;
+        const std::size_t i = compactCursor_++;
+        if (drawing_ && i == active_) continue;
+        const Stroke& s = strokes_[i];
+        if (s.isCold() || frame_ - s.lastUsed() <= idleFrames) continue;
+        if (refreeze(i)) ++frozen;
+    }
+    applyEvictions();
+    return frozen;
+}
+
+bool Scene::refreeze(std::size_t index) {
+    if (strokes_[index].isCold() || !strokes_.mutate(index).freeze()) return false;
+    releaseCharge(strokes_[index]);
+    return true;
+}
+
+void Scene::releaseCharge(const Stroke& s) {
+    if (charged_.erase(s.id()) == 0) return;
+    MemoryBudget::instance().release(budgetClient_, s.id());
+}
+
+void Scene::applyEvictions() {
+    std::vector<MemoryBudget::Key> evicted;
+    {
+        std::lock_guard<std::mutex> lock(evictMutex_);
+        evicted.swap(evicted_);
+    }
+    for (MemoryBudget::Key id : evicted) {
+        const auto found = charged_.find(id);
+        if (found == charged_.end()) continue;
+        const std::size_t i = found->second;
+        charged_.erase(found);
+        if (i >= strokes_.size() || strokes_[i].id() != id || (drawing_ && i == active_)) continue;
+        // Strokes on screen right now stay hot; they get charged again when
+        // the next viewport query finds them cold.
+        if (strokes_[i].lastUsed() == frame_) continue;
+        if (!strokes_[i].isCold()) strokes_.mutate(i).freeze();
     }
 }
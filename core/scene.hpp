@@ -1,22 +1,191 @@
 #pragma once
 #include <vector>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "element_store.hpp"
 #include "elements/stroke.hpp"
+#include "memory_budget.hpp"
+#include "memory_usage.hpp"
+#include "polyline_cut.hpp"
+#include "stroke_index.hpp"
+#include "stroke_list.hpp"
 
 class Camera;
 
+// One stroke for Scene::addStrokes, already in scene-local world units.
+struct StrokeData {
+    double widthExp = 0.0; // log2(width_world)
+    std::uint32_t colorRGB = 0xFFFFFF;
+    std::vector<Vec2> points;
+};
+
+// The scene as of one Scene::publish(), for readers on other threads.
+// Immutable, and shares its stroke chunks and strokes with the live scene
+// and with older snapshots.
+struct SceneSnapshot {
+    std::uint64_t revision = 0;
+    Vec2 origin;
+    StrokeList strokes;
+    std::shared_ptr<const ElementStore> elements;
+};
+
 class Scene {
 public:
-    Scene() = default;
+    Scene();
+    ~Scene();
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
 
-    void beginStroke(double brushPx, std::uint32_t colorRGB, const Camera& cam);
-    void addScreenPoint(double sx, double sy, const Camera& cam);
+    void beginStroke(double brushPx, std::uint32_t colorRGB, const Camera& cam, BrushKind brush = BrushKind::Pen);
+    // inputTimeNs is the steady-clock time the input event arrived; the
+    // oldest one not yet taken is handed to the frame that shows it.
+    void addScreenPoint(double sx, double sy, const Camera& cam, std::int64_t inputTimeNs = 0);
     void endStroke();
     void translate(const Vec2& delta);
 
-    const std::vector<Stroke>& strokes() const { return strokes_; }
+    // World-space mutation path for strokes that arrive already built, e.g.
+    // from a sync peer. Indices stay valid: strokes are never removed here.
+    std::size_t openStroke(double widthExp, std::uint32_t colorRGB);
+    void appendWorldPoint(std::size_t index, const Vec2& w);
+    void closeStroke(std::size_t index);
+    void setStrokeBrush(std::size_t index, BrushKind brush);
+
+    // Bulk path for imports: bounds, LOD and the spatial index are built on
+    // all cores and the strokes become visible in a single revision.
+    // Entries with fewer than two points are skipped. Returns the index of
+    // the first added stroke.
+    std::size_t addStrokes(std::vector<StrokeData>&& data);
+
+    // Partial erase: removes the ink under the capsule. A stroke cut in two
+    // or more keeps its first span in its own slot and the others are
+    // appended, drawing in the original's place (Stroke::drawSlot); a
+    // stroke erased completely is left empty, so indices stay valid.
+    // Returns the world area whose pixels changed (empty if none).
+    Rect erase(const Capsule& capsule);
+
+    // Shapes and other non-stroke elements; new ones draw above all strokes
+    // that exist when they are added.
+    ElementStore::Id addShape(const Shape& shape, const ElementStyle& style);
+    ElementStore::Id addImage(const ImageElement& image);
+    ElementStore::Id addText(const TextElement& text);
+    bool removeElement(ElementStore::Id id);
+    const ElementStore& elements() const { return elements_; }
+
+    const StrokeList& strokes() const { return strokes_; }
+    // Points of all strokes, kept up to date by every mutation, so reading
+    // it costs nothing, unlike memoryUsage().
+    std::size_t pointCount() const { return pointCount_; }
+
+    // Makes the current state the published snapshot unless it already is.
+    // Owner thread only; costs a pointer per chunk of strokes, plus an
+    // element copy when elements changed.
+    void publish();
+    // Any thread, without locks: the latest published snapshot.
+    std::shared_ptr<const SceneSnapshot> snapshot() const { return published_.load(std::memory_order_acquire); }
+    bool isDrawing() const { return drawing_; }
+    std::size_t activeIndex() const { return active_; }
+
+    // Oldest input timestamp applied since the last call (0 if none).
+    std::int64_t takeInputStamp();
+
+    // Heap held by the live scene, by subsystem. Walks every stroke, so it
+    // is for debug views and dumps rather than per frame; snapshots share
+    // most of it and are not counted again.
+    void memoryUsage(MemoryReport& report) const;
+
+    // Bumped by every mutation; cheap change detection for caches and snapshots.
+    std::uint64_t revision() const { return revision_; }
+
+    // Sum of all translate() deltas: local + origin() is stable across recenters.
+    Vec2 origin() const { return origin_; }
+
+    // Strokes whose ink bounds intersect worldRect, in draw order.
+    // Until an erase splits a stroke, that is index order.
+    void queryRect(const Rect& worldRect, std::vector<std::size_t>& out);
+    // Viewport query for rendering: counts as one frame, stamps the strokes as
+    // viewed and expands cold ones ahead of drawing.
+    void queryVisible(const Rect& worldRect, std::vector<std::size_t>& out);
+    // Same for a view partly drawn from a raster: strokes in any of areas,
+    // plus strokes from index `from` on anywhere in worldRect, in draw
+    // order without repeats.
+    void queryVisible(const std::vector<Rect>& areas, std::size_t from, const Rect& worldRect,
+                      std::vector<std::size_t>& out);
+    // Compresses strokes not viewed for idleFrames frames. Resumes where the
+    // previous call stopped and looks at no more than maxVisits strokes.
+    // Also refreezes strokes the memory budget evicted since the last call.
+    std::size_t compactColdStrokes(std::uint64_t idleFrames, std::size_t maxVisits);
+
+    // Derived data deferred off the input path, for idle-time jobs.
+    // Strokes finished by hand or by a sync peer, and erase pieces, get
+    // their LOD here; returns how many strokes are still waiting.
+    std::size_t buildPendingLod(std::size_t maxStrokes);
+    std::size_t lodPendingCount() const { return lodPending_.size(); }
+    // Strokes that queries answer by linear scan until the next rebuild.
+    std::size_t indexPendingCount() const;
+    void rebuildIndex();
+
+    // The same rebuild off the owner thread. beginIndexBuild() shares the
+    // strokes with the build, like a snapshot; any thread may then call
+    // build.index.rebuild(build.strokes). finishIndexBuild(), back on the
+    // owner thread, swaps the index in with the strokes changed meanwhile
+    // marked dirty; it returns false, dropping the build, if a newer one
+    // was begun or the strokes it saw were since removed.
+    struct IndexBuild {
+        StrokeList strokes;
+        StrokeIndex index;
+        std::uint64_t serial = 0;
+    };
+    void beginIndexBuild(IndexBuild& build);
+    bool finishIndexBuild(IndexBuild& build);
 
 private:
-    std::vector<Stroke> strokes_;
+    void ensureIndex();
+    void markIndexDirty(std::size_t index);
+    // Stamps out[first..] as viewed and thaws the cold ones.
+    void markVisible(const std::vector<std::size_t>& out, std::size_t first);
+    bool refreeze(std::size_t index);
+    void releaseCharge(const Stroke& s);
+    void applyEvictions();
+
+private:
+    StrokeList strokes_;
+    std::size_t pointCount_ = 0;
+    ElementStore elements_;
+    std::size_t active_ = 0;
     bool drawing_ = false;
+    Vec2 origin_{0.0, 0.0};
+    std::uint64_t revision_ = 0;
+    std::int64_t inputStampNs_ = 0;
+
+    StrokeIndex index_;
+    bool indexStale_ = true;
+    // The build begun last, while it runs: strokes changed since it
+    // shared them and the recenters it missed.
+    std::uint64_t indexBuildSerial_ = 0;
+    bool indexBuilding_ = false;
+    bool indexBuildBroken_ = false;
+    std::size_t indexBuildSize_ = 0;
+    std::vector<std::size_t> indexBuildDirty_;
+    Vec2 indexBuildShift_{0.0, 0.0};
+    std::uint64_t frame_ = 0;
+    std::size_t compactCursor_ = 0;
+    std::vector<std::size_t> lodPending_;
+    bool splitPieces_ = false; // some stroke draws outside index order
+    std::vector<std::size_t> eraseCandidates_;
+    std::vector<std::vector<Vec2>> eraseSpans_;
+    std::vector<Vec2> eraseScratch_;
+
+    std::atomic<std::shared_ptr<const SceneSnapshot>> published_;
+
+    // Strokes thawed by queryVisible() are charged to the global budget,
+    // keyed by Stroke::id(); charged_ maps the ids to current indices.
+    MemoryBudget::ClientId budgetClient_ = 0;
+    std::unordered_map<MemoryBudget::Key, std::size_t> charged_;
+    std::vector<MemoryBudget::Key> touchedKeys_;
+    std::mutex evictMutex_;
+    std::vector<MemoryBudget::Key> evicted_;
 };
@@ -0,0 +1,134 @@
+#include "scene_io.hpp"
+#include "point_codec.hpp"
+#include "scene.hpp"
+#include "varint.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace {
+constexpr std::uint8_t kMagic[4] = {'C', 'N', 'V', 'S'};
+// 2 added the brush kind after the colour; version 1 files load as pen ink.
+constexpr std::uint64_t kVersion = 2;
+constexpr int kQuantumBits = 8;
+
+enum class PointEncoding : std::uint8_t { Grid = 0, Raw = 1 };
+
+void writeStrokes(const StrokeList& strokes, std::vector<std::uint8_t>& out) {
+    out.insert(out.end(), std::begin(kMagic), std::end(kMagic));
+    putVarint(out, kVersion);
+
+    // In draw order, so pieces split off by an erase load in their place.
+    std::vector<std::size_t> order;
+    for (std::size_t i = 0; i < strokes.size(); ++i) {
+        if (!strokes[i].empty()) order.push_back(i);
+    }
+    strokes.sortDrawOrder(order.begin(), order.end());
+    putVarint(out, order.size());
+
+    std::vector<std::uint8_t> body;
+    std::vector<Vec2> scratch;
+    for (std::size_t i : order) {
+        const Stroke& s = strokes[i];
+        const auto& pts = s.pointsWorld(scratch);
+        putDouble(out, s.widthExp());
+        putVarint(out, s.colorRGB());
+        out.push_back(static_cast<std::uint8_t>(s.brush()));
+        putVarint(out, pts.size());
+        putDouble(out, pts[0].x);
+        putDouble(out, pts[0].y);
+
+        body.clear();
+        PointQuantizer q(pts[0], PointQuantizer::quantumForWidthExp(s.widthExp(), kQuantumBits));
+        bool grid = true;
+        for (std::size_t i = 1; i < pts.size() && grid; ++i) {
+            grid = q.encode(pts[i], body);
+        }
+        if (grid) {
+            out.push_back(static_cast<std::uint8_t>(PointEncoding::Grid));
+            out.insert(out.end(), body.begin(), body.end());
+        } else {
+            out.push_back(static_cast<std::uint8_t>(PointEncoding::Raw));
+            for (std::size_t i = 1; i < pts.size(); ++i) {
+                putDouble(out, pts[i].x);
+                putDouble(out, pts[i].y);
+            }
+        }
+    }
+}
+
+bool writeFile(const std::vector<std::uint8_t>& bytes, const std::string& path) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    if (!f) return false;
+    f.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(f);
+}
+}
+
+void writeScene(const Scene& scene, std::vector<std::uint8_t>& out) {
+    writeStrokes(scene.strokes(), out);
+}
+
+void writeScene(const SceneSnapshot& snapshot, std::vector<std::uint8_t>& out) {
+    writeStrokes(snapshot.strokes, out);
+}
+
+bool readScene(const std::uint8_t*& p, const std::uint8_t* end, Scene& scene) {
+    if (end - p < 4 || !std::equal(std::begin(kMagic), std::end(kMagic), p)) return false;
+    p += 4;
+    std::uint64_t version = 0, count = 0;
+    if (!getVarint(p, end, version) || version < 1 || version > kVersion) return false;
+    if (!getVarint(p, end, count)) return false;
+
+    for (std::uint64_t n = 0; n < count; ++n) {
+        double widthExp = 0.0;
+        std::uint64_t color = 0, points = 0;
+        BrushKind brush = BrushKind::Pen;
+        Vec2 first;
+        if (!getDouble(p, end, widthExp) || !getVarint(p, end, color)) return false;
+        if (version >= 2) {
+            if (p >= end || *p >= kBrushKindCount) return false;
+            brush = static_cast<BrushKind>(*p++);
+        }
+        if (!getVarint(p, end, points) ||
+            !getDouble(p, end, first.x) || !getDouble(p, end, first.y) || p >= end) {
+            return false;
+        }
+        const auto encoding = static_cast<PointEncoding>(*p++);
+
+        const std::size_t index = scene.openStroke(widthExp, static_cast<std::uint32_t>(color));
+        scene.setStrokeBrush(index, brush);
+        scene.appendWorldPoint(index, first);
+        PointQuantizer q(first, PointQuantizer::quantumForWidthExp(widthExp, kQuantumBits));
+        for (std::uint64_t i = 1; i < points; ++i) {
+            Vec2 w;
+            const bool ok = encoding == PointEncoding::Grid
+                ? q.decode(p, end, w)
+                : (getDouble(p, end, w.x) && getDouble(p, end, w.y));
+            if (!ok) return false;
+            scene.appendWorldPoint(index, w);
+        }
+        scene.closeStroke(index);
+    }
+    return true;
+}
+
+bool saveSceneFile(const Scene& scene, const std::string& path) {
+    std::vector<std::uint8_t> bytes;
+    writeScene(scene, bytes);
+    return writeFile(bytes, path);
+}
+
+bool saveSceneFile(const SceneSnapshot& snapshot, const std::string& path) {
+    std::vector<std::uint8_t> bytes;
+    writeScene(snapshot, bytes);
+    return writeFile(bytes, path);
+}
+
+bool loadSceneFile(const std::string& path, Scene& scene) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    const std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    const std::uint8_t* p = bytes.data();
+    return readScene(p, p + bytes.size(), scene);
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Scene;
+struct SceneSnapshot;
+
+// Compact binary board format. Points are stored like cold strokes: varint
+// deltas on a grid of 1/256 stroke width; strokes that do not fit the grid
+// are stored raw. Coordinates are the scene's local ones.
+void writeScene(const Scene& scene, std::vector<std::uint8_t>& out);
+// Same from a published snapshot, so saving can run on any thread.
+void writeScene(const SceneSnapshot& snapshot, std::vector<std::uint8_t>& out);
+// Appends the decoded strokes to scene. Returns false on malformed input.
+bool readScene(const std::uint8_t*& p, const std::uint8_t* end, Scene& scene);
+
+bool saveSceneFile(const Scene& scene, const std::string& path);
+bool saveSceneFile(const SceneSnapshot& snapshot, const std::string& path);
+bool loadSceneFile(const std::string& path, Scene& scene);
@@ -0,0 +1,56 @@
+#include "settled_strokes.hpp"
+#include "scene.hpp"
+#include <algorithm>
+#include <cmath>
+
+void SettledStrokes::clear() {
+    taken_.clear();
+    seen_.clear();
+}
+
+bool SettledStrokes::advance(const Scene& scene, std::size_t maxStrokes,
+                             const std::function<void(const Stroke&)>& take) {
+    const StrokeList& strokes = scene.strokes();
+    const Vec2 origin = scene.origin();
+    // Strokes after the one being drawn wait for it, so indices stay in order.
+    const std::size_t end = scene.isDrawing() ? std::min(strokes.size(), scene.activeIndex()) : strokes.size();
+    const std::size_t base = taken_.size();
+    std::vector<Shape> looked; // from the first stroke not taken
+    std::size_t i = base;
+    for (std::size_t visits = 0; i < end && visits < maxStrokes; ++i, ++visits) {
+        const Shape now = shape(strokes[i], origin);
+        const std::size_t k = i - base;
+        if (looked.empty() && k < seen_.size() && seen_[k] == now) {
+            take(strokes[i]);
+            taken_.push_back(now);
+        } else {
+            looked.push_back(now);
+        }
+    }
+    // Keep what the previous call saw beyond where this one stopped.
+    for (std::size_t k = i - base; k < seen_.size(); ++k) looked.push_back(seen_[k]);
+    seen_ = std::move(looked);
+    return i >= end;
+}
+
+bool SettledStrokes::unchanged(const StrokeList& strokes, const Vec2& origin, std::size_t i) const {
+    return i < strokes.size() && i < taken_.size() && shape(strokes[i], origin) == taken_[i];
+}
+
+bool SettledStrokes::sameBounds(const Rect& a, const Rect& b) {
+    if (a.empty() || b.empty()) return a.empty() == b.empty();
+    const double tol = 1e-9 * std::max({1.0, std::abs(a.minX), std::abs(a.maxX), std::abs(a.minY), std::abs(a.maxY)});
+    return std::abs(a.minX - b.minX) <= tol && std::abs(a.minY - b.minY) <= tol &&
+           std::abs(a.maxX - b.maxX) <= tol && std::abs(a.maxY - b.maxY) <= tol;
+}
+
+SettledStrokes::Shape SettledStrokes::shape(const Stroke& s, const Vec2& origin) {
+    return Shape{s.pointCount(), s.bounds().translated(origin)};
+}
+
+MemoryUsage SettledStrokes::memoryUsage() const {
+    MemoryUsage u;
+    u.addVector(taken_);
+    u.addVector(seen_);
+    return u;
+}
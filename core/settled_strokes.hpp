@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include "memory_usage.hpp"
+#include "types.hpp"
+
+class Scene;
+class Stroke;
+class StrokeList;
+
+// Hands a derived structure (an overview, a raster) the scene's strokes in
+// index order, each once its points have settled: a stroke is taken when
+// two calls a moment apart agree on its geometry, so remote strokes that
+// are still growing wait, and so does everything after the stroke being
+// drawn. Strokes that change after being taken are caught by unchanged().
+class SettledStrokes {
+public:
+    void clear();
+    // Strokes taken so far: [0, count()).
+    std::size_t count() const { return taken_.size(); }
+    // Strokes were seen that have not settled yet; call again later.
+    bool waiting() const { return !seen_.empty(); }
+
+    // Takes settled strokes, looking at no more than maxStrokes. Returns
+    // false if it stopped for the limit rather than at the last stroke or
+    // at one that is still changing.
+    bool advance(const Scene& scene, std::size_t maxStrokes, const std::function<void(const Stroke&)>& take);
+    // Stroke i, already taken, still has the points it was taken with.
+    bool unchanged(const StrokeList& strokes, const Vec2& origin, std::size_t i) const;
+
+    // Recentering moves the strokes by the origin change, so board bounds
+    // may differ in the last bits without the stroke having changed.
+    static bool sameBounds(const Rect& a, const Rect& b);
+
+    MemoryUsage memoryUsage() const;
+
+private:
+    // Changes whenever a stroke's points do; LOD and style changes and
+    // recentering leave it alone.
+    struct Shape {
+        std::size_t points = 0;
+        Rect bounds; // board units
+        bool operator==(const Shape& o) const { return points == o.points && sameBounds(bounds, o.bounds); }
+    };
+    static Shape shape(const Stroke& s, const Vec2& origin);
+
+    std::vector<Shape> taken_; // shape of each taken stroke, by index
+    std::vector<Shape> seen_;  // of the strokes after them, as last seen
+};
@@ -0,0 +1,144 @@
+#include "stroke_index.hpp"
+#include "stroke_list.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr std::size_t kFanout = 16;
+constexpr std::size_t kMinEntriesPerWorker = 1 << 14;
+}
+
+void StrokeIndex::clear() {
+    nodes_.clear();
+    entries_.clear();
+    dirty_.clear();
+    dirtyList_.clear();
+    indexed_ = 0;
+}
+
+void StrokeIndex::rebuild(const StrokeList& strokes) {
+    clear();
+    indexed_ = strokes.size();
+    dirty_.assign(indexed_, false);
+
+    entries_.resize(strokes.size());
+    parallelFor(strokes.size(), kMinEntriesPerWorker, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            entries_[i] = Entry{strokes[i].inkBounds(), static_cast<std::uint32_t>(i)};
+        }
+    });
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(), [](const Entry& e) { return e.box.empty(); }),
+                   entries_.end());
+    if (entries_.empty()) return;
+
+    // Sort-tile-recursive packing: vertical slabs by x, leaves by y within a slab.
+    const std::size_t leafCount = (entries_.size() + kFanout - 1) / kFanout;
+    const auto slabs = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(leafCount))));
+    const std::size_t slabSize = slabs * kFanout;
+    parallelSort(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) {
+        return a.box.minX + a.box.maxX < b.box.minX + b.box.maxX;
+    });
+    const std::size_t slabCount = (entries_.size() + slabSize - 1) / slabSize;
+    parallelFor(slabCount, std::max<std::size_t>(1, kMinEntriesPerWorker / slabSize), [&](std::size_t b, std::size_t e) {
+        for (std::size_t s = b * slabSize; s < std::min(entries_.size(), e * slabSize); s += slabSize) {
+            const auto first = entries_.begin() + static_cast<std::ptrdiff_t>(s);
+            const auto last = entries_.begin() + static_cast<std::ptrdiff_t>(std::min(entries_.size(), s + slabSize));
+            std::sort(first, last, [](const Entry& a, const Entry& b) {
+                return a.box.minY + a.box.maxY < b.box.minY + b.box.maxY;
+            });
+        }
+    });
+
+    nodes_.resize(leafCount);
+    parallelFor(leafCount, kMinEntriesPerWorker / kFanout, [&](std::size_t b, std::size_t e) {
+        for (std::size_t n = b; n < e; ++n) {
+            Node& leaf = nodes_[n];
+            leaf.leaf = true;
+            leaf.first = static_cast<std::uint32_t>(n * kFanout);
+            leaf.count = static_cast<std::uint32_t>(std::min(kFanout, entries_.size() - n * kFanout));
+            for (std::uint32_t k = 0; k < leaf.count; ++k) {
+                const Entry& entry = entries_[leaf.first + k];
+                leaf.box.expand(entry.box);
+                leaf.last = std::max(leaf.last, entry.index);
+            }
+        }
+    });
+
+    // Consecutive nodes are spatially coherent already; group them level by level.
+    std::size_t levelBegin = 0;
+    std::size_t levelEnd = nodes_.size();
+    while (levelEnd - levelBegin > 1) {
+        for (std::size_t n = levelBegin; n < levelEnd; n += kFanout) {
+            Node parent;
+            parent.first = static_cast<std::uint32_t>(n);
+            parent.count = static_cast<std::uint32_t>(std::min(kFanout, levelEnd - n));
+            for (std::uint32_t k = 0; k < parent.count; ++k) {
+                parent.box.expand(nodes_[n + k].box);
+                parent.last = std::max(parent.last, nodes_[n + k].last);
+            }
+            nodes_.push_back(parent);
+        }
+        levelBegin = levelEnd;
+        levelEnd = nodes_.size();
+    }
+}
+
+void StrokeIndex::markDirty(std::size_t index) {
+    if (index >= indexed_ || dirty_[index]) return;
+    dirty_[index] = true;
+    dirtyList_.push_back(static_cast<std::uint32_t>(index));
+}
+
+void StrokeIndex::translate(const Vec2& delta) {
+    const Vec2 shift{-delta.x, -delta.y};
+    for (auto& n : nodes_) n.box = n.box.translated(shift);
+    for (auto& e : entries_) e.box = e.box.translated(shift);
+}
+
+std::size_t StrokeIndex::pendingCount(std::size_t total) const {
+    return (total > indexed_ ? total - indexed_ : 0) + dirtyList_.size();
+}
+
+void StrokeIndex::query(const StrokeList& strokes, const Rect& r, std::vector<std::size_t>& out,
+                        std::size_t from) const {
+    const std::size_t before = out.size();
+
+    if (!nodes_.empty()) {
+        std::vector<std::uint32_t> stack;
+        stack.push_back(static_cast<std::uint32_t>(nodes_.size() - 1));
+        while (!stack.empty()) {
+            const Node& n = nodes_[stack.back()];
+            stack.pop_back();
+            if (n.last < from || !n.box.intersects(r)) continue;
+            if (n.leaf) {
+                for (std::uint32_t k = 0; k < n.count; ++k) {
+                    const Entry& e = entries_[n.first + k];
+                    if (e.index >= from && e.box.intersects(r) && !dirty_[e.index] && e.index < strokes.size()) {
+                        out.push_back(e.index);
+                    }
+                }
+            } else {
+                for (std::uint32_t k = 0; k < n.count; ++k) stack.push_back(n.first + k);
+            }
+        }
+    }
+
+    for (std::uint32_t i : dirtyList_) {
+        if (i >= from && i < strokes.size() && strokes[i].inkBounds().intersects(r)) out.push_back(i);
+    }
+    for (std::size_t i = std::max(indexed_, from); i < strokes.size(); ++i) {
+        if (strokes[i].inkBounds().intersects(r)) out.push_back(i);
+    }
+
+    std::sort(out.begin() + static_cast<std::ptrdiff_t>(before), out.end());
+}
+
+MemoryUsage StrokeIndex::memoryUsage() const {
+    MemoryUsage u;
+    u.addVector(nodes_);
+    u.addVector(entries_);
+    u.addVector(dirty_);
+    u.addVector(dirtyList_);
+    return u;
+}
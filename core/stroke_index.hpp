@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "memory_usage.hpp"
+#include "types.hpp"
+
+class StrokeList;
+
+// Static packed R-tree (sort-tile-recursive) over stroke ink bounds, plus a
+// linear tail for strokes appended or edited since the last build. Queries
+// stay exact: tail and dirty strokes are tested against their live bounds.
+class StrokeIndex {
+public:
+    void clear();
+    void rebuild(const StrokeList& strokes);
+
+    // The stroke's bounds changed after it was packed into the tree.
+    void markDirty(std::size_t index);
+    void translate(const Vec2& delta);
+
+    // Appends matching stroke indices in ascending (z) order, skipping
+    // strokes below index from; subtrees holding only those are not visited.
+    void query(const StrokeList& strokes, const Rect& r, std::vector<std::size_t>& out,
+               std::size_t from = 0) const;
+
+    std::size_t indexedCount() const { return indexed_; }
+    // Strokes currently answered by linear scan instead of the tree.
+    std::size_t pendingCount(std::size_t total) const;
+
+    MemoryUsage memoryUsage() const;
+
+private:
+    struct Node {
+        Rect box;
+        std::uint32_t first = 0; // child node or entry offset
+        std::uint32_t count = 0;
+        std::uint32_t last = 0;  // highest stroke index below
+        bool leaf = false;
+    };
+    struct Entry {
+        Rect box;
+        std::uint32_t index = 0;
+    };
+
+    std::vector<Node> nodes_;    // root is last
+    std::vector<Entry> entries_;
+    std::vector<bool> dirty_;    // sized indexed_
+    std::vector<std::uint32_t> dirtyList_;
+    std::size_t indexed_ = 0;
+};
@@ -0,0 +1,91 @@
+#include "stroke_list.hpp"
+#include <algorithm>
+#include <atomic>
+
+namespace {
+// Whether the owner may write through p in place. Only the owner adds
+// references to its chunks and strokes, so a count of 1 cannot grow behind
+// its back; a reader dropping its copy concurrently at worst causes one
+// needless copy. use_count() is a relaxed load, though: the fence pairs it
+// with the release decrement of the reader that dropped the last other
+// reference, so that reader's loads happen before our writes.
+template <class T>
+bool unshared(const std::shared_ptr<T>& p) {
+    if (p.use_count() > 1) return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+}
+}
+
+StrokeList::Chunk& StrokeList::ownChunk(std::size_t c) {
+    std::shared_ptr<Chunk>& chunk = chunks_[c];
+    if (!unshared(chunk)) chunk = std::make_shared<Chunk>(*chunk);
+    return *chunk;
+}
+
+Stroke& StrokeList::mutate(std::size_t i) {
+    std::shared_ptr<Stroke>& s = ownChunk(i >> kChunkBits)[i & kMask];
+    if (!unshared(s)) s = std::make_shared<Stroke>(*s);
+    return *s;
+}
+
+Stroke& StrokeList::emplace_back() {
+    resize(size_ + 1);
+    return mutate(size_ - 1);
+}
+
+void StrokeList::pop_back() {
+    if (size_ == 0) return;
+    resize(size_ - 1);
+}
+
+void StrokeList::resize(std::size_t n) {
+    if (n < size_) {
+        const std::size_t chunks = (n + kMask) >> kChunkBits;
+        if (n & kMask) ownChunk(chunks - 1).resize(n & kMask);
+        chunks_.resize(chunks);
+        size_ = n;
+        return;
+    }
+    while (size_ < n) {
+        const std::size_t c = size_ >> kChunkBits;
+        if (c == chunks_.size()) {
+            chunks_.push_back(std::make_shared<Chunk>());
+            chunks_.back()->reserve(kChunkSize);
+        }
+        Chunk& chunk = ownChunk(c);
+        const std::size_t fill = std::min(kChunkSize - (size_ & kMask), n - size_);
+        for (std::size_t k = 0; k < fill; ++k) chunk.push_back(std::make_shared<Stroke>());
+        size_ += fill;
+    }
+}
+
+void StrokeList::sortDrawOrder(std::vector<std::size_t>::iterator first,
+                               std::vector<std::size_t>::iterator last) const {
+    std::vector<std::pair<std::size_t, std::size_t>> keys;
+    keys.reserve(static_cast<std::size_t>(last - first));
+    for (auto it = first; it != last; ++it) keys.emplace_back((*this)[*it].drawSlot(*it), *it);
+    std::sort(keys.begin(), keys.end());
+    for (const auto& k : keys) *first++ = k.second;
+}
+
+void StrokeList::clear() {
+    chunks_.clear();
+    size_ = 0;
+}
+
+MemoryUsage StrokeList::memoryUsage() const {
+    // make_shared puts the object after a control block of about two pointers.
+    constexpr std::size_t kControlBlock = 2 * sizeof(void*);
+    MemoryUsage u;
+    u.addVector(chunks_);
+    for (const auto& chunk : chunks_) {
+        if (!chunk) continue;
+        u.addBlock(sizeof(Chunk), sizeof(Chunk) + kControlBlock);
+        u.addVector(*chunk);
+        for (const auto& s : *chunk) {
+            if (s) u.addBlock(sizeof(Stroke), sizeof(Stroke) + kControlBlock);
+        }
+    }
+    return u;
+}
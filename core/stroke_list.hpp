@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <vector>
+#include "elements/stroke.hpp"
+#include "memory_usage.hpp"
+
+// The scene's strokes as a persistent array: fixed-size chunks of shared
+// stroke pointers. Copying a StrokeList copies one pointer per chunk and
+// shares everything else, which is how snapshots are taken. Writes go
+// through mutate(), which copies a chunk, and then the one stroke, only
+// while some copy still shares them; the owner mutates in place otherwise.
+//
+// Only the owning thread may write. Other threads read their own copies,
+// and must not change a stroke's storage tier: use the scratch overload of
+// Stroke::pointsWorld(). Stroke::markUsed() is the one write allowed on
+// shared strokes.
+class StrokeList {
+public:
+    static constexpr std::size_t kChunkBits = 10;
+    static constexpr std::size_t kChunkSize = std::size_t{1} << kChunkBits;
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const Stroke& operator[](std::size_t i) const { return *(*chunks_[i >> kChunkBits])[i & kMask]; }
+    const Stroke& back() const { return (*this)[size_ - 1]; }
+    std::shared_ptr<const Stroke> share(std::size_t i) const { return (*chunks_[i >> kChunkBits])[i & kMask]; }
+
+    Stroke& mutate(std::size_t i);
+    Stroke& emplace_back();
+    void pop_back();
+    // New strokes are default-constructed and unshared.
+    void resize(std::size_t n);
+    void clear();
+
+    // Sorts stroke indices by Stroke::drawSlot(), then by index.
+    void sortDrawOrder(std::vector<std::size_t>::iterator first, std::vector<std::size_t>::iterator last) const;
+
+    // The chunk tables and the stroke objects, whoever else shares them;
+    // the strokes report their own points.
+    MemoryUsage memoryUsage() const;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Stroke;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Stroke*;
+        using reference = const Stroke&;
+
+        const_iterator() = default;
+        const_iterator(const StrokeList* list, std::size_t i) : list_(list), i_(i) {}
+        reference operator*() const { return (*list_)[i_]; }
+        pointer operator->() const { return &(*list_)[i_]; }
+        const_iterator& operator++() { ++i_; return *this; }
+        const_iterator operator++(int) { const_iterator t = *this; ++i_; return t; }
+        bool operator==(const const_iterator& o) const { return i_ == o.i_; }
+
+    private:
+        const StrokeList* list_ = nullptr;
+        std::size_t i_ = 0;
+    };
+    const_iterator begin() const { return {this, 0}; }
+    const_iterator end() const { return {this, size_}; }
+
+private:
+    static constexpr std::size_t kMask = kChunkSize - 1;
+    using Chunk = std::vector<std::shared_ptr<Stroke>>;
+
+    Chunk& ownChunk(std::size_t c);
+
+    std::vector<std::shared_ptr<Chunk>> chunks_;
+    std::size_t size_ = 0;
+};
@@ -0,0 +1,282 @@
+#include "svg_path.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <numbers>
+
+namespace {
+constexpr int kMaxSegments = 1024;
+
+class Tokenizer {
+public:
+    explicit Tokenizer(std::string_view s) : s_(s) {}
+
+    void skipSeparators() {
+        while (i_ < s_.size() && (std::isspace(static_cast<unsigned char>(s_[i_])) || s_[i_] == ',')) ++i_;
+    }
+    bool atEnd() {
+        skipSeparators();
+        return i_ >= s_.size();
+    }
+    bool atCommand() {
+        skipSeparators();
+        return i_ < s_.size() && std::isalpha(static_cast<unsigned char>(s_[i_])) &&
+               s_[i_] != 'e' && s_[i_] != 'E';
+    }
+    char command() { return s_[i_++]; }
+
+    bool number(double& v) {
+        skipSeparators();
+        if (i_ >= s_.size()) return false;
+        std::size_t start = i_;
+        if (s_[start] == '+') ++start; // from_chars rejects a leading '+'
+        const auto [ptr, ec] = std::from_chars(s_.data() + start, s_.data() + s_.size(), v);
+        if (ec != std::errc()) return false;
+        i_ = static_cast<std::size_t>(ptr - s_.data());
+        return true;
+    }
+    // Arc flags may be written without separators ("a1 1 0 00 1 1").
+    bool flag(bool& f) {
+        skipSeparators();
+        if (i_ >= s_.size() || (s_[i_] != '0' && s_[i_] != '1')) return false;
+        f = s_[i_++] == '1';
+        return true;
+    }
+
+private:
+    std::string_view s_;
+    std::size_t i_ = 0;
+};
+
+Vec2 lerp(const Vec2& a, const Vec2& b, double t) {
+    return {a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t};
+}
+
+double length(const Vec2& v) { return std::sqrt(v.x * v.x + v.y * v.y); }
+
+int segmentsFor(double deviation, double tolerance) {
+    const double n = std::ceil(std::sqrt(std::max(0.0, deviation) / tolerance));
+    return std::clamp(static_cast<int>(std::isfinite(n) ? n : kMaxSegments), 1, kMaxSegments);
+}
+
+void quadTo(std::vector<Vec2>& pts, const Vec2& p1, const Vec2& p2, double tol) {
+    const Vec2 p0 = pts.back();
+    const Vec2 dd{p0.x - 2.0 * p1.x + p2.x, p0.y - 2.0 * p1.y + p2.y};
+    const int n = segmentsFor(0.25 * length(dd), tol);
+    for (int k = 1; k <= n; ++k) {
+        const double t = static_cast<double>(k) / n;
+        pts.push_back(lerp(lerp(p0, p1, t), lerp(p1, p2, t), t));
+    }
+}
+
+void cubicTo(std::vector<Vec2>& pts, const Vec2& p1, const Vec2& p2, const Vec2& p3, double tol) {
+    const Vec2 p0 = pts.back();
+    const Vec2 d1{p0.x - 2.0 * p1.x + p2.x, p0.y - 2.0 * p1.y + p2.y};
+    const Vec2 d2{p1.x - 2.0 * p2.x + p3.x, p1.y - 2.0 * p2.y + p3.y};
+    const int n = segmentsFor(0.75 * std::max(length(d1), length(d2)), tol);
+    for (int k = 1; k <= n; ++k) {
+        const double t = static_cast<double>(k) / n;
+        const Vec2 a = lerp(p0, p1, t), b = lerp(p1, p2, t), c = lerp(p2, p3, t);
+        pts.push_back(lerp(lerp(a, b, t), lerp(b, c, t), t));
+    }
+}
+
+double angleBetween(double ux, double uy, double vx, double vy) {
+    return std::atan2(ux * vy - uy * vx, ux * vx + uy * vy);
+}
+
+// Endpoint-to-centre conversion from the SVG implementation notes (F.6.5).
+void arcTo(std::vector<Vec2>& pts, double rx, double ry, double rotationDeg, bool largeArc, bool sweep,
+           const Vec2& p1, double tol) {
+    const Vec2 p0 = pts.back();
+    rx = std::fabs(rx);
+    ry = std::fabs(ry);
+    if (rx == 0.0 || ry == 0.0 || p0 == p1) {
+        pts.push_back(p1);
+        return;
+    }
+    const double phi = rotationDeg * std::numbers::pi / 180.0;
+    const double c = std::cos(phi), s = std::sin(phi);
+    const double hx = (p0.x - p1.x) * 0.5, hy = (p0.y - p1.y) * 0.5;
+    const double x1 = c * hx + s * hy;
+    const double y1 = -s * hx + c * hy;
+
+    const double lambda = (x1 * x1) / (rx * rx) + (y1 * y1) / (ry * ry);
+    if (lambda > 1.0) {
+        rx *= std::sqrt(lambda);
+        ry *= std::sqrt(lambda);
+    }
+    const double num = rx * rx * ry * ry - rx * rx * y1 * y1 - ry * ry * x1 * x1;
+    const double den = rx * rx * y1 * y1 + ry * ry * x1 * x1;
+    double k = std::sqrt(std::max(0.0, num / den));
+    if (largeArc == sweep) k = -k;
+    const double cx1 = k * rx * y1 / ry;
+    const double cy1 = -k * ry * x1 / rx;
+    const double cx = c * cx1 - s * cy1 + (p0.x + p1.x) * 0.5;
+    const double cy = s * cx1 + c * cy1 + (p0.y + p1.y) * 0.5;
+
+    const double theta = angleBetween(1.0, 0.0, (x1 - cx1) / rx, (y1 - cy1) / ry);
+    double delta = angleBetween((x1 - cx1) / rx, (y1 - cy1) / ry, (-x1 - cx1) / rx, (-y1 - cy1) / ry);
+    if (!sweep && delta > 0.0) delta -= 2.0 * std::numbers::pi;
+    if (sweep && delta < 0.0) delta += 2.0 * std::numbers::pi;
+
+    // Sagitta of a chord on the larger radius bounds the error.
+    const double r = std::max(rx, ry);
+    const double step = tol < r ? 2.0 * std::acos(1.0 - tol / r) : std::numbers::pi / 2.0;
+    const int n = std::clamp(static_cast<int>(std::ceil(std::fabs(delta) / step)), 1, kMaxSegments);
+    for (int i = 1; i < n; ++i) {
+        const double t = theta + delta * i / n;
+        const double ex = rx * std::cos(t), ey = ry * std::sin(t);
+        pts.push_back({c * ex - s * ey + cx, s * ex + c * ey + cy});
+    }
+    pts.push_back(p1);
+}
+}
+
+bool flattenSvgPath(std::string_view d, double tolerance, std::vector<std::vector<Vec2>>& out) {
+    Tokenizer tok(d);
+    Vec2 cur{0.0, 0.0};
+    Vec2 start{0.0, 0.0};
+    Vec2 lastCtrl{0.0, 0.0};
+    char prev = 0;
+    char cmd = 0;
+    std::vector<Vec2> pts;
+
+    auto flushSubpath = [&]() {
+        if (pts.size() >= 2) out.push_back(std::move(pts));
+        pts.clear();
+    };
+    auto ensureStart = [&]() {
+        if (pts.empty()) pts.push_back(cur);
+    };
+
+    while (!tok.atEnd()) {
+        if (tok.atCommand()) {
+            cmd = tok.command();
+        } else if (cmd == 0 || cmd == 'Z' || cmd == 'z') {
+            flushSubpath();
+            return false;
+        }
+        const bool rel = std::islower(static_cast<unsigned char>(cmd));
+        const Vec2 base = rel ? cur : Vec2{0.0, 0.0};
+        auto point = [&](Vec2& p) {
+            if (!tok.number(p.x) || !tok.number(p.y)) return false;
+            p.x += base.x;
+            p.y += base.y;
+            return true;
+        };
+
+        bool ok = true;
+        switch (std::toupper(static_cast<unsigned char>(cmd))) {
+        case 'M': {
+            Vec2 p;
+            ok = point(p);
+            if (!ok) break;
+            flushSubpath();
+            cur = start = p;
+            pts.push_back(cur);
+            cmd = rel ? 'l' : 'L'; // further pairs are implicit lineto
+            break;
+        }
+        case 'L': {
+            Vec2 p;
+            ok = point(p);
+            if (!ok) break;
+            ensureStart();
+            cur = p;
+            pts.push_back(cur);
+            break;
+        }
+        case 'H': {
+            double x = 0.0;
+            ok = tok.number(x);
+            if (!ok) break;
+            ensureStart();
+            cur.x = rel ? cur.x + x : x;
+            pts.push_back(cur);
+            break;
+        }
+        case 'V': {
+            double y = 0.0;
+            ok = tok.number(y);
+            if (!ok) break;
+            ensureStart();
+            cur.y = rel ? cur.y + y : y;
+            pts.push_back(cur);
+            break;
+        }
+        case 'C':
+        case 'S': {
+            Vec2 c1, c2, p;
+            const bool smooth = std::toupper(static_cast<unsigned char>(cmd)) == 'S';
+            if (smooth) {
+                const char pc = static_cast<char>(std::toupper(static_cast<unsigned char>(prev)));
+                c1 = (pc == 'C' || pc == 'S') ? Vec2{2.0 * cur.x - lastCtrl.x, 2.0 * cur.y - lastCtrl.y} : cur;
+                ok = point(c2) && point(p);
+            } else {
+                ok = point(c1) && point(c2) && point(p);
+            }
+            if (!ok) break;
+            ensureStart();
+            cubicTo(pts, c1, c2, p, tolerance);
+            lastCtrl = c2;
+            cur = p;
+            break;
+        }
+        case 'Q':
+        case 'T': {
+            Vec2 c1, p;
+            if (std::toupper(static_cast<unsigned char>(cmd)) == 'T') {
+                const char pc = static_cast<char>(std::toupper(static_cast<unsigned char>(prev)));
+                c1 = (pc == 'Q' || pc == 'T') ? Vec2{2.0 * cur.x - lastCtrl.x, 2.0 * cur.y - lastCtrl.y} : cur;
+                ok = point(p);
+            } else {
+                ok = point(c1) && point(p);
+            }
+            if (!ok) break;
+            ensureStart();
+            quadTo(pts, c1, p, tolerance);
+            lastCtrl = c1;
+            cur = p;
+            break;
+        }
+        case 'A': {
+            double rx = 0.0, ry = 0.0, rot = 0.0;
+            bool large = false, sweep = false;
+            Vec2 p;
+            ok = tok.number(rx) && tok.number(ry) && tok.number(rot) && tok.flag(large) && tok.flag(sweep) && point(p);
+            if (!ok) break;
+            ensureStart();
+            arcTo(pts, rx, ry, rot, large, sweep, p, tolerance);
+            cur = p;
+            break;
+        }
+        case 'Z':
+            if (!pts.empty()) pts.push_back(start);
+            flushSubpath();
+            cur = start;
+            break;
+        default:
+            ok = false;
+            break;
+        }
+        if (!ok) {
+            flushSubpath();
+            return false;
+        }
+        prev = cmd;
+    }
+    flushSubpath();
+    return true;
+}
+
+bool parseSvgPoints(std::string_view text, std::vector<Vec2>& out) {
+    Tokenizer tok(text);
+    while (!tok.atEnd()) {
+        Vec2 p;
+        if (!tok.number(p.x) || !tok.number(p.y)) return false;
+        out.push_back(p);
+    }
+    return true;
+}
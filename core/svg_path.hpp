@@ -0,0 +1,13 @@
+#pragma once
+#include <string_view>
+#include <vector>
+#include "types.hpp"
+
+// Flattens SVG path data (the d attribute) into polylines, one per subpath.
+// Curves and arcs are subdivided until the chord error is below tolerance,
+// in path units. Returns false on a syntax error; subpaths parsed before
+// the error are kept, as SVG renderers do.
+bool flattenSvgPath(std::string_view d, double tolerance, std::vector<std::vector<Vec2>>& out);
+
+// Parses an SVG points list ("x,y x,y ...") as used by polyline and polygon.
+bool parseSvgPoints(std::string_view text, std::vector<Vec2>& out);
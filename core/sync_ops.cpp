@@ -0,0 +1,233 @@
+#include "sync_ops.hpp"
+#include "scene.hpp"
+#include "varint.hpp"
+#include <algorithm>
+
+namespace {
+constexpr int kQuantumBits = 6; // grid step = width / 64
+constexpr std::uint64_t kMaxFrameBytes = 64u << 20;
+
+void putOp(std::vector<std::uint8_t>& out, SyncOp op, std::uint64_t id) {
+    out.push_back(static_cast<std::uint8_t>(op));
+    putVarint(out, id);
+}
+}
+
+std::vector<std::uint8_t> SyncPublisher::poll(const Scene& scene) {
+    std::vector<std::uint8_t> out;
+    const auto& strokes = scene.strokes();
+    const Vec2 origin = scene.origin();
+
+    // The active stroke may have been dropped as empty; its slot gets reused.
+    tracks_.resize(strokes.size());
+    firstOpen_ = std::min(firstOpen_, strokes.size());
+
+    bool settled = true;
+    for (std::size_t i = firstOpen_; i < strokes.size(); ++i) {
+        Track& t = tracks_[i];
+        const bool open = scene.isDrawing() && scene.activeIndex() == i;
+        const auto& pts = strokes[i].pointsWorld(scratch_);
+
+        if (!t.begun && i >= regeneratedFrom_ && strokes[i].drawSlot(i) != i) {
+            t.ended = true; // followers split this piece off themselves
+        }
+        if (!t.ended && !t.begun) {
+            if (pts.size() >= 2) {
+                const Vec2 anchor = pts[0] + origin;
+                const double widthExp = strokes[i].widthExp();
+                putOp(out, SyncOp::Begin, i);
+                putDouble(out, widthExp);
+                putVarint(out, strokes[i].colorRGB());
+                putDouble(out, anchor.x);
+                putDouble(out, anchor.y);
+                if (strokes[i].brush() != BrushKind::Pen) {
+                    putOp(out, SyncOp::Style, i);
+                    out.push_back(static_cast<std::uint8_t>(strokes[i].brush()));
+                }
+                t.quantizer = PointQuantizer(anchor, PointQuantizer::quantumForWidthExp(widthExp, kQuantumBits));
+                t.sent = 1;
+                t.begun = true;
+            } else if (!open) {
+                t.ended = true; // finished without ever becoming a real stroke
+            }
+        }
+
+        if (t.begun && !t.ended) {
+            if (pts.size() > t.sent) emitPoints(out, i, t, pts, origin);
+            if (!open) {
+                putOp(out, SyncOp::End, i);
+                t.ended = true;
+            }
+        }
+
+        if (settled && t.ended) {
+            firstOpen_ = i + 1;
+        } else {
+            settled = false;
+        }
+    }
+    return out;
+}
+
+std::vector<std::uint8_t> SyncPublisher::erase(const Scene& scene, const Capsule& capsule) {
+    std::vector<std::uint8_t> out = poll(scene);
+    const Vec2 origin = scene.origin();
+    const Vec2 a = capsule.a + origin;
+    const Vec2 b = capsule.b + origin;
+    putOp(out, SyncOp::Erase, 0);
+    putDouble(out, a.x);
+    putDouble(out, a.y);
+    putDouble(out, b.x);
+    putDouble(out, b.y);
+    putDouble(out, capsule.radius);
+    regeneratedFrom_ = std::min(regeneratedFrom_, scene.strokes().size());
+    return out;
+}
+
+void SyncPublisher::emitPoints(std::vector<std::uint8_t>& out, std::uint64_t id, Track& track,
+                               const std::vector<Vec2>& pts, const Vec2& origin) {
+    std::vector<std::uint8_t> body;
+    std::uint64_t count = 0;
+    auto flush = [&]() {
+        if (count == 0) return;
+        putOp(out, SyncOp::Points, id);
+        putVarint(out, count);
+        out.insert(out.end(), body.begin(), body.end());
+        body.clear();
+        count = 0;
+    };
+
+    for (std::size_t j = track.sent; j < pts.size(); ++j) {
+        const Vec2 p = pts[j] + origin;
+        if (track.quantizer.encode(p, body)) {
+            ++count;
+            continue;
+        }
+        flush();
+        putOp(out, SyncOp::Anchor, id);
+        putDouble(out, p.x);
+        putDouble(out, p.y);
+        track.quantizer = PointQuantizer(p, track.quantizer.quantum());
+    }
+    flush();
+    track.sent = pts.size();
+}
+
+bool SyncApplier::apply(const std::uint8_t* data, std::size_t size, Scene& scene) {
+    const std::uint8_t* p = data;
+    const std::uint8_t* end = data + size;
+
+    while (p < end) {
+        const auto op = static_cast<SyncOp>(*p++);
+        std::uint64_t id = 0;
+        if (!getVarint(p, end, id)) return false;
+
+        switch (op) {
+        case SyncOp::Begin: {
+            double widthExp = 0.0;
+            std::uint64_t color = 0;
+            Vec2 anchor;
+            if (!getDouble(p, end, widthExp) || !getVarint(p, end, color) ||
+                !getDouble(p, end, anchor.x) || !getDouble(p, end, anchor.y)) {
+                return false;
+            }
+            Remote r;
+            r.index = scene.openStroke(widthExp, static_cast<std::uint32_t>(color));
+            r.quantizer = PointQuantizer(anchor, PointQuantizer::quantumForWidthExp(widthExp, kQuantumBits));
+            scene.appendWorldPoint(r.index, anchor - scene.origin());
+            remotes_[id] = r;
+            break;
+        }
+        case SyncOp::Points: {
+            std::uint64_t count = 0;
+            if (!getVarint(p, end, count)) return false;
+            auto it = remotes_.find(id);
+            if (it == remotes_.end()) return false;
+            const Vec2 origin = scene.origin();
+            for (std::uint64_t k = 0; k < count; ++k) {
+                Vec2 w;
+                if (!it->second.quantizer.decode(p, end, w)) return false;
+                scene.appendWorldPoint(it->second.index, w - origin);
+            }
+            break;
+        }
+        case SyncOp::Anchor: {
+            Vec2 w;
+            if (!getDouble(p, end, w.x) || !getDouble(p, end, w.y)) return false;
+            auto it = remotes_.find(id);
+            if (it == remotes_.end()) return false;
+            it->second.quantizer = PointQuantizer(w, it->second.quantizer.quantum());
+            scene.appendWorldPoint(it->second.index, w - scene.origin());
+            break;
+        }
+        case SyncOp::Style: {
+            if (p >= end || *p >= kBrushKindCount) return false;
+            const auto brush = static_cast<BrushKind>(*p++);
+            auto it = remotes_.find(id);
+            if (it == remotes_.end()) return false;
+            scene.setStrokeBrush(it->second.index, brush);
+            break;
+        }
+        case SyncOp::End: {
+            auto it = remotes_.find(id);
+            if (it == remotes_.end()) return false;
+            scene.closeStroke(it->second.index);
+            remotes_.erase(it);
+            break;
+        }
+        case SyncOp::Erase: {
+            Capsule c;
+            if (!getDouble(p, end, c.a.x) || !getDouble(p, end, c.a.y) ||
+                !getDouble(p, end, c.b.x) || !getDouble(p, end, c.b.y) ||
+                !getDouble(p, end, c.radius)) {
+                return false;
+            }
+            const Vec2 origin = scene.origin();
+            c.a -= origin;
+            c.b -= origin;
+            scene.erase(c);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+void appendSyncFrame(std::vector<std::uint8_t>& stream, const std::vector<std::uint8_t>& payload) {
+    putVarint(stream, payload.size());
+    stream.insert(stream.end(), payload.begin(), payload.end());
+}
+
+void SyncFrameReader::feed(const std::uint8_t* data, std::size_t size) {
+    if (pos_ > 0 && pos_ == buf_.size()) {
+        buf_.clear();
+        pos_ = 0;
+    }
+    buf_.insert(buf_.end(), data, data + size);
+}
+
+bool SyncFrameReader::next(std::vector<std::uint8_t>& payload) {
+    if (failed_) return false;
+    const std::uint8_t* p = buf_.data() + pos_;
+    const std::uint8_t* end = buf_.data() + buf_.size();
+    std::uint64_t len = 0;
+    if (!getVarint(p, end, len)) {
+        if (end - p >= 10) failed_ = true;
+        return false;
+    }
+    if (len > kMaxFrameBytes) {
+        failed_ = true;
+        return false;
+    }
+    if (static_cast<std::uint64_t>(end - p) < len) return false;
+
+    payload.assign(p, p + len);
+    pos_ = static_cast<std::size_t>((p + len) - buf_.data());
+    if (pos_ > (1u << 16) && pos_ * 2 > buf_.size()) {
+        buf_.erase(buf_.begin(), buf_.begin() + static_cast<std::ptrdiff_t>(pos_));
+        pos_ = 0;
+    }
+    return true;
+}
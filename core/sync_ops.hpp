@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "point_codec.hpp"
+#include "polyline_cut.hpp"
+
+class Scene;
+
+// Wire format for live board sync. A frame is a varint byte length followed by
+// a run of ops; stroke points travel as quantized zigzag varint deltas. Points
+// are expressed in board coordinates (local + Scene::origin()) so peers that
+// recenter independently still agree.
+enum class SyncOp : std::uint8_t {
+    Begin  = 1, // id, widthExp, color, first point
+    Points = 2, // id, count, deltas
+    Anchor = 3, // id, raw point; restarts the delta grid
+    End    = 4, // id
+    Style  = 5, // id, brush kind; follows Begin, only for brushes other than the pen
+    Erase  = 6, // id 0, capsule ends and radius; every peer cuts its own copies
+};
+
+// Publishing side: diffs the scene against what was already sent.
+class SyncPublisher {
+public:
+    // Encodes everything appended since the previous call as one frame payload.
+    // Returns an empty buffer when nothing changed.
+    std::vector<std::uint8_t> poll(const Scene& scene);
+    // Call before scene.erase(capsule): flushes the strokes as they are now,
+    // then the erase itself. The pieces the erase splits off are not sent,
+    // since every follower splits its own.
+    std::vector<std::uint8_t> erase(const Scene& scene, const Capsule& capsule);
+
+private:
+    struct Track {
+        bool begun = false;
+        bool ended = false;
+        std::size_t sent = 0;
+        PointQuantizer quantizer;
+    };
+
+    void emitPoints(std::vector<std::uint8_t>& out, std::uint64_t id, Track& track,
+                    const std::vector<Vec2>& pts, const Vec2& origin);
+
+    std::vector<Track> tracks_;
+    std::size_t firstOpen_ = 0;
+    // Erase pieces from here on were produced after an Erase op went out.
+    std::size_t regeneratedFrom_ = static_cast<std::size_t>(-1);
+    std::vector<Vec2> scratch_;
+};
+
+// Receiving side: replays frame payloads into a local scene.
+class SyncApplier {
+public:
+    // Returns false on a malformed payload; ops decoded before the error stay applied.
+    bool apply(const std::uint8_t* data, std::size_t size, Scene& scene);
+
+private:
+    struct Remote {
+        std::size_t index = 0;
+        PointQuantizer quantizer;
+    };
+
+    std::unordered_map<std::uint64_t, Remote> remotes_;
+};
+
+// Length-prefixed framing over a byte stream.
+void appendSyncFrame(std::vector<std::uint8_t>& stream, const std::vector<std::uint8_t>& payload);
+
+class SyncFrameReader {
+public:
+    void feed(const std::uint8_t* data, std::size_t size);
+    // Pops the next complete frame payload. Sets failed() on a corrupt length.
+    bool next(std::vector<std::uint8_t>& payload);
+    bool failed() const { return failed_; }
+
+private:
+    std::vector<std::uint8_t> buf_;
+    std::size_t pos_ = 0;
+    bool failed_ = false;
+};
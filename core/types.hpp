@@ -1,5 +1,7 @@
 #pragma once
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 struct Vec2 {
     double x{0}, y{0};
@@ -9,6 +11,48 @@ struct Vec2 {
     Vec2 operator-(const Vec2& o) const { return {x-o.x, y-o.y}; }
     Vec2& operator+=(const Vec2& o){ x+=o.x; y+=o.y; return *this; }
     Vec2& operator-=(const Vec2& o){ x-=o.x; y-=o.y; return *this; }
+    bool operator==(const Vec2& o) const = default;
+};
+
+// Axis-aligned box; default-constructed boxes are empty and grow via expand().
+struct Rect {
+    double minX{ std::numeric_limits<double>::infinity()};
+    double minY{ std::numeric_limits<double>::infinity()};
+    double maxX{-std::numeric_limits<double>::infinity()};
+    double maxY{-std::numeric_limits<double>::infinity()};
+
+    Rect() = default;
+    Rect(double x0, double y0, double x1, double y1)
+        : minX(std::min(x0, x1)), minY(std::min(y0, y1)), maxX(std::max(x0, x1)), maxY(std::max(y0, y1)) {}
+
+    bool empty() const { return !(minX <= maxX && minY <= maxY); }
+    double width() const { return empty() ? 0.0 : maxX - minX; }
+    double height() const { return empty() ? 0.0 : maxY - minY; }
+    Vec2 center() const { return {(minX + maxX) * 0.5, (minY + maxY) * 0.5}; }
+
+    void expand(const Vec2& p) {
+        minX = std::min(minX, p.x); minY = std::min(minY, p.y);
+        maxX = std::max(maxX, p.x); maxY = std::max(maxY, p.y);
+    }
+    void expand(const Rect& r) {
+        if (r.empty()) return;
+        minX = std::min(minX, r.minX); minY = std::min(minY, r.minY);
+        maxX = std::max(maxX, r.maxX); maxY = std::max(maxY, r.maxY);
+    }
+    Rect inflated(double d) const {
+        if (empty()) return *this;
+        return {minX - d, minY - d, maxX + d, maxY + d};
+    }
+    Rect translated(const Vec2& d) const {
+        if (empty()) return *this;
+        return {minX + d.x, minY + d.y, maxX + d.x, maxY + d.y};
+    }
+    bool intersects(const Rect& o) const {
+        return minX <= o.maxX && o.minX <= maxX && minY <= o.maxY && o.minY <= maxY;
+    }
+    bool contains(const Vec2& p) const {
+        return p.x >= minX && p.x <= maxX && p.y >= minY && p.y <= maxY;
+    }
 };
 
 inline double pow2(double e){ return std::pow(2.0, e); }
@@ -0,0 +1,123 @@
+#include "board_export.hpp"
+#include "camera.hpp"
+#include "scene.hpp"
+#include <cmath>
+#include <cstdio>
+
+namespace {
+// Output pixels beyond this are refused: the page would be unusable anyway
+// and coordinates start losing the two decimals written below.
+constexpr double kMaxOutputPx = 1e7;
+
+void writeColor(std::ostream& out, std::uint32_t rgb) {
+    char buf[8];
+    std::snprintf(buf, sizeof(buf), "#%06X", static_cast<unsigned>(rgb & 0xFFFFFF));
+    out << buf;
+}
+}
+
+bool exportBoard(const SceneSnapshot& snapshot, const ExportOptions& options, ExportSink& sink) {
+    const Rect& region = options.worldRect;
+    if (region.empty()) return false;
+    const double scale = std::exp2(options.zoomExp);
+    const double widthPx = region.width() * scale;
+    const double heightPx = region.height() * scale;
+    if (!(widthPx >= 1.0 && heightPx >= 1.0 && widthPx <= kMaxOutputPx && heightPx <= kMaxOutputPx)) return false;
+
+    Camera cam;
+    cam.setState(options.zoomExp, {0.0, 0.0}, {region.minX, region.minY});
+    const Rect viewport(0.0, 0.0, widthPx, heightPx);
+    if (!sink.begin(widthPx, heightPx, options.backgroundRGB, options.fillBackground)) return false;
+
+    StrokeBatcher batcher;
+    std::size_t inChunk = 0;
+    auto flush = [&]() {
+        for (std::size_t i = 0; i < batcher.batchCount(); ++i) {
+            sink.writeBatch(batcher.batch(i));
+        }
+        batcher.begin(cam, viewport);
+        inChunk = 0;
+    };
+
+    const StrokeList& strokes = snapshot.strokes;
+    auto visible = [&](std::size_t i) {
+        const Stroke& s = strokes[i];
+        return !s.empty() && s.inkBounds().intersects(region);
+    };
+    auto emit = [&](std::size_t i) {
+        batcher.add(strokes[i]); // decodes cold strokes without thawing them
+        if (++inChunk >= options.strokesPerChunk) flush();
+    };
+
+    // Pieces split off by an erase sit at the end of the list but draw in
+    // their original stroke's slot. Only they are gathered and sorted; the
+    // rest is a linear pass in index order with the pieces merged in, since
+    // the spatial index would need memory proportional to all the hits.
+    std::vector<std::size_t> pieces;
+    for (std::size_t i = 0; i < strokes.size(); ++i) {
+        if (strokes[i].drawSlot(i) != i && visible(i)) pieces.push_back(i);
+    }
+    strokes.sortDrawOrder(pieces.begin(), pieces.end());
+
+    batcher.begin(cam, viewport);
+    std::size_t next = 0;
+    for (std::size_t i = 0; i < strokes.size(); ++i) {
+        for (; next < pieces.size() && strokes[pieces[next]].drawSlot(pieces[next]) < i; ++next) emit(pieces[next]);
+        if (strokes[i].drawSlot(i) == i && visible(i)) emit(i);
+    }
+    for (; next < pieces.size(); ++next) emit(pieces[next]);
+    flush();
+    return sink.end();
+}
+
+bool SvgExportSink::begin(double widthPx, double heightPx, std::uint32_t backgroundRGB, bool fillBackground) {
+    out_ << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+         << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" width=\"" << widthPx
+         << "\" height=\"" << heightPx << "\" viewBox=\"0 0 " << widthPx << ' ' << heightPx << "\">\n";
+    if (fillBackground) {
+        out_ << "<rect width=\"100%\" height=\"100%\" fill=\"";
+        writeColor(out_, backgroundRGB);
+        out_ << "\"/>\n";
+    }
+    return static_cast<bool>(out_);
+}
+
+void SvgExportSink::writeBatch(const StrokeBatch& b) {
+    if (!b.fillEnds.empty()) {
+        out_ << "<path fill=\"";
+        writeColor(out_, b.colorRGB);
+        out_ << "\" d=\"";
+        std::uint32_t start = 0;
+        for (std::uint32_t end : b.fillEnds) {
+            writePoint('M', b.fillPoints[start]);
+            for (std::uint32_t k = start + 1; k < end; ++k) writePoint('L', b.fillPoints[k]);
+            out_ << 'Z';
+            start = end;
+        }
+        out_ << "\"/>\n";
+    }
+    if (b.runEnds.empty()) return;
+
+    out_ << "<path fill=\"none\" stroke-linecap=\"round\" stroke-linejoin=\"round\" stroke=\"";
+    writeColor(out_, b.colorRGB);
+    out_ << "\" stroke-width=\"" << b.widthPx << "\" d=\"";
+    std::uint32_t start = 0;
+    for (std::uint32_t end : b.runEnds) {
+        writePoint('M', b.points[start]);
+        for (std::uint32_t k = start + 1; k < end; ++k) writePoint('L', b.points[k]);
+        start = end;
+    }
+    out_ << "\"/>\n";
+}
+
+bool SvgExportSink::end() {
+    out_ << "</svg>\n";
+    out_.flush();
+    return static_cast<bool>(out_);
+}
+
+void SvgExportSink::writePoint(char op, const Vec2& p) {
+    char buf[64];
+    const int n = std::snprintf(buf, sizeof(buf), "%c%.2f %.2f", op, p.x, p.y);
+    out_.write(buf, n);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "stroke_batcher.hpp"
+#include "types.hpp"
+
+struct SceneSnapshot;
+
+// Receives an export as a sequence of screen-space batches in draw order.
+// Sinks write each batch out immediately, so nothing accumulates.
+class ExportSink {
+public:
+    virtual ~ExportSink() = default;
+    virtual bool begin(double widthPx, double heightPx, std::uint32_t backgroundRGB, bool fillBackground) = 0;
+    virtual void writeBatch(const StrokeBatch& b) = 0;
+    virtual bool end() = 0;
+};
+
+struct ExportOptions {
+    Rect worldRect;                      // board region, scene-local coordinates
+    double zoomExp = 0.0;                // output pixels per world unit = 2^zoomExp
+    std::uint32_t backgroundRGB = 0x181A1B;
+    bool fillBackground = true;
+    std::size_t strokesPerChunk = 4096;  // batcher is flushed to the sink after this many strokes
+};
+
+// Streams the strokes intersecting worldRect to sink in draw order, with
+// the culling, width cut-off and clipping rules of the live view. Memory is
+// bounded by one chunk of strokes plus the indices of visible erase pieces,
+// whatever the board size; cold strokes are decoded into a scratch buffer
+// instead of being thawed. Reads only the
+// snapshot, so it may run on any thread while the scene changes.
+bool exportBoard(const SceneSnapshot& snapshot, const ExportOptions& options, ExportSink& sink);
+
+// Plain SVG 1.1: one <path> per batch, coordinates in output pixels.
+class SvgExportSink : public ExportSink {
+public:
+    explicit SvgExportSink(std::ostream& out) : out_(out) {}
+
+    bool begin(double widthPx, double heightPx, std::uint32_t backgroundRGB, bool fillBackground) override;
+    void writeBatch(const StrokeBatch& b) override;
+    bool end() override;
+
+private:
+    void writePoint(char op, const Vec2& p);
+
+    std::ostream& out_;
+};
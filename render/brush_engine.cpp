@@ -0,0 +1,367 @@
+#include "brush_engine.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CANCANS_BRUSH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+constexpr int kTileBits = 8;
+static_assert(BrushLayer::kTileSize == 1 << kTileBits);
+constexpr int kStampStepsPerOctave = 8;
+constexpr double kMinSpacingPx = 0.5;
+
+// The paper texture repeats every kGrainSize pixels. Rows are stored with
+// a tile's width of wrap-around, so any tile span reads contiguously.
+constexpr int kGrainSize = 64;
+constexpr int kGrainMask = kGrainSize - 1;
+constexpr int kGrainStride = kGrainSize + BrushLayer::kTileSize;
+
+struct KindParams {
+    double spacing; // dab distance as a fraction of the diameter
+    int opacity;    // per dab, out of 255
+};
+// Tuned so the middle of a stroke reaches roughly 85% ink.
+constexpr KindParams kParams[kBrushKindCount] = {
+    {0.12, 90},  // Pen: unused, pens are stroked rather than stamped
+    {0.12, 90},  // Soft
+    {0.20, 150}, // Grain
+};
+
+const std::uint8_t* grainRow(int y) {
+    static const std::vector<std::uint8_t> texture = [] {
+        std::array<int, kGrainSize * kGrainSize> noise{};
+        std::uint32_t h = 0x9E3779B9u;
+        for (int& n : noise) {
+            h ^= h << 13;
+            h ^= h >> 17;
+            h ^= h << 5;
+            n = static_cast<int>(h & 0xFF);
+        }
+        // A 3x3 box blur turns white noise into something paper-like.
+        std::vector<std::uint8_t> rows(kGrainSize * kGrainStride);
+        for (int y = 0; y < kGrainSize; ++y) {
+            for (int x = 0; x < kGrainSize; ++x) {
+                int sum = 0;
+                for (int dy = -1; dy <= 1; ++dy) {
+                    for (int dx = -1; dx <= 1; ++dx) {
+                        sum += noise[((y + dy) & kGrainMask) * kGrainSize + ((x + dx) & kGrainMask)];
+                    }
+                }
+                const auto v = static_cast<std::uint8_t>(80 + (sum / 9) * 175 / 255);
+                for (int c = x; c < kGrainStride; c += kGrainSize) rows[y * kGrainStride + c] = v;
+            }
+        }
+        return rows;
+    }();
+    return texture.data() + (y & kGrainMask) * kGrainStride;
+}
+
+inline int div255(int x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+// out = mask * opacity / 255, times grain / 255 when grain is given.
+void scaleCoverageScalar(std::uint8_t* out, const std::uint8_t* mask, const std::uint8_t* grain, int n, int opacity) {
+    for (int i = 0; i < n; ++i) {
+        int c = div255(mask[i] * opacity);
+        if (grain) c = div255(c * grain[i]);
+        out[i] = static_cast<std::uint8_t>(c);
+    }
+}
+
+// Source-over of an opaque colour at per-pixel coverage into premultiplied ARGB32.
+void blendRowScalar(std::uint32_t* dst, const std::uint8_t* coverage, int n, std::uint32_t colorRGB) {
+    const int cr = (colorRGB >> 16) & 0xFF;
+    const int cg = (colorRGB >> 8) & 0xFF;
+    const int cb = colorRGB & 0xFF;
+    for (int i = 0; i < n; ++i) {
+        const int a = coverage[i];
+        if (a == 0) continue;
+        const std::uint32_t d = dst[i];
+        const int inv = 255 - a;
+        const int oa = div255(255 * a + static_cast<int>(d >> 24) * inv);
+        const int orr = div255(cr * a + static_cast<int>((d >> 16) & 0xFF) * inv);
+        const int og = div255(cg * a + static_cast<int>((d >> 8) & 0xFF) * inv);
+        const int ob = div255(cb * a + static_cast<int>(d & 0xFF) * inv);
+        dst[i] = (static_cast<std::uint32_t>(oa) << 24) | (static_cast<std::uint32_t>(orr) << 16) |
+                 (static_cast<std::uint32_t>(og) << 8) | static_cast<std::uint32_t>(ob);
+    }
+}
+
+#ifdef CANCANS_BRUSH_SSE2
+// Rounded x / 255 for 16-bit lanes holding at most 255 * 255.
+inline __m128i div255x8(__m128i x) {
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+void scaleCoverage(std::uint8_t* out, const std::uint8_t* mask, const std::uint8_t* grain, int n, int opacity) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i op = _mm_set1_epi16(static_cast<short>(opacity));
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + i));
+        __m128i lo = div255x8(_mm_mullo_epi16(_mm_unpacklo_epi8(m, zero), op));
+        __m128i hi = div255x8(_mm_mullo_epi16(_mm_unpackhi_epi8(m, zero), op));
+        if (grain) {
+            const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(grain + i));
+            lo = div255x8(_mm_mullo_epi16(lo, _mm_unpacklo_epi8(g, zero)));
+            hi = div255x8(_mm_mullo_epi16(hi, _mm_unpackhi_epi8(g, zero)));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(lo, hi));
+    }
+    scaleCoverageScalar(out + i, mask + i, grain ? grain + i : nullptr, n - i, opacity);
+}
+
+// Four pixels per step: each coverage byte is spread over its pixel's
+// four channels, and both pixels of a half are blended in 16-bit lanes.
+void blendRow(std::uint32_t* dst, const std::uint8_t* coverage, int n, std::uint32_t colorRGB) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+    const auto r = static_cast<short>((colorRGB >> 16) & 0xFF);
+    const auto g = static_cast<short>((colorRGB >> 8) & 0xFF);
+    const auto b = static_cast<short>(colorRGB & 0xFF);
+    const __m128i color = _mm_set_epi16(255, r, g, b, 255, r, g, b);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        std::int32_t cov;
+        std::memcpy(&cov, coverage + i, sizeof(cov));
+        if (cov == 0) continue;
+        __m128i a = _mm_cvtsi32_si128(cov);
+        a = _mm_unpacklo_epi8(a, a);
+        a = _mm_unpacklo_epi16(a, a);
+        const __m128i aLo = _mm_unpacklo_epi8(a, zero);
+        const __m128i aHi = _mm_unpackhi_epi8(a, zero);
+
+        __m128i* p = reinterpret_cast<__m128i*>(dst + i);
+        const __m128i d = _mm_loadu_si128(p);
+        const __m128i dLo = _mm_unpacklo_epi8(d, zero);
+        const __m128i dHi = _mm_unpackhi_epi8(d, zero);
+        const __m128i lo = div255x8(_mm_add_epi16(_mm_mullo_epi16(color, aLo),
+                                                  _mm_mullo_epi16(dLo, _mm_sub_epi16(full, aLo))));
+        const __m128i hi = div255x8(_mm_add_epi16(_mm_mullo_epi16(color, aHi),
+                                                  _mm_mullo_epi16(dHi, _mm_sub_epi16(full, aHi))));
+        _mm_storeu_si128(p, _mm_packus_epi16(lo, hi));
+    }
+    blendRowScalar(dst + i, coverage + i, n - i, colorRGB);
+}
+#else
+void scaleCoverage(std::uint8_t* out, const std::uint8_t* mask, const std::uint8_t* grain, int n, int opacity) {
+    scaleCoverageScalar(out, mask, grain, n, opacity);
+}
+
+void blendRow(std::uint32_t* dst, const std::uint8_t* coverage, int n, std::uint32_t colorRGB) {
+    blendRowScalar(dst, coverage, n, colorRGB);
+}
+#endif
+
+// Parameter range of a -> b inside r, as fractions of the segment.
+bool clipSegment(const Vec2& a, const Vec2& b, const Rect& r, double& t0, double& t1) {
+    t0 = 0.0;
+    t1 = 1.0;
+    const double d[2] = {b.x - a.x, b.y - a.y};
+    const double lo[2] = {r.minX - a.x, r.minY - a.y};
+    const double hi[2] = {r.maxX - a.x, r.maxY - a.y};
+    for (int k = 0; k < 2; ++k) {
+        if (d[k] == 0.0) {
+            if (lo[k] > 0.0 || hi[k] < 0.0) return false;
+            continue;
+        }
+        double e0 = lo[k] / d[k];
+        double e1 = hi[k] / d[k];
+        if (e0 > e1) std::swap(e0, e1);
+        t0 = std::max(t0, e0);
+        t1 = std::min(t1, e1);
+    }
+    return t0 <= t1;
+}
+}
+
+const BrushStamp& StampCache::stamp(BrushKind kind, double diameterPx) {
+    const int bucket = static_cast<int>(std::lround(std::log2(diameterPx) * kStampStepsPerOctave));
+    const std::uint32_t key = (static_cast<std::uint32_t>(kind) << 16) | static_cast<std::uint16_t>(bucket);
+    auto found = stamps_.find(key);
+    if (found != stamps_.end()) return found->second;
+
+    const double diameter = std::exp2(static_cast<double>(bucket) / kStampStepsPerOctave);
+    const double radius = diameter * 0.5;
+    BrushStamp s;
+    s.size = static_cast<int>(std::ceil(diameter)) + 2;
+    s.alpha.resize(static_cast<std::size_t>(s.size) * s.size);
+    const double c = s.size * 0.5;
+    for (int y = 0; y < s.size; ++y) {
+        for (int x = 0; x < s.size; ++x) {
+            const double dist = std::hypot(x + 0.5 - c, y + 0.5 - c);
+            double a = 0.0;
+            if (kind == BrushKind::Grain) {
+                a = std::clamp(radius - dist + 0.5, 0.0, 1.0); // antialiased disc
+            } else if (dist < radius) {
+                const double q = 1.0 - (dist * dist) / (radius * radius);
+                a = q * q;
+            }
+            s.alpha[static_cast<std::size_t>(y) * s.size + x] = static_cast<std::uint8_t>(std::lround(a * 255.0));
+        }
+    }
+    return stamps_.emplace(key, std::move(s)).first->second;
+}
+
+MemoryUsage StampCache::memoryUsage() const {
+    MemoryUsage u;
+    u.addMap(stamps_);
+    for (const auto& entry : stamps_) u.addVector(entry.second.alpha);
+    return u;
+}
+
+void BrushLayer::clear() {
+    used_ = 0;
+    lookup_.clear();
+}
+
+MemoryUsage BrushLayer::memoryUsage() const {
+    MemoryUsage u;
+    u.addVector(tiles_);
+    for (std::size_t i = 0; i < tiles_.size(); ++i) {
+        const auto& pixels = tiles_[i].pixels;
+        if (pixels.capacity() == 0) continue;
+        u.addBlock(i < used_ ? pixels.size() * sizeof(std::uint32_t) : 0, pixels.capacity() * sizeof(std::uint32_t));
+    }
+    u.addMap(lookup_);
+    u.addVector(coverage_);
+    return u;
+}
+
+BrushLayer::Tile& BrushLayer::tileAt(int tx, int ty) {
+    const std::uint64_t key = (static_cast<std::uint64_t>(static_cast<std::uint32_t>(tx)) << 32) |
+                              static_cast<std::uint32_t>(ty);
+    auto found = lookup_.find(key);
+    if (found != lookup_.end()) return tiles_[found->second];
+    if (used_ == tiles_.size()) tiles_.emplace_back();
+    Tile& t = tiles_[used_];
+    t.tx = tx;
+    t.ty = ty;
+    t.pixels.assign(static_cast<std::size_t>(kTileSize) * kTileSize, 0);
+    lookup_.emplace(key, used_++);
+    return t;
+}
+
+void BrushLayer::stamp(const BrushStamp& dab, double cx, double cy, std::uint32_t colorRGB, int opacity, bool grain) {
+    const int x0 = static_cast<int>(std::lround(cx - dab.size * 0.5));
+    const int y0 = static_cast<int>(std::lround(cy - dab.size * 0.5));
+    const int x1 = x0 + dab.size;
+    const int y1 = y0 + dab.size;
+    coverage_.resize(static_cast<std::size_t>(dab.size));
+
+    for (int ty = y0 >> kTileBits; ty <= (y1 - 1) >> kTileBits; ++ty) {
+        for (int tx = x0 >> kTileBits; tx <= (x1 - 1) >> kTileBits; ++tx) {
+            Tile& t = tileAt(tx, ty);
+            const int sx0 = std::max(x0, tx * kTileSize);
+            const int sx1 = std::min(x1, (tx + 1) * kTileSize);
+            const int sy0 = std::max(y0, ty * kTileSize);
+            const int sy1 = std::min(y1, (ty + 1) * kTileSize);
+            const int n = sx1 - sx0;
+            for (int y = sy0; y < sy1; ++y) {
+                const std::uint8_t* mask = dab.alpha.data() + static_cast<std::size_t>(y - y0) * dab.size + (sx0 - x0);
+                const std::uint8_t* paper = grain ? grainRow(y - grainY_) + ((sx0 - grainX_) & kGrainMask) : nullptr;
+                scaleCoverage(coverage_.data(), mask, paper, n, opacity);
+                std::uint32_t* row = t.pixels.data() + static_cast<std::size_t>(y - ty * kTileSize) * kTileSize +
+                                     (sx0 - tx * kTileSize);
+                blendRow(row, coverage_.data(), n, colorRGB);
+            }
+        }
+    }
+}
+
+MemoryUsage BrushEngine::memoryUsage() const {
+    MemoryUsage u = stamps_.memoryUsage();
+    u.addVector(scratch_);
+    return u;
+}
+
+bool BrushEngine::usesDabs(const Stroke& s, double zoomExp) {
+    if (s.brush() == BrushKind::Pen) return false;
+    const double px = s.widthScreen(zoomExp);
+    return px >= kMinDabPx && px <= kMaxDabPx;
+}
+
+void BrushEngine::begin(const Stroke& s, const Camera& cam, const Rect& viewport, double pixelRatio,
+                        BrushLayer& layer) {
+    layer_ = &layer;
+    layer.setPixelRatio(pixelRatio);
+    const Vec2 offset = cam.offsetPx();
+    cam_.setState(cam.zoomExp() + std::log2(pixelRatio), Vec2{offset.x * pixelRatio, offset.y * pixelRatio},
+                  cam.worldCenter());
+    kind_ = s.brush();
+    colorRGB_ = s.colorRGB();
+    const double diameter = std::clamp(s.widthScreen(cam.zoomExp()), kMinDabPx, kMaxDabPx) * pixelRatio;
+    stamp_ = &stamps_.stamp(kind_, diameter);
+    const KindParams& params = kParams[static_cast<int>(kind_)];
+    spacing_ = std::max(kMinSpacingPx, diameter * params.spacing);
+    opacity_ = params.opacity;
+    // A dab centred this far outside the viewport can still reach into it.
+    clip_ = Rect(viewport.minX * pixelRatio, viewport.minY * pixelRatio, viewport.maxX * pixelRatio,
+                 viewport.maxY * pixelRatio).inflated(stamp_->size * 0.5 + 1.0);
+    walked_ = 0;
+    carry_ = 0.0;
+    const Vec2 paper = cam_.screenFromWorld(0.0, 0.0);
+    layer.setGrainOrigin(static_cast<int>(std::lround(std::fmod(paper.x, kGrainSize))),
+                         static_cast<int>(std::lround(std::fmod(paper.y, kGrainSize))));
+}
+
+void BrushEngine::extend(const Stroke& s) {
+    if (!layer_) return;
+    const std::vector<Vec2>& pts = s.pointsWorld(scratch_);
+    if (pts.size() <= walked_) return;
+    walk(pts, walked_);
+    walked_ = pts.size();
+}
+
+void BrushEngine::draw(const Stroke& s, const Camera& cam, const Rect& viewport, double pixelRatio,
+                       BrushLayer& layer) {
+    begin(s, cam, viewport, pixelRatio, layer);
+    walk(s.pointsWorld(scratch_), 0);
+    layer_ = nullptr;
+}
+
+void BrushEngine::walk(const std::vector<Vec2>& pts, std::size_t from) {
+    for (std::size_t j = from; j < pts.size(); ++j) {
+        const Vec2 p = cam_.screenFromWorld(pts[j].x, pts[j].y);
+        if (j == 0) {
+            dab(p);
+            last_ = p;
+            carry_ = 0.0;
+            continue;
+        }
+        const Vec2 d = p - last_;
+        const double len = std::hypot(d.x, d.y);
+        const double first = spacing_ - carry_; // distance to the next dab
+        if (len < first) {
+            carry_ += len;
+            last_ = p;
+            continue;
+        }
+
+        // Only the part of the segment near the viewport is stamped; the
+        // spacing carries over the rest arithmetically.
+        double t0 = 0.0, t1 = 0.0;
+        if (clipSegment(last_, p, clip_, t0, t1)) {
+            double t = first;
+            if (t < t0 * len) t += std::ceil((t0 * len - t) / spacing_) * spacing_;
+            for (const double end = t1 * len; t <= end; t += spacing_) {
+                dab({last_.x + d.x * (t / len), last_.y + d.y * (t / len)});
+            }
+        }
+        carry_ = std::fmod(len - first, spacing_);
+        last_ = p;
+    }
+}
+
+void BrushEngine::dab(const Vec2& at) {
+    if (!clip_.contains(at)) return;
+    layer_->stamp(*stamp_, at.x, at.y, colorRGB_, opacity_, kind_ == BrushKind::Grain);
+}
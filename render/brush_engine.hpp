@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "camera.hpp"
+#include "elements/stroke.hpp"
+#include "memory_usage.hpp"
+#include "types.hpp"
+
+// Coverage of one dab, centred in a size x size square.
+struct BrushStamp {
+    int size = 0;
+    std::vector<std::uint8_t> alpha;
+};
+
+// Dab masks per brush kind, by diameter rounded to an eighth of an octave.
+class StampCache {
+public:
+    const BrushStamp& stamp(BrushKind kind, double diameterPx);
+    MemoryUsage memoryUsage() const;
+
+private:
+    std::unordered_map<std::uint32_t, BrushStamp> stamps_;
+};
+
+// Sparse premultiplied ARGB32 tiles, laid out like QImage's
+// Format_ARGB32_Premultiplied, in the device pixels of one camera. Dabs are
+// blended in with SSE2 where available and a bit-identical scalar loop
+// elsewhere.
+class BrushLayer {
+public:
+    static constexpr int kTileSize = 256;
+
+    struct Tile {
+        int tx = 0;
+        int ty = 0;
+        std::vector<std::uint32_t> pixels; // kTileSize rows of kTileSize
+    };
+
+    // Drops the tiles but keeps their memory for the next frame.
+    void clear();
+    bool empty() const { return used_ == 0; }
+    std::size_t tileCount() const { return used_; }
+    const Tile& tile(std::size_t i) const { return tiles_[i]; }
+    // Cleared tiles keep their pixels for reuse and count as reserved.
+    MemoryUsage memoryUsage() const;
+
+    // Device pixels per screen pixel; tile (tx, ty) covers screen pixels
+    // from tx * kTileSize / pixelRatio().
+    void setPixelRatio(double ratio) { pixelRatio_ = ratio; }
+    double pixelRatio() const { return pixelRatio_; }
+
+    // The paper texture of grainy dabs is fixed to this layer pixel, so it
+    // can follow the board while the view pans.
+    void setGrainOrigin(int x, int y) { grainX_ = x; grainY_ = y; }
+    // Source-over of colorRGB at coverage mask * opacity / 255, with the
+    // dab centred on (cx, cy); grain further multiplies by the paper texture.
+    void stamp(const BrushStamp& dab, double cx, double cy, std::uint32_t colorRGB, int opacity, bool grain);
+
+private:
+    Tile& tileAt(int tx, int ty);
+
+    std::vector<Tile> tiles_;
+    std::size_t used_ = 0;
+    std::unordered_map<std::uint64_t, std::size_t> lookup_;
+    std::vector<std::uint8_t> coverage_;
+    int grainX_ = 0;
+    int grainY_ = 0;
+    double pixelRatio_ = 1.0;
+};
+
+// Places dabs along a stroke at a spacing derived from its screen width.
+// An engine follows one stroke at a time, so the stroke being drawn can be
+// extended as its points arrive instead of being re-stamped every frame.
+class BrushEngine {
+public:
+    // Outside this width, a brush stroke is drawn like a pen stroke.
+    static constexpr double kMinDabPx = 1.0;
+    static constexpr double kMaxDabPx = 512.0;
+    static bool usesDabs(const Stroke& s, double zoomExp);
+
+    // Follows s in the screen space of cam, rasterized at pixelRatio device
+    // pixels per screen pixel; dabs off the viewport are skipped.
+    void begin(const Stroke& s, const Camera& cam, const Rect& viewport, double pixelRatio, BrushLayer& layer);
+    // Dabs for the points s gained since begin() or the previous call.
+    void extend(const Stroke& s);
+    // A whole finished stroke. It walks every point, as extend() did while
+    // the stroke was drawn, so the dabs do not move when the stroke ends.
+    void draw(const Stroke& s, const Camera& cam, const Rect& viewport, double pixelRatio, BrushLayer& layer);
+
+    MemoryUsage memoryUsage() const;
+
+private:
+    void walk(const std::vector<Vec2>& pts, std::size_t from);
+    void dab(const Vec2& at);
+
+    StampCache stamps_;
+    BrushLayer* layer_ = nullptr;
+    const BrushStamp* stamp_ = nullptr;
+    Camera cam_;               // in device pixels
+    Rect clip_;
+    BrushKind kind_ = BrushKind::Soft;
+    std::uint32_t colorRGB_ = 0;
+    int opacity_ = 255;
+    double spacing_ = 1.0;
+    std::size_t walked_ = 0;  // stroke points already walked
+    Vec2 last_;               // screen position of the last walked point
+    double carry_ = 0.0;      // distance walked since the last dab
+    std::vector<Vec2> scratch_;
+};
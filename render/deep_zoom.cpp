@@ -0,0 +1,134 @@
+#include "deep_zoom.hpp"
+#include "stroke_list.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace {
+// Antialiasing and the hairline minimum reach this far past the ink bounds.
+constexpr double kFringePx = 2.0;
+// Strokes whose bounds cover no more tiles than this skip the segment walk.
+constexpr std::int64_t kBoundsOnlyTiles = 4;
+
+int clampIndex(double v, int count) {
+    return static_cast<int>(std::clamp(std::floor(v), 0.0, static_cast<double>(count)));
+}
+
+std::uint64_t mix(std::uint64_t h, std::uint64_t v) {
+    return (h ^ v) * 0x100000001B3ull;
+}
+}
+
+DeepZoomLayout::DeepZoomLayout(const Rect& region, double zoomExp, int tileSize)
+    : region(region), zoomExp(zoomExp), tileSize(std::max(1, tileSize)) {
+    const double scale = std::exp2(zoomExp);
+    const double w = std::ceil(region.width() * scale);
+    const double h = std::ceil(region.height() * scale);
+    if (region.empty() || !(w >= 1.0 && h >= 1.0 && w <= kMaxSidePx && h <= kMaxSidePx)) return;
+    width = static_cast<int>(w);
+    height = static_cast<int>(h);
+    while ((1 << maxLevel) < std::max(width, height)) ++maxLevel;
+}
+
+int DeepZoomLayout::levelWidth(int level) const {
+    const int shift = maxLevel - level;
+    return std::max(1, (width + (1 << shift) - 1) >> shift);
+}
+
+int DeepZoomLayout::levelHeight(int level) const {
+    const int shift = maxLevel - level;
+    return std::max(1, (height + (1 << shift) - 1) >> shift);
+}
+
+int DeepZoomLayout::tilesX(int level) const {
+    return (levelWidth(level) + tileSize - 1) / tileSize;
+}
+
+int DeepZoomLayout::tilesY(int level) const {
+    return (levelHeight(level) + tileSize - 1) / tileSize;
+}
+
+std::size_t DeepZoomLayout::tileCount() const {
+    if (!valid()) return 0;
+    std::size_t n = 0;
+    for (int l = 0; l <= maxLevel; ++l) n += static_cast<std::size_t>(tilesX(l)) * static_cast<std::size_t>(tilesY(l));
+    return n;
+}
+
+Rect DeepZoomLayout::tileRect(int level, int col, int row) const {
+    const double perPx = std::exp2(-levelZoomExp(level));
+    const int x0 = col * tileSize;
+    const int y0 = row * tileSize;
+    const int x1 = std::min(x0 + tileSize, levelWidth(level));
+    const int y1 = std::min(y0 + tileSize, levelHeight(level));
+    return Rect(region.minX + x0 * perPx, region.minY + y0 * perPx, region.minX + x1 * perPx, region.minY + y1 * perPx);
+}
+
+DeepZoomLayout::TileRange DeepZoomLayout::tilesIn(int level, const Rect& worldRect) const {
+    TileRange r;
+    if (!valid() || worldRect.empty() || !worldRect.intersects(region)) return r;
+    const double tilePerWorld = std::exp2(levelZoomExp(level)) / tileSize;
+    const int tx = tilesX(level);
+    const int ty = tilesY(level);
+    r.col0 = clampIndex((worldRect.minX - region.minX) * tilePerWorld, tx);
+    r.row0 = clampIndex((worldRect.minY - region.minY) * tilePerWorld, ty);
+    r.col1 = clampIndex((worldRect.maxX - region.minX) * tilePerWorld + 1.0, tx);
+    r.row1 = clampIndex((worldRect.maxY - region.minY) * tilePerWorld + 1.0, ty);
+    return r;
+}
+
+std::vector<std::vector<std::uint64_t>> deepZoomTilesTouched(const DeepZoomLayout& layout, const StrokeList& strokes,
+                                                             std::size_t from) {
+    std::vector<std::vector<std::uint64_t>> touched(layout.valid() ? layout.maxLevel + 1 : 0);
+    std::vector<Vec2> scratch;
+    auto mark = [](std::vector<std::uint64_t>& out, const DeepZoomLayout::TileRange& r) {
+        for (int row = r.row0; row < r.row1; ++row) {
+            for (int col = r.col0; col < r.col1; ++col) out.push_back(deepZoomTileKey(col, row));
+        }
+    };
+    for (std::size_t i = from; i < strokes.size(); ++i) {
+        const Stroke& s = strokes[i];
+        if (s.empty()) continue;
+        const double halfWidth = std::exp2(s.widthExp()) * 0.5;
+        const std::vector<Vec2>* pts = nullptr;
+        for (int l = 0; l <= layout.maxLevel && layout.valid(); ++l) {
+            const double reach = halfWidth + kFringePx * std::exp2(-layout.levelZoomExp(l));
+            std::vector<std::uint64_t>& out = touched[static_cast<std::size_t>(l)];
+            const DeepZoomLayout::TileRange all = layout.tilesIn(l, s.bounds().inflated(reach));
+            if (all.empty()) break; // finer levels reach less far
+            const std::int64_t area = static_cast<std::int64_t>(all.col1 - all.col0) * (all.row1 - all.row0);
+            if (area <= kBoundsOnlyTiles) {
+                mark(out, all);
+                continue;
+            }
+            if (!pts) pts = &s.pointsWorld(scratch);
+            DeepZoomLayout::TileRange last;
+            for (std::size_t k = 1; k < pts->size(); ++k) {
+                const Rect seg = Rect((*pts)[k - 1].x, (*pts)[k - 1].y, (*pts)[k].x, (*pts)[k].y).inflated(reach);
+                const DeepZoomLayout::TileRange r = layout.tilesIn(l, seg);
+                // Neighbouring segments mostly stay in the same tiles.
+                if (r.col0 == last.col0 && r.row0 == last.row0 && r.col1 == last.col1 && r.row1 == last.row1) continue;
+                mark(out, r);
+                last = r;
+            }
+        }
+    }
+    for (std::vector<std::uint64_t>& level : touched) {
+        std::sort(level.begin(), level.end());
+        level.erase(std::unique(level.begin(), level.end()), level.end());
+    }
+    return touched;
+}
+
+std::uint64_t strokesSignature(const StrokeList& strokes, std::size_t count) {
+    std::uint64_t h = 0xCBF29CE484222325ull;
+    count = std::min(count, strokes.size());
+    for (std::size_t i = 0; i < count; ++i) {
+        const Stroke& s = strokes[i];
+        const Rect b = s.bounds();
+        h = mix(h, s.pointCount());
+        for (double v : {b.minX, b.minY, b.maxX, b.maxY, s.widthExp()}) h = mix(h, std::bit_cast<std::uint64_t>(v));
+        h = mix(h, (static_cast<std::uint64_t>(s.brush()) << 32) | s.colorRGB());
+    }
+    return h;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "types.hpp"
+
+class StrokeList;
+
+// Geometry of a Deep Zoom (DZI) image of a board region, without overlap.
+// The deepest level shows the region at 2^zoomExp pixels per world unit;
+// each level above halves both sides (rounding up) and level 0 is a single
+// pixel. Coordinates are scene-local.
+struct DeepZoomLayout {
+    static constexpr int kDefaultTileSize = 256;
+    // Beyond this many pixels a side the deepest level is refused.
+    static constexpr int kMaxSidePx = 1 << 24;
+
+    Rect region;
+    double zoomExp = 0.0;
+    int tileSize = kDefaultTileSize;
+    int width = 0;
+    int height = 0;
+    int maxLevel = 0;
+
+    DeepZoomLayout() = default;
+    DeepZoomLayout(const Rect& region, double zoomExp, int tileSize = kDefaultTileSize);
+    bool valid() const { return width > 0 && height > 0; }
+
+    int levelWidth(int level) const;
+    int levelHeight(int level) const;
+    int tilesX(int level) const;
+    int tilesY(int level) const;
+    double levelZoomExp(int level) const { return zoomExp - (maxLevel - level); }
+    std::size_t tileCount() const; // all levels
+
+    // World rectangle tile (col, row) of level shows; edge tiles are cut
+    // at the level's size.
+    Rect tileRect(int level, int col, int row) const;
+    // Tiles [col0, col1) x [row0, row1) of level that worldRect touches.
+    struct TileRange {
+        int col0 = 0, row0 = 0, col1 = 0, row1 = 0;
+        bool empty() const { return col0 >= col1 || row0 >= row1; }
+    };
+    TileRange tilesIn(int level, const Rect& worldRect) const;
+};
+
+// (row << 32) | col, which sorts tiles in row order.
+inline std::uint64_t deepZoomTileKey(int col, int row) {
+    return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(row)) << 32) | static_cast<std::uint32_t>(col);
+}
+
+// Tiles strokes[from, end) may have inked, as sorted unique keys per level.
+// Follows each stroke segment by segment, so a long diagonal stroke marks
+// the tiles along it rather than its whole bounding box.
+std::vector<std::vector<std::uint64_t>> deepZoomTilesTouched(const DeepZoomLayout& layout, const StrokeList& strokes,
+                                                             std::size_t from);
+
+// Changes whenever the points or style of any of strokes[0, count) do.
+std::uint64_t strokesSignature(const StrokeList& strokes, std::size_t count);
@@ -0,0 +1,242 @@
+#include "density_raster.hpp"
+#include "elements/stroke.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr int kTileShift = 6; // log2(kTileCells)
+constexpr std::size_t kCellsPerTile = static_cast<std::size_t>(DensityRaster::kTileCells) * DensityRaster::kTileCells;
+// Antialiasing reaches this far past a path, in cells of the level.
+constexpr double kFringeCells = 2.0;
+static_assert((1 << kTileShift) == DensityRaster::kTileCells);
+
+// Arithmetic shifts floor negative indices as well.
+std::uint64_t tileOf(std::uint64_t cell) {
+    return indexKey(keyX(cell) >> kTileShift, keyY(cell) >> kTileShift);
+}
+std::size_t slotOf(std::uint64_t cell) {
+    const auto x = static_cast<std::size_t>(keyX(cell) & (DensityRaster::kTileCells - 1));
+    const auto y = static_cast<std::size_t>(keyY(cell) & (DensityRaster::kTileCells - 1));
+    return y * DensityRaster::kTileCells + x;
+}
+}
+
+void DensityRaster::clear() {
+    levels_.clear();
+    finest_ = 0;
+    bounds_ = Rect{};
+    strokes_ = 0;
+    rebuild_ = false;
+    ++revision_;
+}
+
+MemoryUsage DensityRaster::memoryUsage() const {
+    MemoryUsage u;
+    u.addVector(levels_);
+    for (const Level& level : levels_) {
+        u.addMap(level);
+        for (const auto& [k, tile] : level) {
+            u.addVector(tile.cells);
+            // Shared with frames in flight; counted here once.
+            if (tile.pixels) u.addVector(*tile.pixels);
+        }
+    }
+    u.addVector(deposit_);
+    u.addVector(scratch_);
+    return u;
+}
+
+void DensityRaster::fit(const Rect& bounds) {
+    // The coarsest level then holds the extent in about one tile.
+    const int want = fitInkLevel(bounds, static_cast<double>(kTileCells) * (1 << (kLevelCount - 1)));
+    if (levels_.empty()) {
+        finest_ = want;
+        levels_.resize(kLevelCount);
+        return;
+    }
+    // The ink spread: the finest level goes and a coarser one is merged
+    // from the current top. Strokes too wide for the old top may be thin
+    // enough for the new one, but their ink was never summed: tiles they
+    // crossed stay thick until a rebuild.
+    for (; finest_ < want; ++finest_) {
+        Level up;
+        for (const auto& [k, tile] : levels_.back()) {
+            Tile& parent = up[parentKey(k)];
+            parent.thick = parent.thick || tile.thick;
+            rebuild_ = rebuild_ || tile.thick;
+            parent.stale = parent.stale || tile.stale;
+            if (tile.cells.empty()) continue;
+            if (parent.cells.empty()) parent.cells.resize(kCellsPerTile);
+            const int ox = (keyX(k) & 1) * (kTileCells / 2);
+            const int oy = (keyY(k) & 1) * (kTileCells / 2);
+            for (int y = 0; y < kTileCells; ++y) {
+                for (int x = 0; x < kTileCells; ++x) {
+                    parent.cells[static_cast<std::size_t>(oy + y / 2) * kTileCells + ox + x / 2].add(
+                        tile.cells[static_cast<std::size_t>(y) * kTileCells + x], 0.25f);
+                }
+            }
+        }
+        levels_.erase(levels_.begin());
+        levels_.push_back(std::move(up));
+    }
+    ++revision_;
+}
+
+void DensityRaster::markThick(const std::vector<Vec2>& pts, const Vec2& origin, double reach, int level) {
+    const double tileWorld = std::exp2(level) * kTileCells;
+    Level& tiles = levels_[static_cast<std::size_t>(level - finest_)];
+    std::int32_t last[4] = {1, 1, 0, 0}; // an empty range
+    for (std::size_t k = 1; k < pts.size(); ++k) {
+        const Vec2 a = pts[k - 1] + origin;
+        const Vec2 b = pts[k] + origin;
+        const std::int32_t r[4] = {
+            floorIndex((std::min(a.x, b.x) - reach) / tileWorld), floorIndex((std::min(a.y, b.y) - reach) / tileWorld),
+            floorIndex((std::max(a.x, b.x) + reach) / tileWorld), floorIndex((std::max(a.y, b.y) + reach) / tileWorld),
+        };
+        // Neighbouring segments mostly stay in the same tiles.
+        if (std::equal(r, r + 4, last)) continue;
+        std::copy(r, r + 4, last);
+        for (std::int32_t ty = r[1]; ty <= r[3]; ++ty) {
+            for (std::int32_t tx = r[0]; tx <= r[2]; ++tx) tiles[indexKey(tx, ty)].thick = true;
+        }
+    }
+}
+
+void DensityRaster::store(const InkDeposit& cells, int level) {
+    Level& tiles = levels_[static_cast<std::size_t>(level - finest_)];
+    Tile* tile = nullptr;
+    std::uint64_t tileKey = 0;
+    for (const auto& [k, c] : cells) {
+        // Sorted by x, then y: runs of cells share a tile.
+        const std::uint64_t t = tileOf(k);
+        if (!tile || t != tileKey) {
+            tile = &tiles[t];
+            tileKey = t;
+            if (tile->cells.empty()) tile->cells.resize(kCellsPerTile);
+            ++tile->revision;
+        }
+        tile->cells[slotOf(k)].add(c);
+    }
+}
+
+void DensityRaster::cover(const Rect& area) {
+    if (area.empty()) return;
+    bounds_.expand(area);
+    fit(bounds_);
+}
+
+void DensityRaster::add(const Stroke& s, const Vec2& origin) {
+    ++strokes_;
+    ++revision_;
+    if (s.empty()) return;
+    bounds_.expand(s.inkBounds().translated(origin));
+    fit(bounds_);
+
+    const std::vector<Vec2>& pts = s.pointsWorld(scratch_);
+    const double width = std::exp2(s.widthExp());
+    // Thin from the first level whose cells are wider than the stroke.
+    const int thin = std::clamp(static_cast<int>(std::floor(s.widthExp())) + 1, finest_, coarsestLevel() + 1);
+    for (int l = finest_; l < thin; ++l) markThick(pts, origin, width * 0.5 + kFringeCells * std::exp2(l), l);
+    if (thin > coarsestLevel()) return;
+
+    deposit_.clear();
+    for (std::size_t i = 1; i < pts.size(); ++i) {
+        depositSegment(deposit_, pts[i - 1] + origin, pts[i] + origin, width, s.colorRGB(), thin);
+    }
+    mergeDeposit(deposit_);
+    for (int l = thin; l <= coarsestLevel(); ++l) {
+        if (l > thin) {
+            depositToParents(deposit_);
+            mergeDeposit(deposit_);
+        }
+        store(deposit_, l);
+    }
+}
+
+void DensityRaster::markStale(const Rect& area) {
+    if (area.empty()) return;
+    for (int l = finest_; l <= coarsestLevel(); ++l) {
+        const double tileWorld = std::exp2(l) * kTileCells;
+        const Rect a = area.inflated(kFringeCells * std::exp2(l));
+        Level& tiles = levels_[static_cast<std::size_t>(l - finest_)];
+        for (std::int32_t ty = floorIndex(a.minY / tileWorld); ty <= floorIndex(a.maxY / tileWorld); ++ty) {
+            for (std::int32_t tx = floorIndex(a.minX / tileWorld); tx <= floorIndex(a.maxX / tileWorld); ++tx) {
+                const auto it = tiles.find(indexKey(tx, ty));
+                if (it == tiles.end()) continue; // no ink was summed there
+                it->second.stale = true;
+                rebuild_ = true;
+            }
+        }
+    }
+    ++revision_;
+}
+
+std::shared_ptr<const std::vector<std::uint32_t>> DensityRaster::blend(const Tile& tile) {
+    auto out = std::make_shared<std::vector<std::uint32_t>>(kCellsPerTile, 0u);
+    for (std::size_t i = 0; i < kCellsPerTile; ++i) {
+        const InkCell& c = tile.cells[i];
+        if (!(c.ink > 0.0f)) continue;
+        // Thin strokes land at random over a cell, so coverage compounds
+        // rather than adds.
+        const double a = 1.0 - std::exp(-static_cast<double>(c.ink));
+        const auto channel = [&](float sum) {
+            return static_cast<std::uint32_t>(std::clamp(std::lround(sum / c.ink * a), 0l, 255l));
+        };
+        (*out)[i] = (static_cast<std::uint32_t>(std::lround(a * 255.0)) << 24) |
+                    (channel(c.r) << 16) | (channel(c.g) << 8) | channel(c.b);
+    }
+    return out;
+}
+
+bool DensityRaster::plan(double zoomExp, const Rect& viewRect, const Vec2& origin, DensityFrame& out) {
+    out.images.clear();
+    out.pathAreas.clear();
+    out.strokes = 0;
+    out.imageSize = kTileCells;
+    // Cells of level floor(-zoomExp) are half a pixel to a pixel wide.
+    const double want = std::floor(-zoomExp);
+    if (levels_.empty() || viewRect.empty() || !(want >= finest_)) return false;
+    const int level = static_cast<int>(std::min(want, static_cast<double>(coarsestLevel())));
+    Level& tiles = levels_[static_cast<std::size_t>(level - finest_)];
+
+    const double tileWorld = std::exp2(level) * kTileCells;
+    // Tiles exist only where ink or a path fringe reached, so a view zoomed
+    // out past the coarsest level walks the ink's tiles, not the view's.
+    const Rect reach = bounds_.inflated(kFringeCells * std::exp2(level));
+    const Rect view = viewRect.translated(origin);
+    const std::int32_t tx0 = floorIndex(std::max(view.minX, reach.minX) / tileWorld);
+    const std::int32_t tx1 = floorIndex(std::min(view.maxX, reach.maxX) / tileWorld);
+    const std::int32_t ty0 = floorIndex(std::max(view.minY, reach.minY) / tileWorld);
+    const std::int32_t ty1 = floorIndex(std::min(view.maxY, reach.maxY) / tileWorld);
+    auto area = [&](std::int32_t x0, std::int32_t x1, std::int32_t y) {
+        return Rect(x0 * tileWorld - origin.x, y * tileWorld - origin.y,
+                    x1 * tileWorld - origin.x, (y + 1) * tileWorld - origin.y);
+    };
+    for (std::int32_t ty = ty0; ty <= ty1; ++ty) {
+        std::int32_t run = tx0; // first tile of the current run of path tiles
+        bool inRun = false;
+        for (std::int32_t tx = tx0; tx <= tx1 + 1; ++tx) {
+            Tile* tile = nullptr;
+            if (tx <= tx1) {
+                const auto it = tiles.find(indexKey(tx, ty));
+                if (it != tiles.end()) tile = &it->second;
+            }
+            const bool path = tile && (tile->thick || tile->stale);
+            if (path && !inRun) {
+                run = tx;
+                inRun = true;
+            } else if (!path && inRun) {
+                out.pathAreas.push_back(area(run, tx, ty));
+                inRun = false;
+            }
+            if (!tile || path || tile->cells.empty()) continue;
+            if (!tile->pixels || tile->pixelsRevision != tile->revision) {
+                tile->pixels = blend(*tile);
+                tile->pixelsRevision = tile->revision;
+            }
+            out.images.push_back({area(tx, tx + 1, ty), tile->pixels});
+        }
+    }
+    out.strokes = strokes_;
+    return true;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "ink_cells.hpp"
+#include "memory_usage.hpp"
+#include "types.hpp"
+
+class Stroke;
+
+// What one frame takes from a DensityRaster: pre-blended images for the
+// areas whose strokes are all thinner than a pixel, and the areas where
+// strokes must still be drawn as paths. Pixels are shared, not copied, so
+// a frame can go to the render thread while the raster keeps changing.
+struct DensityFrame {
+    struct Image {
+        Rect area; // scene-local
+        std::shared_ptr<const std::vector<std::uint32_t>> pixels; // premultiplied ARGB32 rows
+    };
+    std::vector<Image> images;
+    // Scene-local. Strokes [0, strokes) are in the images and draw as paths
+    // only inside these; later strokes draw everywhere.
+    std::vector<Rect> pathAreas;
+    std::size_t strokes = 0;
+    int imageSize = 0; // pixels per side of every image
+};
+
+// Ink of strokes too thin to stroke one by one when zoomed far out. Level L
+// has square cells 2^L board units wide (board = scene-local plus the
+// scene origin) grouped in tiles of kTileCells; a stroke's ink is summed
+// into the cells of every level where it is thinner than a cell, and it
+// marks the tiles it crosses at finer levels as needing paths. Only
+// kLevelCount levels are kept, the coarsest with the ink's extent in about
+// one tile, so a frame costs its pixel count whatever the number of
+// strokes. Ink cannot be taken back out: erased areas are marked stale and
+// draw as paths until the raster is rebuilt, and so do tiles that growing
+// the levels could not fill (see fit()).
+class DensityRaster {
+public:
+    static constexpr int kTileCells = 64;
+    static constexpr int kLevelCount = 6;
+
+    void clear();
+    // Strokes added so far; they are the scene's [0, strokeCount()).
+    std::size_t strokeCount() const { return strokes_; }
+    // Bumped by every change that can alter a frame.
+    std::uint64_t revision() const { return revision_; }
+    // Erasing or growth left tiles drawing as paths that a rebuild from
+    // the scene, started with cover(), would turn back into ink.
+    bool needsRebuild() const { return rebuild_; }
+    MemoryUsage memoryUsage() const;
+
+    // Fits the levels to area (board units) up front, so that strokes added
+    // inside it never make them grow.
+    void cover(const Rect& area);
+    // origin is the scene origin that the stroke's points are relative to.
+    void add(const Stroke& s, const Vec2& origin);
+    // Tiles touching area (board units) draw as paths until the next rebuild.
+    void markStale(const Rect& area);
+
+    // Splits viewRect (scene-local) for a view at zoomExp. Returns false,
+    // with out empty, if the zoom is closer than the finest level.
+    bool plan(double zoomExp, const Rect& viewRect, const Vec2& origin, DensityFrame& out);
+
+private:
+    struct Tile {
+        std::vector<InkCell> cells; // kTileCells^2 rows, allocated with the first ink
+        bool thick = false;      // a stroke too wide for the level crosses it
+        bool stale = false;
+        std::uint64_t revision = 0;
+        std::shared_ptr<const std::vector<std::uint32_t>> pixels;
+        std::uint64_t pixelsRevision = 0;
+    };
+    using Level = std::unordered_map<std::uint64_t, Tile>;
+
+    int coarsestLevel() const { return finest_ + static_cast<int>(levels_.size()) - 1; }
+    void fit(const Rect& bounds);
+    void markThick(const std::vector<Vec2>& pts, const Vec2& origin, double reach, int level);
+    void store(const InkDeposit& cells, int level);
+    static std::shared_ptr<const std::vector<std::uint32_t>> blend(const Tile& tile);
+
+    std::vector<Level> levels_; // finest first
+    int finest_ = 0;
+    Rect bounds_;
+    std::size_t strokes_ = 0;
+    std::uint64_t revision_ = 0;
+    bool rebuild_ = false;
+
+    InkDeposit deposit_;
+    std::vector<Vec2> scratch_;
+};
@@ -0,0 +1,58 @@
+#include "ink_cells.hpp"
+#include <cfloat>
+
+namespace {
+// The finest cell is at least this many octaves below the largest board
+// coordinate.
+constexpr int kIndexOctaves = 29;
+}
+
+int fitInkLevel(const Rect& bounds, double cellsAcross) {
+    const double extent = std::max(bounds.width(), bounds.height());
+    const double maxAbs = std::max({std::abs(bounds.minX), std::abs(bounds.maxX),
+                                    std::abs(bounds.minY), std::abs(bounds.maxY)});
+    int level = static_cast<int>(std::ceil(std::log2(std::max(extent / cellsAcross, DBL_MIN))));
+    if (maxAbs > 0.0) level = std::max(level, std::ilogb(maxAbs) - kIndexOctaves);
+    return level;
+}
+
+void depositSegment(InkDeposit& out, const Vec2& a, const Vec2& b, double inkWidth,
+                    std::uint32_t colorRGB, int level) {
+    const double cell = std::exp2(level);
+    const Vec2 d = b - a;
+    const double len = std::hypot(d.x, d.y);
+    const int n = std::max(1, static_cast<int>(std::ceil(len / (cell * 0.5))));
+    const double ink = len / n * inkWidth / (cell * cell);
+    InkCell c;
+    c.ink = static_cast<float>(ink);
+    c.r = static_cast<float>(ink * ((colorRGB >> 16) & 0xFF));
+    c.g = static_cast<float>(ink * ((colorRGB >> 8) & 0xFF));
+    c.b = static_cast<float>(ink * (colorRGB & 0xFF));
+    for (int i = 0; i < n; ++i) {
+        const double t = (i + 0.5) / n;
+        out.emplace_back(indexKey(floorIndex((a.x + d.x * t) / cell), floorIndex((a.y + d.y * t) / cell)), c);
+    }
+}
+
+void depositToParents(InkDeposit& cells) {
+    for (auto& [k, c] : cells) {
+        k = parentKey(k);
+        c.ink *= 0.25f;
+        c.r *= 0.25f;
+        c.g *= 0.25f;
+        c.b *= 0.25f;
+    }
+}
+
+void mergeDeposit(InkDeposit& cells) {
+    std::sort(cells.begin(), cells.end(), [](const auto& x, const auto& y) { return x.first < y.first; });
+    std::size_t out = 0;
+    for (std::size_t i = 0; i < cells.size(); ++i) {
+        if (out > 0 && cells[out - 1].first == cells[i].first) {
+            cells[out - 1].second.add(cells[i].second);
+        } else {
+            cells[out++] = cells[i];
+        }
+    }
+    cells.resize(out);
+}
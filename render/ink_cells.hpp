@@ -0,0 +1,52 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "types.hpp"
+
+// Ink summed over square cells, shared by SummaryPyramid and DensityRaster.
+// A level-L cell is 2^L board units wide; cells (and tiles of them) are keyed
+// by their packed integer indices.
+
+struct InkCell {
+    float ink = 0.0f;   // covered fraction of the cell; overlaps add up
+    float r = 0.0f;     // colour channels weighted by ink
+    float g = 0.0f;
+    float b = 0.0f;
+
+    void add(const InkCell& o, float weight = 1.0f) {
+        ink += o.ink * weight;
+        r += o.r * weight;
+        g += o.g * weight;
+        b += o.b * weight;
+    }
+};
+
+// Ink from one stroke, before it is added to a level.
+using InkDeposit = std::vector<std::pair<std::uint64_t, InkCell>>;
+
+inline std::uint64_t indexKey(std::int32_t x, std::int32_t y) {
+    return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32) | static_cast<std::uint32_t>(y);
+}
+inline std::int32_t keyX(std::uint64_t k) { return static_cast<std::int32_t>(static_cast<std::uint32_t>(k >> 32)); }
+inline std::int32_t keyY(std::uint64_t k) { return static_cast<std::int32_t>(static_cast<std::uint32_t>(k)); }
+// Arithmetic shifts floor negative indices as well.
+inline std::uint64_t parentKey(std::uint64_t k) { return indexKey(keyX(k) >> 1, keyY(k) >> 1); }
+
+inline std::int32_t floorIndex(double v) {
+    return static_cast<std::int32_t>(std::clamp(std::floor(v), -2147483648.0, 2147483647.0));
+}
+
+// The finest level whose cells span bounds in at most cellsAcross, raised
+// so that cell indices stay below 2^30.
+int fitInkLevel(const Rect& bounds, double cellsAcross);
+// Half-cell samples of the segment a-b at level, each with its share of the
+// ink, so a segment misses no cell it crosses by much.
+void depositSegment(InkDeposit& out, const Vec2& a, const Vec2& b, double inkWidth,
+                    std::uint32_t colorRGB, int level);
+// Moves the cells to the next coarser level, a quarter of the ink each.
+void depositToParents(InkDeposit& cells);
+// Sorts by key and sums cells with the same key.
+void mergeDeposit(InkDeposit& cells);
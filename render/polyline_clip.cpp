@@ -0,0 +1,124 @@
+#include "polyline_clip.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace {
+constexpr double kArcTolerancePx = 0.25;
+constexpr int kMinArcSteps = 2;
+constexpr int kMaxArcSteps = 64;
+
+// Liang-Barsky: shrinks [t0, t1] to the part of a + t*(b - a) inside clip.
+bool clipSegment(const Vec2& a, const Vec2& b, const Rect& clip, double& t0, double& t1) {
+    const double dx = b.x - a.x;
+    const double dy = b.y - a.y;
+    const double p[4] = {-dx, dx, -dy, dy};
+    const double q[4] = {a.x - clip.minX, clip.maxX - a.x, a.y - clip.minY, clip.maxY - a.y};
+    t0 = 0.0;
+    t1 = 1.0;
+    for (int i = 0; i < 4; ++i) {
+        if (p[i] == 0.0) {
+            if (q[i] < 0.0) return false;
+            continue;
+        }
+        const double t = q[i] / p[i];
+        if (p[i] < 0.0) {
+            if (t > t1) return false;
+            t0 = std::max(t0, t);
+        } else {
+            if (t < t0) return false;
+            t1 = std::min(t1, t);
+        }
+    }
+    return true;
+}
+
+Vec2 lerp(const Vec2& a, const Vec2& b, double t) {
+    return {a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t};
+}
+
+// Sutherland-Hodgman against one rect edge; inside(p) and cross(a, b) describe the edge.
+template <class Inside, class Cross>
+void clipEdge(const std::vector<Vec2>& in, std::vector<Vec2>& out, Inside inside, Cross cross) {
+    out.clear();
+    if (in.empty()) return;
+    Vec2 prev = in.back();
+    bool prevIn = inside(prev);
+    for (const Vec2& cur : in) {
+        const bool curIn = inside(cur);
+        if (curIn != prevIn) out.push_back(cross(prev, cur));
+        if (curIn) out.push_back(cur);
+        prev = cur;
+        prevIn = curIn;
+    }
+}
+
+void clipConvex(std::vector<Vec2>& poly, const Rect& r, std::vector<Vec2>& tmp) {
+    auto atX = [](const Vec2& a, const Vec2& b, double x) { return lerp(a, b, (x - a.x) / (b.x - a.x)); };
+    auto atY = [](const Vec2& a, const Vec2& b, double y) { return lerp(a, b, (y - a.y) / (b.y - a.y)); };
+    clipEdge(poly, tmp, [&](const Vec2& p) { return p.x >= r.minX; }, [&](const Vec2& a, const Vec2& b) { return atX(a, b, r.minX); });
+    clipEdge(tmp, poly, [&](const Vec2& p) { return p.x <= r.maxX; }, [&](const Vec2& a, const Vec2& b) { return atX(a, b, r.maxX); });
+    clipEdge(poly, tmp, [&](const Vec2& p) { return p.y >= r.minY; }, [&](const Vec2& a, const Vec2& b) { return atY(a, b, r.minY); });
+    clipEdge(tmp, poly, [&](const Vec2& p) { return p.y <= r.maxY; }, [&](const Vec2& a, const Vec2& b) { return atY(a, b, r.maxY); });
+}
+}
+
+std::size_t clipPolyline(const Vec2* pts, std::size_t count, const Rect& clip,
+                         std::vector<Vec2>& out, std::vector<std::uint32_t>& runEnds) {
+    std::size_t runs = 0;
+    bool open = false;
+    for (std::size_t i = 0; i + 1 < count; ++i) {
+        double t0 = 0.0, t1 = 1.0;
+        if (!clipSegment(pts[i], pts[i + 1], clip, t0, t1)) {
+            if (open) {
+                runEnds.push_back(static_cast<std::uint32_t>(out.size()));
+                open = false;
+            }
+            continue;
+        }
+        if (!open) {
+            out.push_back(t0 > 0.0 ? lerp(pts[i], pts[i + 1], t0) : pts[i]);
+            open = true;
+            ++runs;
+        }
+        out.push_back(t1 < 1.0 ? lerp(pts[i], pts[i + 1], t1) : pts[i + 1]);
+        if (t1 < 1.0) {
+            runEnds.push_back(static_cast<std::uint32_t>(out.size()));
+            open = false;
+        }
+    }
+    if (open) runEnds.push_back(static_cast<std::uint32_t>(out.size()));
+    return runs;
+}
+
+bool appendClippedCapsule(const Vec2& a, const Vec2& b, double radius, const Rect& clip,
+                          std::vector<Vec2>& out, std::vector<std::uint32_t>& polyEnds) {
+    Rect box(a.x, a.y, b.x, b.y);
+    if (!box.inflated(radius).intersects(clip)) return false;
+
+    const double tol = std::min(kArcTolerancePx, radius);
+    const double stepAngle = 2.0 * std::acos(1.0 - tol / radius);
+    const int steps = std::clamp(static_cast<int>(std::ceil(std::numbers::pi / stepAngle)), kMinArcSteps, kMaxArcSteps);
+
+    const double len = std::hypot(b.x - a.x, b.y - a.y);
+    const double dirAngle = len > 0.0 ? std::atan2(b.y - a.y, b.x - a.x) : 0.0;
+
+    thread_local std::vector<Vec2> poly;
+    thread_local std::vector<Vec2> tmp;
+    poly.clear();
+    // Half circle around b from +normal through the direction to -normal, then back around a.
+    for (int i = 0; i <= steps; ++i) {
+        const double ang = dirAngle - std::numbers::pi / 2 + std::numbers::pi * i / steps;
+        poly.push_back({b.x + radius * std::cos(ang), b.y + radius * std::sin(ang)});
+    }
+    for (int i = 0; i <= steps; ++i) {
+        const double ang = dirAngle + std::numbers::pi / 2 + std::numbers::pi * i / steps;
+        poly.push_back({a.x + radius * std::cos(ang), a.y + radius * std::sin(ang)});
+    }
+
+    clipConvex(poly, clip, tmp);
+    if (poly.size() < 3) return false;
+    out.insert(out.end(), poly.begin(), poly.end());
+    polyEnds.push_back(static_cast<std::uint32_t>(out.size()));
+    return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "types.hpp"
+
+// Screen-space clipping done in double precision before anything reaches the
+// painter, so far off-screen geometry never gets stroked.
+
+// Clips the polyline against clip (Liang-Barsky per segment) and appends the
+// visible runs to out; runEnds receives the exclusive end of each run.
+// Returns the number of runs appended.
+std::size_t clipPolyline(const Vec2* pts, std::size_t count, const Rect& clip,
+                         std::vector<Vec2>& out, std::vector<std::uint32_t>& runEnds);
+
+// Appends the outline of the round-capped segment a-b of the given radius,
+// clipped to clip, as one convex polygon. Returns false if nothing is visible.
+bool appendClippedCapsule(const Vec2& a, const Vec2& b, double radius, const Rect& clip,
+                          std::vector<Vec2>& out, std::vector<std::uint32_t>& polyEnds);
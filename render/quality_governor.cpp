@@ -0,0 +1,31 @@
+#include "quality_governor.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+// Few fixed steps so the render thread's buffer pool keeps matching sizes.
+constexpr double kResolutionSteps[] = {1.0, 0.75, 0.5, 0.35, 0.25};
+constexpr double kSmoothing = 0.25;
+}
+
+void QualityGovernor::reportFrame(double renderMs, double resolution) {
+    if (renderMs <= 0.0 || resolution <= 0.0) return;
+    const double full = renderMs / (resolution * resolution);
+    fullMs_ = fullMs_ == 0.0 ? full : fullMs_ + (full - fullMs_) * kSmoothing;
+}
+
+QualityGovernor::Quality QualityGovernor::interactive(bool scalable) const {
+    Quality q;
+    if (fullMs_ <= targetMs_) return q;
+    if (!scalable) {
+        q.antialias = false;
+        return q;
+    }
+    for (double step : kResolutionSteps) {
+        q.resolution = step;
+        if (fullMs_ * step * step <= targetMs_) return q;
+    }
+    q.resolution = *std::prev(std::end(kResolutionSteps));
+    q.antialias = false;
+    return q;
+}
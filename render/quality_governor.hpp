@@ -0,0 +1,34 @@
+#pragma once
+
+// Render quality for frames shown while the view is moving. Frame cost is
+// taken to grow with the pixel count, so the governor keeps a smoothed
+// estimate of what a full-resolution frame costs and picks the largest
+// resolution step whose predicted time fits the target. Antialiasing goes
+// only when even the smallest step does not fit, or, for frames painted
+// straight to the widget at full resolution, as soon as a frame is over.
+class QualityGovernor {
+public:
+    struct Quality {
+        double resolution = 1.0; // fraction of the device pixel ratio
+        bool antialias = true;
+        bool operator==(const Quality&) const = default;
+    };
+
+    explicit QualityGovernor(double targetMs = 16.0) : targetMs_(targetMs) {}
+
+    // A frame rendered at `resolution` took renderMs.
+    void reportFrame(double renderMs, double resolution);
+
+    double targetMs() const { return targetMs_; }
+    double fullFrameMs() const { return fullMs_; }
+    bool overBudget(double renderMs) const { return renderMs > targetMs_; }
+
+    static Quality full() { return Quality{}; }
+    // scalable: the frame can be rendered at a reduced resolution and
+    // upscaled; otherwise dropping antialiasing is the only lever.
+    Quality interactive(bool scalable = true) const;
+
+private:
+    double targetMs_;
+    double fullMs_ = 0.0; // 0 until the first report
+};
@@ -1,6 +1,273 @@
 #include "renderer.hpp"
-#include <string>
+#include "elements/stroke.hpp"
+#include "metrics.hpp"
+#include "stroke_list.hpp"
+#include <algorithm>
+#include <cmath>
 
-std::string Renderer::formatText(const std::string& s) {
-    return "[Renderer output] " + s;
+namespace {
+// List coordinates are re-anchored once the view is this far from the list
+// origin, so doubles never have to carry huge list coordinates.
+constexpr double kMaxOriginDistancePx = 1 << 22;
+// Garbage worth a compaction, and how long undrawn strokes stay compiled.
+constexpr std::size_t kMinGarbage = 4096;
+constexpr std::uint64_t kKeepFrames = 240;
+
+bool outOfRange(const Vec2& p, const Vec2& anchor) {
+    return std::abs(p.x - anchor.x) > DisplayList::kAnchorRange ||
+           std::abs(p.y - anchor.y) > DisplayList::kAnchorRange;
+}
+}
+
+void replayBatch(RenderBackend& backend, const StrokeBatch& b) {
+    const std::uint32_t argb = 0xFF000000u | b.colorRGB;
+    if (!b.fillEnds.empty()) {
+        backend.fills(argb, b.fillPoints.data(), b.fillEnds.data(), b.fillEnds.size());
+    }
+    if (!b.runEnds.empty()) {
+        backend.polylines(argb, b.widthPx, b.points.data(), b.runEnds.data(), b.runEnds.size());
+    }
+}
+
+void DisplayList::clear() {
+    commands_.clear();
+    points_.clear();
+    text_.clear();
+}
+
+MemoryUsage DisplayList::memoryUsage() const {
+    MemoryUsage u;
+    u.addVector(commands_);
+    u.addVector(points_);
+    u.addString(text_);
+    return u;
+}
+
+bool DisplayList::polyline(std::uint32_t argb, double width, const Vec2* pts, std::size_t count) {
+    if (count < 2) return true;
+    const std::size_t commandsBefore = commands_.size();
+    const std::size_t pointsBefore = points_.size();
+    std::size_t start = 0;
+    while (start + 1 < count) {
+        const Vec2 anchor = pts[start];
+        if (outOfRange(pts[start + 1], anchor)) {
+            commands_.resize(commandsBefore);
+            points_.resize(pointsBefore);
+            return false;
+        }
+        std::size_t end = start + 1;
+        while (end + 1 < count && !outOfRange(pts[end + 1], anchor)) ++end;
+
+        Command c;
+        c.op = Op::Polyline;
+        c.argb = argb;
+        c.size = static_cast<float>(width);
+        c.anchor = anchor;
+        c.first = static_cast<std::uint32_t>(points_.size());
+        c.count = static_cast<std::uint32_t>(end - start + 1);
+        for (std::size_t i = start; i <= end; ++i) {
+            points_.push_back({static_cast<float>(pts[i].x - anchor.x), static_cast<float>(pts[i].y - anchor.y)});
+        }
+        commands_.push_back(c);
+        start = end;
+    }
+    return true;
+}
+
+void DisplayList::fill(std::uint32_t argb, const Vec2* pts, std::size_t count) {
+    if (count < 3) return;
+    Command c;
+    c.op = Op::Fill;
+    c.argb = argb;
+    c.anchor = pts[0];
+    c.first = static_cast<std::uint32_t>(points_.size());
+    c.count = static_cast<std::uint32_t>(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        points_.push_back({static_cast<float>(pts[i].x - c.anchor.x), static_cast<float>(pts[i].y - c.anchor.y)});
+    }
+    commands_.push_back(c);
+}
+
+void DisplayList::text(std::uint32_t argb, double size, const Vec2& baseline, std::string_view utf8) {
+    Command c;
+    c.op = Op::Text;
+    c.argb = argb;
+    c.size = static_cast<float>(size);
+    c.anchor = baseline;
+    c.first = static_cast<std::uint32_t>(text_.size());
+    c.count = static_cast<std::uint32_t>(utf8.size());
+    text_.append(utf8);
+    commands_.push_back(c);
+}
+
+void DisplayList::append(const DisplayList& other, std::size_t first, std::size_t count) {
+    for (std::size_t i = first; i < first + count; ++i) {
+        Command c = other.commands_[i];
+        if (c.op == Op::Text) {
+            const std::string_view t = other.textOf(c);
+            c.first = static_cast<std::uint32_t>(text_.size());
+            text_.append(t);
+        } else {
+            const auto from = other.points_.begin() + c.first;
+            c.first = static_cast<std::uint32_t>(points_.size());
+            points_.insert(points_.end(), from, from + c.count);
+        }
+        commands_.push_back(c);
+    }
+}
+
+void DisplayList::points(const Command& c, double scale, const Vec2& offset, std::vector<Vec2>& out) const {
+    out.clear();
+    const Vec2 base{c.anchor.x * scale + offset.x, c.anchor.y * scale + offset.y};
+    for (std::uint32_t i = c.first; i < c.first + c.count; ++i) {
+        out.push_back({base.x + points_[i].x * scale, base.y + points_[i].y * scale});
+    }
+}
+
+std::string_view DisplayList::textOf(const Command& c) const {
+    return std::string_view(text_).substr(c.first, c.count);
+}
+
+void DisplayList::replay(RenderBackend& backend, double scale, const Vec2& offset) const {
+    std::vector<Vec2> pts;
+    for (const Command& c : commands_) {
+        switch (c.op) {
+        case Op::Polyline: {
+            points(c, scale, offset, pts);
+            const std::uint32_t end = c.count;
+            backend.polylines(c.argb, c.size * scale, pts.data(), &end, 1);
+            break;
+        }
+        case Op::Fill: {
+            points(c, scale, offset, pts);
+            const std::uint32_t end = c.count;
+            backend.fills(c.argb, pts.data(), &end, 1);
+            break;
+        }
+        case Op::Text:
+            backend.text(c.argb, c.size * scale,
+                         {c.anchor.x * scale + offset.x, c.anchor.y * scale + offset.y}, textOf(c));
+            break;
+        }
+    }
+}
+
+void Renderer::beginFrame(const Camera& cam, const Rect& viewport) {
+    ++frame_;
+    cam_ = cam;
+    viewport_ = viewport;
+
+    const int bucket = static_cast<int>(std::floor(cam.zoomExp() * kBucketsPerOctave));
+    const Vec2 center = cam.worldFromScreen(viewport.minX + viewport.width() * 0.5,
+                                            viewport.minY + viewport.height() * 0.5);
+    const double distancePx = std::max(std::abs(center.x - origin_.x), std::abs(center.y - origin_.y)) * listScale_;
+    if (bucket != bucket_ || !(distancePx <= kMaxOriginDistancePx)) {
+        reset(bucket, center);
+    } else if (garbage_ >= kMinGarbage && garbage_ * 2 > list_.commandCount()) {
+        compact();
+    } else if (frame_ - lastCompact_ >= kKeepFrames && !list_.empty()) {
+        compact();
+    }
+}
+
+void Renderer::reset(int bucket, const Vec2& origin) {
+    ++generation_;
+    list_.clear();
+    garbage_ = 0;
+    lastCompact_ = frame_;
+    bucket_ = bucket;
+    origin_ = origin;
+    bucketExp_ = bucket / kBucketsPerOctave;
+    listScale_ = std::exp2(bucketExp_);
+    // Replay stretches by up to one bucket; keep the LOD error in budget at its top.
+    lodTolerance_ = StrokeBatcher::kLodTolerancePx / std::exp2(bucketExp_ + 1.0 / kBucketsPerOctave);
+}
+
+void Renderer::compile(const Stroke& s, Entry& e) {
+    if (e.generation == generation_) garbage_ += e.count;
+    e.revision = s.revision();
+    e.generation = generation_;
+    e.first = static_cast<std::uint32_t>(list_.commandCount());
+    e.count = 0;
+    e.direct = false;
+
+    const double widthPx = s.widthScreen(bucketExp_);
+    const double maxStretch = std::exp2(1.0 / kBucketsPerOctave);
+    if (s.empty() || widthPx * maxStretch < StrokeBatcher::kMinWidthPx) return;
+
+    const std::vector<Vec2>* lod = s.lodFor(lodTolerance_);
+    const std::vector<Vec2>& pts = lod ? *lod : s.pointsWorld(decoded_);
+    mapped_.clear();
+    for (const Vec2& w : pts) {
+        mapped_.push_back({(w.x - origin_.x) * listScale_, (w.y - origin_.y) * listScale_});
+    }
+    if (!list_.polyline(0xFF000000u | s.colorRGB(), widthPx, mapped_.data(), mapped_.size())) {
+        e.direct = true;
+        return;
+    }
+    e.count = static_cast<std::uint32_t>(list_.commandCount() - e.first);
+}
+
+void Renderer::compact() {
+    DisplayList kept;
+    for (Entry& e : entries_) {
+        if (e.generation != generation_) continue;
+        if (frame_ - e.lastFrame > kKeepFrames) {
+            e.generation = 0;
+            continue;
+        }
+        const std::size_t first = kept.commandCount();
+        kept.append(list_, e.first, e.count);
+        e.first = static_cast<std::uint32_t>(first);
+    }
+    list_ = std::move(kept);
+    garbage_ = 0;
+    lastCompact_ = frame_;
+}
+
+void Renderer::memoryUsage(MemoryReport& report) const {
+    report.add("render.display_list", list_.memoryUsage());
+    MemoryUsage cache;
+    cache.addVector(entries_);
+    report.add("render.stroke_cache", cache);
+    MemoryUsage batches = batcher_.memoryUsage();
+    batches.addVector(decoded_);
+    batches.addVector(mapped_);
+    report.add("render.batches", batches);
+}
+
+void Renderer::draw(const StrokeList& strokes, const std::size_t* first, const std::size_t* last,
+                    RenderBackend& backend) {
+    if (entries_.size() < strokes.size()) entries_.resize(strokes.size());
+    batcher_.begin(cam_, viewport_);
+    const double k = cam_.scale() / listScale_;
+    const Vec2 offset = cam_.screenFromWorld(origin_.x, origin_.y);
+
+    std::uint64_t misses = 0;
+    const std::uint64_t total = static_cast<std::uint64_t>(last - first);
+    for (; first != last; ++first) {
+        const Stroke& s = strokes[*first];
+        Entry& e = entries_[*first];
+        if (e.generation != generation_ || e.revision != s.revision()) {
+            compile(s, e);
+            ++misses;
+        }
+        e.lastFrame = frame_;
+        if (e.direct) {
+            batcher_.add(s);
+            continue;
+        }
+        for (std::uint32_t c = e.first; c < e.first + e.count; ++c) {
+            const DisplayList::Command& cmd = list_.command(c);
+            list_.points(cmd, k, offset, mapped_);
+            batcher_.addScreen(s.colorRGB(), cmd.size * k, mapped_.data(), mapped_.size());
+        }
+    }
+
+    for (std::size_t i = 0; i < batcher_.batchCount(); ++i) {
+        replayBatch(backend, batcher_.batch(i));
+    }
+    // Once per call, not per stroke.
+    Metrics::add(Metrics::Counter::DisplayListHits, total - misses);
+    Metrics::add(Metrics::Counter::DisplayListMisses, misses);
 }
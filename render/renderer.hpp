@@ -1,7 +1,144 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <string>
+#include <string_view>
+#include <vector>
+#include "camera.hpp"
+#include "memory_usage.hpp"
+#include "stroke_batcher.hpp"
+#include "types.hpp"
 
+class Stroke;
+class StrokeList;
+
+// Where replayed drawing ends up: a QPainter, a file writer, a rasterizer.
+// Everything arrives in screen pixels and in draw order; colours are ARGB.
+class RenderBackend {
+public:
+    virtual ~RenderBackend() = default;
+    // Round caps and joins. runEnds holds the exclusive end of each run in pts.
+    virtual void polylines(std::uint32_t argb, double widthPx, const Vec2* pts,
+                           const std::uint32_t* runEnds, std::size_t runs) = 0;
+    // Nonzero winding. ends holds the exclusive end of each polygon in pts.
+    virtual void fills(std::uint32_t argb, const Vec2* pts, const std::uint32_t* ends, std::size_t polygons) = 0;
+    // One line; baseline is the left end of the text's baseline.
+    virtual void text(std::uint32_t argb, double sizePx, const Vec2& baseline, std::string_view utf8) = 0;
+};
+
+// Fills first, then the pen runs, as the batch is meant to be drawn.
+void replayBatch(RenderBackend& backend, const StrokeBatch& b);
+
+// A compact command buffer of styled polylines, fills and text. Points are
+// stored as floats relative to a per-command anchor, in the list's own
+// units; replay maps them to the screen with a scale and an offset.
+class DisplayList {
+public:
+    enum class Op : std::uint8_t { Polyline, Fill, Text };
+    struct Command {
+        Op op = Op::Polyline;
+        std::uint32_t argb = 0;
+        float size = 0.0f;       // pen width or text size, in list units
+        Vec2 anchor;             // text: left end of the baseline
+        std::uint32_t first = 0; // into the points, or the text bytes
+        std::uint32_t count = 0;
+    };
+    // Points stay this close to their anchor, so a float keeps them to
+    // about 1/4096 of a unit.
+    static constexpr double kAnchorRange = 4096.0;
+
+    void clear();
+    bool empty() const { return commands_.empty(); }
+    std::size_t commandCount() const { return commands_.size(); }
+    const Command& command(std::size_t i) const { return commands_[i]; }
+    MemoryUsage memoryUsage() const;
+
+    // Long polylines become several commands that share their joints, which
+    // draws the same with round joins. A single segment longer than
+    // kAnchorRange cannot be held: nothing is recorded and false returned.
+    bool polyline(std::uint32_t argb, double width, const Vec2* pts, std::size_t count);
+    void fill(std::uint32_t argb, const Vec2* pts, std::size_t count);
+    void text(std::uint32_t argb, double size, const Vec2& baseline, std::string_view utf8);
+    // Copies commands [first, first + count) of other to the end.
+    void append(const DisplayList& other, std::size_t first, std::size_t count);
+
+    // The points of a Polyline or Fill command, mapped to p * scale + offset.
+    void points(const Command& c, double scale, const Vec2& offset, std::vector<Vec2>& out) const;
+    std::string_view textOf(const Command& c) const;
+
+    // Plain replay, without clipping or batching, for small screen-space lists.
+    void replay(RenderBackend& backend, double scale = 1.0, const Vec2& offset = {}) const;
+
+private:
+    struct PointF {
+        float x = 0.0f;
+        float y = 0.0f;
+    };
+
+    std::vector<Command> commands_;
+    std::vector<PointF> points_;
+    std::string text_;
+};
+
+// Retained stroke drawing. A stroke is compiled into display-list commands
+// the first time it is drawn in a zoom bucket (a quarter octave) and then
+// only replayed, until its revision or the bucket changes: LOD choice,
+// decoding of cold strokes and the world-to-list mapping are paid once.
+// Replay scales the commands to the exact zoom, clips them and batches
+// them by pen like an immediate frame.
+//
+// Strokes with a segment too long for float offsets at this zoom are drawn
+// immediately instead. Commands of strokes not drawn for a while are
+// dropped when the list is compacted.
 class Renderer {
 public:
-    static std::string formatText(const std::string& s);
+    static constexpr double kBucketsPerOctave = 4.0;
+
+    // Picks the zoom bucket; viewport is in screen pixels.
+    void beginFrame(const Camera& cam, const Rect& viewport);
+    // Clips the following draws of this frame to part of the viewport, for
+    // a frame painted in parts; the zoom bucket stays as it is.
+    void clipTo(const Rect& part) { viewport_ = part; }
+    // Draws strokes[*first .. *last) (scene indices, draw order).
+    void draw(const StrokeList& strokes, const std::size_t* first, const std::size_t* last,
+              RenderBackend& backend);
+
+    std::size_t retainedCommands() const { return list_.commandCount() - garbage_; }
+    // "render.display_list" for the commands, "render.stroke_cache" for the
+    // per-stroke entries and "render.batches" for replay buffers.
+    void memoryUsage(MemoryReport& report) const;
+
+private:
+    struct Entry {
+        std::uint64_t revision = 0;
+        std::uint64_t generation = 0;
+        std::uint64_t lastFrame = 0;
+        std::uint32_t first = 0;
+        std::uint32_t count = 0;
+        bool direct = false; // not compiled: drawn immediately
+    };
+
+    void reset(int bucket, const Vec2& origin);
+    void compile(const Stroke& s, Entry& e);
+    void compact();
+
+    DisplayList list_;
+    std::vector<Entry> entries_; // by stroke index
+    std::uint64_t generation_ = 1;
+    std::size_t garbage_ = 0;    // commands no entry refers to
+    std::uint64_t frame_ = 0;
+    std::uint64_t lastCompact_ = 0;
+
+    int bucket_ = std::numeric_limits<int>::min();
+    Vec2 origin_;                // world point at list coordinate zero
+    double bucketExp_ = 0.0;
+    double listScale_ = 1.0;     // list units per world unit
+    double lodTolerance_ = 0.0;  // world units, for the top of the bucket
+    Camera cam_;
+    Rect viewport_;
+
+    StrokeBatcher batcher_;
+    std::vector<Vec2> decoded_;
+    std::vector<Vec2> mapped_;
 };
@@ -0,0 +1,138 @@
+#include "stroke_batcher.hpp"
+#include "camera.hpp"
+#include "elements/stroke.hpp"
+#include "polyline_clip.hpp"
+#include "stroke_list.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr double kBucketsPerOctave = 8.0;
+constexpr std::size_t kMaxLookback = 64;
+
+std::uint64_t styleKey(std::uint32_t colorRGB, double widthPx) {
+    const auto bucket = static_cast<std::int64_t>(std::lround(std::log2(widthPx) * kBucketsPerOctave));
+    return (static_cast<std::uint64_t>(colorRGB) << 32) | static_cast<std::uint32_t>(bucket);
+}
+}
+
+double StrokeBatcher::quantizeWidth(double px) {
+    return std::exp2(std::round(std::log2(px) * kBucketsPerOctave) / kBucketsPerOctave);
+}
+
+void StrokeBatcher::build(const StrokeList& strokes, const std::vector<std::size_t>& visible,
+                          const Camera& cam, const Rect& viewport) {
+    begin(cam, viewport);
+    for (std::size_t index : visible) {
+        add(strokes[index]);
+    }
+}
+
+void StrokeBatcher::begin(const Camera& cam, const Rect& viewport) {
+    for (std::size_t i = 0; i < used_; ++i) {
+        StrokeBatch& b = batches_[i];
+        b.points.clear();
+        b.runEnds.clear();
+        b.fillPoints.clear();
+        b.fillEnds.clear();
+        b.bounds = Rect{};
+    }
+    used_ = 0;
+    lastByStyle_.clear();
+    cam_ = &cam;
+    viewport_ = viewport;
+    lodTolerance_ = kLodTolerancePx / cam.scale();
+}
+
+void StrokeBatcher::add(const Stroke& s) {
+    const std::vector<Vec2>* lod = s.lodFor(lodTolerance_);
+    add(s, lod ? *lod : s.pointsWorld(decoded_));
+}
+
+void StrokeBatcher::add(const Stroke& s, const std::vector<Vec2>& pts) {
+    const Camera& cam = *cam_;
+    if (pts.size() < 2) return;
+
+    const double penPx = s.widthScreen(cam.zoomExp());
+    if (penPx < kMinWidthPx) return;
+
+    scratch_.clear();
+    for (const Vec2& w : pts) {
+        scratch_.push_back(cam.screenFromWorld(w.x, w.y));
+    }
+    addScreen(s.colorRGB(), penPx, scratch_.data(), scratch_.size());
+}
+
+void StrokeBatcher::addScreen(std::uint32_t colorRGB, double penPx, const Vec2* pts, std::size_t count) {
+    if (count < 2 || penPx < kMinWidthPx) return;
+    penPx = quantizeWidth(std::min(penPx, kMaxWidthPx));
+    const double radius = penPx * 0.5;
+
+    clipped_.clear();
+    clippedEnds_.clear();
+    if (clipPolyline(pts, count, viewport_.inflated(radius + 1.0), clipped_, clippedEnds_) == 0) {
+        return;
+    }
+
+    Rect box;
+    for (const Vec2& sp : clipped_) box.expand(sp);
+    box = box.inflated(radius);
+    StrokeBatch& b = batchFor(colorRGB, penPx, box);
+    b.bounds.expand(box);
+
+    if (penPx < kFillWidthPx) {
+        std::uint32_t start = 0;
+        for (std::uint32_t end : clippedEnds_) {
+            b.points.insert(b.points.end(), clipped_.begin() + start, clipped_.begin() + end);
+            b.runEnds.push_back(static_cast<std::uint32_t>(b.points.size()));
+            start = end;
+        }
+        return;
+    }
+
+    const Rect fillClip = viewport_.inflated(1.0);
+    std::uint32_t start = 0;
+    for (std::uint32_t end : clippedEnds_) {
+        for (std::uint32_t k = start; k + 1 < end; ++k) {
+            appendClippedCapsule(clipped_[k], clipped_[k + 1], radius, fillClip, b.fillPoints, b.fillEnds);
+        }
+        start = end;
+    }
+}
+
+StrokeBatch& StrokeBatcher::batchFor(std::uint32_t colorRGB, double widthPx, const Rect& bounds) {
+    const std::uint64_t key = styleKey(colorRGB, widthPx);
+    auto found = lastByStyle_.find(key);
+    if (found != lastByStyle_.end() && used_ - found->second <= kMaxLookback) {
+        bool blocked = false;
+        for (std::size_t i = found->second + 1; i < used_ && !blocked; ++i) {
+            blocked = batches_[i].bounds.intersects(bounds);
+        }
+        if (!blocked) return batches_[found->second];
+    }
+
+    if (used_ == batches_.size()) batches_.emplace_back();
+    StrokeBatch& b = batches_[used_];
+    b.colorRGB = colorRGB;
+    b.widthPx = widthPx;
+    lastByStyle_[key] = used_;
+    ++used_;
+    return b;
+}
+
+MemoryUsage StrokeBatcher::memoryUsage() const {
+    MemoryUsage u;
+    u.addVector(batches_);
+    for (const StrokeBatch& b : batches_) {
+        u.addVector(b.points);
+        u.addVector(b.runEnds);
+        u.addVector(b.fillPoints);
+        u.addVector(b.fillEnds);
+    }
+    u.addMap(lastByStyle_);
+    u.addVector(scratch_);
+    u.addVector(decoded_);
+    u.addVector(clipped_);
+    u.addVector(clippedEnds_);
+    return u;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "memory_usage.hpp"
+#include "types.hpp"
+
+class Camera;
+class Stroke;
+class StrokeList;
+
+// Screen-space polylines that share one pen: same colour, same width bucket.
+struct StrokeBatch {
+    std::uint32_t colorRGB = 0;
+    double widthPx = 0.0;
+    std::vector<Vec2> points;            // all runs back to back
+    std::vector<std::uint32_t> runEnds;  // exclusive end of each run in points
+    std::vector<Vec2> fillPoints;        // clipped capsules of giant-width strokes
+    std::vector<std::uint32_t> fillEnds; // exclusive end of each polygon
+    Rect bounds;                         // screen bounds including the pen radius
+};
+
+// Groups visible strokes by (colour, quantized screen width) so each group
+// can be drawn with a single pen and a single path. A stroke joins an older
+// batch of its style only if no batch in between overlaps it, which keeps
+// the result identical to drawing in stroke order.
+//
+// Polylines are clipped to the viewport grown by the pen radius, so only
+// visible runs are stroked. Pens at least kFillWidthPx wide are not stroked
+// at all: each visible segment becomes a capsule clipped to the viewport
+// and is filled instead.
+class StrokeBatcher {
+public:
+    static constexpr double kMinWidthPx = 0.05;
+    static constexpr double kMaxWidthPx = 4096.0;
+    static constexpr double kFillWidthPx = 512.0;
+    // Strokes draw from their coarsest LOD level within this screen error.
+    static constexpr double kLodTolerancePx = 0.35;
+
+    // visible holds stroke indices in draw order; viewport is in screen pixels.
+    void build(const StrokeList& strokes, const std::vector<std::size_t>& visible,
+               const Camera& cam, const Rect& viewport);
+
+    // Incremental form of build(): begin() resets, add() takes strokes in draw order.
+    void begin(const Camera& cam, const Rect& viewport);
+    // Never thaws s: cold strokes without a usable LOD level are decoded
+    // into scratch, so strokes shared with other threads are safe to add.
+    void add(const Stroke& s);
+    // World tolerance that add() passes to Stroke::lodFor() for this camera.
+    double lodTolerance() const { return lodTolerance_; }
+    // Same, with the stroke's world points supplied by the caller.
+    void add(const Stroke& s, const std::vector<Vec2>& pts);
+    // Points already on screen; penPx is the unquantized screen width.
+    void addScreen(std::uint32_t colorRGB, double penPx, const Vec2* pts, std::size_t count);
+
+    std::size_t batchCount() const { return used_; }
+    const StrokeBatch& batch(std::size_t i) const { return batches_[i]; }
+    // Batches are kept for reuse, so this includes the idle ones.
+    MemoryUsage memoryUsage() const;
+
+    // Widths within ~4% of each other land in the same bucket.
+    static double quantizeWidth(double px);
+
+private:
+    StrokeBatch& batchFor(std::uint32_t colorRGB, double widthPx, const Rect& bounds);
+
+    std::vector<StrokeBatch> batches_; // reused across frames
+    std::size_t used_ = 0;
+    const Camera* cam_ = nullptr;
+    Rect viewport_;
+    double lodTolerance_ = 0.0;
+    std::unordered_map<std::uint64_t, std::size_t> lastByStyle_;
+    std::vector<Vec2> scratch_;
+    std::vector<Vec2> decoded_;
+    std::vector<Vec2> clipped_;
+    std::vector<std::uint32_t> clippedEnds_;
+};
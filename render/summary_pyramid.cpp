@@ -0,0 +1,111 @@
+#include "summary_pyramid.hpp"
+#include "elements/stroke.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Faint ink must still show up on an overview.
+constexpr double kMinAlpha = 0.35;
+}
+
+void SummaryPyramid::clear() {
+    levels_.clear();
+    finest_ = 0;
+    bounds_ = Rect{};
+    strokes_ = 0;
+    ++revision_;
+}
+
+MemoryUsage SummaryPyramid::memoryUsage() const {
+    MemoryUsage u;
+    u.addVector(levels_);
+    for (const Level& level : levels_) u.addMap(level);
+    u.addVector(deposit_);
+    u.addVector(scratch_);
+    return u;
+}
+
+void SummaryPyramid::fit(const Rect& bounds) {
+    // Between kFinestCells and twice that across the extent.
+    const int want = fitInkLevel(bounds, 2.0 * kFinestCells);
+    if (levels_.empty()) {
+        finest_ = want;
+        levels_.resize(kLevelCount);
+        return;
+    }
+    // The ink spread: the finest level goes and a coarser one is merged
+    // from the current top.
+    for (; finest_ < want; ++finest_) {
+        Level up;
+        for (const auto& [key, c] : levels_.back()) up[parentKey(key)].add(c, 0.25f);
+        levels_.erase(levels_.begin());
+        levels_.push_back(std::move(up));
+    }
+}
+
+void SummaryPyramid::add(const Stroke& s, const Vec2& origin) {
+    if (s.empty()) return;
+    bounds_.expand(s.inkBounds().translated(origin));
+    fit(bounds_);
+
+    const std::vector<Vec2>& pts = s.pointsWorld(scratch_);
+    const double width = std::exp2(s.widthExp());
+    deposit_.clear();
+    for (std::size_t i = 1; i < pts.size(); ++i) {
+        depositSegment(deposit_, pts[i - 1] + origin, pts[i] + origin, width, s.colorRGB(), finest_);
+    }
+    mergeDeposit(deposit_);
+    for (std::size_t l = 0; l < levels_.size(); ++l) {
+        if (l > 0) {
+            depositToParents(deposit_);
+            mergeDeposit(deposit_);
+        }
+        Level& level = levels_[l];
+        for (const auto& [key, c] : deposit_) level[key].add(c);
+    }
+    ++strokes_;
+    ++revision_;
+}
+
+int SummaryPyramid::levelFor(double cellWorld) const {
+    if (levels_.empty() || !(cellWorld > 0.0)) return finest_;
+    const double l = std::ceil(std::log2(cellWorld));
+    return static_cast<int>(std::clamp(l, static_cast<double>(finest_), static_cast<double>(coarsestLevel())));
+}
+
+void SummaryPyramid::render(int level, const Rect& area, int width, int height, std::vector<std::uint32_t>& out) const {
+    out.assign(static_cast<std::size_t>(std::max(width, 0)) * std::max(height, 0), 0u);
+    if (levels_.empty() || area.empty() || width <= 0 || height <= 0) return;
+    level = std::clamp(level, finest_, coarsestLevel());
+
+    std::vector<InkCell> px(out.size());
+    const double cell = std::exp2(level);
+    const double sx = width / area.width();
+    const double sy = height / area.height();
+    for (const auto& [key, c] : levels_[level - finest_]) {
+        const double x0 = (keyX(key) * cell - area.minX) * sx;
+        const double y0 = (keyY(key) * cell - area.minY) * sy;
+        const double x1 = x0 + cell * sx;
+        const double y1 = y0 + cell * sy;
+        if (x1 <= 0.0 || y1 <= 0.0 || x0 >= width || y0 >= height) continue;
+        // Every cell reaches at least the pixel it starts in.
+        const int ix0 = std::max(0, static_cast<int>(std::floor(x0)));
+        const int iy0 = std::max(0, static_cast<int>(std::floor(y0)));
+        const int ix1 = std::min(width, std::max(ix0 + 1, static_cast<int>(std::ceil(x1))));
+        const int iy1 = std::min(height, std::max(iy0 + 1, static_cast<int>(std::ceil(y1))));
+        for (int y = iy0; y < iy1; ++y) {
+            for (int x = ix0; x < ix1; ++x) px[static_cast<std::size_t>(y) * width + x].add(c);
+        }
+    }
+
+    for (std::size_t i = 0; i < px.size(); ++i) {
+        const InkCell& p = px[i];
+        if (!(p.ink > 0.0f)) continue;
+        const double a = kMinAlpha + (1.0 - kMinAlpha) * std::sqrt(std::min(1.0, static_cast<double>(p.ink)));
+        const auto channel = [&](float sum) {
+            return static_cast<std::uint32_t>(std::clamp(std::lround(sum / p.ink * a), 0l, 255l));
+        };
+        out[i] = (static_cast<std::uint32_t>(std::lround(a * 255.0)) << 24) |
+                 (channel(p.r) << 16) | (channel(p.g) << 8) | channel(p.b);
+    }
+}
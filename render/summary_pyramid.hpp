@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "ink_cells.hpp"
+#include "memory_usage.hpp"
+#include "types.hpp"
+
+class Stroke;
+
+// Coarse ink density of the whole board, for overviews such as the minimap.
+// Level L has square cells 2^L board units wide (board = scene-local plus
+// the scene origin, so recenters leave it valid). Only kLevelCount levels
+// are kept, the finest with about kFinestCells cells across the ink's
+// extent: as the ink spreads, the finest levels are dropped and coarser
+// ones merged from the top. Adding a stroke costs its length in finest
+// cells; reading a level never touches strokes.
+class SummaryPyramid {
+public:
+    static constexpr double kFinestCells = 512.0;
+    static constexpr int kLevelCount = 12;
+
+    void clear();
+    bool empty() const { return strokes_ == 0; }
+    std::size_t strokeCount() const { return strokes_; }
+    // Board rectangle of all ink added so far.
+    Rect bounds() const { return bounds_; }
+    // Bumped by every change to the cells.
+    std::uint64_t revision() const { return revision_; }
+    MemoryUsage memoryUsage() const;
+
+    // origin is the scene origin that the stroke's points are relative to.
+    void add(const Stroke& s, const Vec2& origin);
+
+    int finestLevel() const { return finest_; }
+    int coarsestLevel() const { return finest_ + static_cast<int>(levels_.size()) - 1; }
+    // The finest kept level whose cells are at least cellWorld wide.
+    int levelFor(double cellWorld) const;
+    // Premultiplied ARGB32 rows of width pixels showing area (board units)
+    // from one level. Costs at most the level's cell count, which the
+    // extent bounds, whatever the number of strokes.
+    void render(int level, const Rect& area, int width, int height, std::vector<std::uint32_t>& out) const;
+
+private:
+    using Level = std::unordered_map<std::uint64_t, InkCell>;
+
+    void fit(const Rect& bounds);
+
+    std::vector<Level> levels_; // finest first
+    int finest_ = 0;
+    Rect bounds_;
+    std::size_t strokes_ = 0;
+    std::uint64_t revision_ = 0;
+
+    InkDeposit deposit_;
+    std::vector<Vec2> scratch_;
+};
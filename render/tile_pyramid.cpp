@@ -0,0 +1,31 @@
+#include "tile_pyramid.hpp"
+#include <algorithm>
+#include <cmath>
+
+TilePyramid::TilePyramid(int width, int height, int tileSize)
+    : width(width), height(height), tileSize(tileSize) {
+    levels = 1;
+    while (levelWidth(levels - 1) > tileSize || levelHeight(levels - 1) > tileSize) ++levels;
+}
+
+int TilePyramid::levelWidth(int level) const {
+    return std::max(1, (width + (1 << level) - 1) >> level);
+}
+
+int TilePyramid::levelHeight(int level) const {
+    return std::max(1, (height + (1 << level) - 1) >> level);
+}
+
+int TilePyramid::tilesX(int level) const {
+    return (levelWidth(level) + tileSize - 1) / tileSize;
+}
+
+int TilePyramid::tilesY(int level) const {
+    return (levelHeight(level) + tileSize - 1) / tileSize;
+}
+
+int TilePyramid::levelFor(double sourcePerScreenPx) const {
+    if (!(sourcePerScreenPx > 1.0)) return 0;
+    const int level = static_cast<int>(std::floor(std::log2(sourcePerScreenPx)));
+    return std::clamp(level, 0, levels - 1);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+
+// Geometry of a tiled mip pyramid: level 0 is the full image, each level
+// halves both sides (rounding up) down to a single tile.
+struct TilePyramid {
+    static constexpr int kDefaultTileSize = 256;
+
+    int width = 0;
+    int height = 0;
+    int tileSize = kDefaultTileSize;
+    int levels = 0;
+
+    TilePyramid() = default;
+    TilePyramid(int width, int height, int tileSize = kDefaultTileSize);
+
+    int levelWidth(int level) const;
+    int levelHeight(int level) const;
+    int tilesX(int level) const;
+    int tilesY(int level) const;
+
+    // Coarsest level that still has at least one source pixel per output
+    // pixel; sourcePerScreenPx is level-0 pixels per device pixel.
+    int levelFor(double sourcePerScreenPx) const;
+};
@@ -0,0 +1,149 @@
+// Headless replay of a session recorded with `cancans --record`. Recorded
+// input is fed to a real CanvasView as synthesized Qt events, so it takes the
+// same code paths as live input; every recorded paint becomes an offscreen
+// render whose duration is reported per frame.
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QTextStream>
+#include <QWheelEvent>
+#include <algorithm>
+#include <vector>
+
+#include "canvas_view.hpp"
+#include "frame_painter.hpp"
+#include "input_log.hpp"
+#include "scene.hpp"
+
+namespace {
+
+void dispatch(CanvasView& view, const InputRecord& r) {
+    using T = InputRecord::Type;
+    const QPointF pos(r.pos.x, r.pos.y);
+    const auto buttons = Qt::MouseButtons::fromInt(static_cast<int>(r.buttons));
+    const auto modifiers = Qt::KeyboardModifiers::fromInt(static_cast<int>(r.modifiers));
+    switch (r.type) {
+    case T::MousePress:
+    case T::MouseRelease:
+    case T::MouseMove: {
+        const QEvent::Type type = r.type == T::MousePress ? QEvent::MouseButtonPress
+                                : r.type == T::MouseRelease ? QEvent::MouseButtonRelease
+                                : QEvent::MouseMove;
+        QMouseEvent e(type, pos, view.mapToGlobal(pos), static_cast<Qt::MouseButton>(r.button), buttons, modifiers);
+        QCoreApplication::sendEvent(&view, &e);
+        break;
+    }
+    case T::Wheel: {
+        QWheelEvent e(pos, view.mapToGlobal(pos), QPoint(), QPoint(0, r.wheelDelta), buttons, modifiers,
+                      Qt::NoScrollPhase, false);
+        QCoreApplication::sendEvent(&view, &e);
+        break;
+    }
+    case T::KeyPress:
+    case T::KeyRelease: {
+        QKeyEvent e(r.type == T::KeyPress ? QEvent::KeyPress : QEvent::KeyRelease, static_cast<int>(r.key), modifiers);
+        QCoreApplication::sendEvent(&view, &e);
+        break;
+    }
+    case T::Resize:
+        view.resize(r.width, r.height);
+        break;
+    case T::ViewState: {
+        Camera cam;
+        cam.setState(r.zoomExp, r.offsetPx, r.worldCenter);
+        view.setCamera(cam);
+        view.setMode(static_cast<ui::Mode>(r.mode));
+        view.setBrushWidth(r.brushPx);
+        view.setBrushColor(colorFromRgb(r.brushColorRGB));
+        view.setBrushKind(static_cast<BrushKind>(r.brushKind));
+        break;
+    }
+    case T::Paint:
+        break;
+    }
+}
+
+double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    const auto i = static_cast<std::size_t>(q * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(i, sorted.size() - 1)];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Replays a recorded canvas session and times every frame."));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("log"), QStringLiteral("Input log written by cancans --record."));
+    const QCommandLineOption memoryReportOption(QStringLiteral("memory-report"),
+        QStringLiteral("Write a JSON memory report of the replayed board to <file>."), QStringLiteral("file"));
+    parser.addOption(memoryReportOption);
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.isEmpty()) parser.showHelp(1);
+
+    Scene scene;
+    InputLogHeader header;
+    std::vector<InputRecord> records;
+    if (!readInputLogFile(args.first().toStdString(), header, scene, records)) {
+        QTextStream(stderr) << "cancans_replay: cannot read " << args.first() << '\n';
+        return 1;
+    }
+
+    CanvasView view(&scene);
+    view.resize(header.width, header.height);
+    Camera cam;
+    cam.setState(header.zoomExp, header.offsetPx, header.worldCenter);
+    view.setCamera(cam);
+    view.setMode(static_cast<ui::Mode>(header.mode));
+    view.setBrushWidth(header.brushPx);
+    view.setBrushColor(colorFromRgb(header.brushColorRGB));
+    view.setBrushKind(static_cast<BrushKind>(header.brushKind));
+
+    QTextStream out(stdout);
+    out << "frame,time_ms,render_ms,strokes\n";
+    std::vector<double> frameMs;
+    QImage image;
+    QElapsedTimer timer;
+    for (const InputRecord& r : records) {
+        if (r.type != InputRecord::Type::Paint) {
+            dispatch(view, r);
+            continue;
+        }
+        if (image.size() != view.size()) image = QImage(view.size(), QImage::Format_ARGB32_Premultiplied);
+        // There is no idle loop here: LOD the input path deferred is built
+        // between frames and outside the timing, as idle time would.
+        scene.buildPendingLod(scene.lodPendingCount());
+        timer.start();
+        view.render(&image);
+        const double ms = static_cast<double>(timer.nsecsElapsed()) / 1e6;
+        out << frameMs.size() << ',' << static_cast<double>(r.timeNs) / 1e6 << ',' << ms << ','
+            << scene.strokes().size() << '\n';
+        frameMs.push_back(ms);
+    }
+    out.flush();
+
+    std::sort(frameMs.begin(), frameMs.end());
+    QTextStream(stderr) << "cancans_replay: " << frameMs.size() << " frames, p50 " << percentile(frameMs, 0.5)
+                        << " ms, p95 " << percentile(frameMs, 0.95) << " ms, max "
+                        << (frameMs.empty() ? 0.0 : frameMs.back()) << " ms\n";
+
+    if (parser.isSet(memoryReportOption)) {
+        const std::string json = view.memoryReport().toJson();
+        QFile file(parser.value(memoryReportOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+            file.write(json.data(), static_cast<qint64>(json.size())) != static_cast<qint64>(json.size())) {
+            QTextStream(stderr) << "cancans_replay: cannot write " << parser.value(memoryReportOption) << '\n';
+            return 1;
+        }
+    }
+    return 0;
+}
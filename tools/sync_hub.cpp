@@ -0,0 +1,93 @@
+// Stand-in sync hub: relays stroke-op frames between canvas processes on one
+// machine. Every frame is forwarded to all other clients and appended to the
+// session log, which late joiners receive first.
+#include <QByteArray>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QHash>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTextStream>
+#include <memory>
+#include <vector>
+
+#include "sync_ops.hpp"
+
+namespace {
+
+class Hub : public QObject {
+public:
+    explicit Hub(QObject* parent = nullptr) : QObject(parent) {
+        connect(&server_, &QLocalServer::newConnection, this, &Hub::acceptClients);
+    }
+
+    bool listen(const QString& name) {
+        QLocalServer::removeServer(name);
+        return server_.listen(name);
+    }
+
+    QString errorString() const { return server_.errorString(); }
+
+private:
+    void acceptClients() {
+        while (QLocalSocket* client = server_.nextPendingConnection()) {
+            readers_.insert(client, std::make_shared<SyncFrameReader>());
+            if (!log_.isEmpty()) client->write(log_);
+            connect(client, &QLocalSocket::readyRead, this, [this, client]() { relay(client); });
+            connect(client, &QLocalSocket::disconnected, this, [this, client]() {
+                readers_.remove(client);
+                client->deleteLater();
+            });
+        }
+    }
+
+    void relay(QLocalSocket* from) {
+        auto reader = readers_.value(from);
+        if (!reader) return;
+        const QByteArray bytes = from->readAll();
+        reader->feed(reinterpret_cast<const std::uint8_t*>(bytes.constData()), static_cast<std::size_t>(bytes.size()));
+
+        std::vector<std::uint8_t> payload;
+        std::vector<std::uint8_t> framed;
+        while (reader->next(payload)) {
+            appendSyncFrame(framed, payload);
+        }
+        if (reader->failed()) {
+            from->abort();
+            return;
+        }
+        if (framed.empty()) return;
+
+        const QByteArray out(reinterpret_cast<const char*>(framed.data()), static_cast<qsizetype>(framed.size()));
+        log_.append(out);
+        for (auto it = readers_.cbegin(); it != readers_.cend(); ++it) {
+            if (it.key() != from) it.key()->write(out);
+        }
+    }
+
+    QLocalServer server_;
+    QHash<QLocalSocket*, std::shared_ptr<SyncFrameReader>> readers_;
+    QByteArray log_;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Local relay for canvas live sync."));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("name"), QStringLiteral("Local server name to listen on."));
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    const QString name = args.isEmpty() ? QStringLiteral("cancans-sync") : args.first();
+
+    Hub hub;
+    if (!hub.listen(name)) {
+        QTextStream(stderr) << "cancans_hub: cannot listen on " << name << ": " << hub.errorString() << '\n';
+        return 1;
+    }
+    QTextStream(stdout) << "cancans_hub: listening on " << name << '\n';
+    return app.exec();
+}
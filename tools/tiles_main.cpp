@@ -0,0 +1,389 @@
+// Headless Deep Zoom export of a saved board for the web viewer. Every tile
+// of every level is rendered by a FramePainter of its own worker thread,
+// from the strokes a spatial query finds for it, at the level's zoom (so
+// strokes use the LOD the live view would). A manifest next to the .dzi
+// remembers what was rendered; a later run over the same board with more
+// strokes redraws only the tiles the new strokes reach.
+#include <QBuffer>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QHash>
+#include <QImage>
+#include <QImageWriter>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+#include <QSaveFile>
+#include <QTextStream>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../core/scene.hpp"
+#include "../core/scene_io.hpp"
+#include "../render/deep_zoom.hpp"
+#include "frame_painter.hpp"
+
+namespace {
+constexpr int kManifestVersion = 1;
+constexpr std::size_t kLodStrokesPerPass = 4096;
+
+struct Manifest {
+    DeepZoomLayout layout;
+    QString format;
+    std::size_t strokes = 0;
+    std::uint64_t signature = 0;
+    std::uint64_t elements = 0;
+};
+
+bool readManifest(const QString& path, Manifest& m) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return false;
+    const QJsonObject o = QJsonDocument::fromJson(f.readAll()).object();
+    if (o.value(QStringLiteral("version")).toInt() != kManifestVersion) return false;
+    const Rect region(o.value(QStringLiteral("minX")).toDouble(), o.value(QStringLiteral("minY")).toDouble(),
+                      o.value(QStringLiteral("maxX")).toDouble(), o.value(QStringLiteral("maxY")).toDouble());
+    m.layout = DeepZoomLayout(region, o.value(QStringLiteral("zoomExp")).toDouble(),
+                              o.value(QStringLiteral("tileSize")).toInt());
+    m.format = o.value(QStringLiteral("format")).toString();
+    // 64-bit values as hex strings: JSON numbers are doubles.
+    bool ok = true;
+    m.strokes = static_cast<std::size_t>(o.value(QStringLiteral("strokes")).toString().toULongLong(&ok, 16));
+    m.signature = o.value(QStringLiteral("signature")).toString().toULongLong(&ok, 16);
+    m.elements = o.value(QStringLiteral("elements")).toString().toULongLong(&ok, 16);
+    return ok && m.layout.valid();
+}
+
+bool writeManifest(const QString& path, const Manifest& m) {
+    QJsonObject o;
+    o.insert(QStringLiteral("version"), kManifestVersion);
+    o.insert(QStringLiteral("minX"), m.layout.region.minX);
+    o.insert(QStringLiteral("minY"), m.layout.region.minY);
+    o.insert(QStringLiteral("maxX"), m.layout.region.maxX);
+    o.insert(QStringLiteral("maxY"), m.layout.region.maxY);
+    o.insert(QStringLiteral("zoomExp"), m.layout.zoomExp);
+    o.insert(QStringLiteral("tileSize"), m.layout.tileSize);
+    o.insert(QStringLiteral("format"), m.format);
+    o.insert(QStringLiteral("strokes"), QString::number(static_cast<qulonglong>(m.strokes), 16));
+    o.insert(QStringLiteral("signature"), QString::number(static_cast<qulonglong>(m.signature), 16));
+    o.insert(QStringLiteral("elements"), QString::number(static_cast<qulonglong>(m.elements), 16));
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) return false;
+    f.write(QJsonDocument(o).toJson());
+    return f.commit();
+}
+
+bool writeDzi(const QString& path, const DeepZoomLayout& layout, const QString& format) {
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) return false;
+    QTextStream(&f) << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                    << "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"" << format
+                    << "\" Overlap=\"0\" TileSize=\"" << layout.tileSize << "\">\n"
+                    << "  <Size Width=\"" << layout.width << "\" Height=\"" << layout.height << "\"/>\n"
+                    << "</Image>\n";
+    return f.commit();
+}
+
+Rect inkBounds(const SceneSnapshot& scene) {
+    Rect r;
+    for (const Stroke& s : scene.strokes) {
+        if (!s.empty()) r.expand(s.inkBounds());
+    }
+    for (std::size_t row = 0; row < scene.elements->size(); ++row) {
+        r.expand(scene.elements->bounds(static_cast<std::uint32_t>(row)));
+    }
+    return r;
+}
+
+// Element rows have no cheap per-element change test here; any change
+// redraws the board.
+std::uint64_t elementsSignature(const ElementStore& elements) {
+    std::uint64_t h = elements.size();
+    for (std::size_t row = 0; row < elements.size(); ++row) {
+        h = (h ^ elements.id(static_cast<std::uint32_t>(row))) * 0x100000001B3ull;
+    }
+    return (h ^ elements.revision()) * 0x100000001B3ull;
+}
+
+bool parseRegion(const QString& text, Rect& out) {
+    const QStringList parts = text.split(QLatin1Char(','));
+    if (parts.size() != 4) return false;
+    double v[4];
+    for (int i = 0; i < 4; ++i) {
+        bool ok = false;
+        v[i] = parts[i].trimmed().toDouble(&ok);
+        if (!ok) return false;
+    }
+    out = Rect(v[0], v[1], v[2], v[3]);
+    return !out.empty();
+}
+
+struct TileJob {
+    int level;
+    int col;
+    int row;
+};
+
+// Encodes and writes tiles; a board's blank tiles are all alike, so each
+// blank size is encoded once.
+class TileWriter {
+public:
+    TileWriter(QString dir, QString format, int quality)
+        : dir_(std::move(dir)), format_(std::move(format)), quality_(quality) {}
+
+    QString path(const TileJob& t) const {
+        return QStringLiteral("%1/%2/%3_%4.%5").arg(dir_).arg(t.level).arg(t.col).arg(t.row).arg(format_);
+    }
+
+    bool write(const TileJob& t, const QImage& image) const { return save(path(t), encode(image)); }
+
+    bool writeBlank(const TileJob& t, const QSize& size) {
+        QByteArray bytes;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto key = (static_cast<qint64>(size.width()) << 32) | size.height();
+            auto it = blank_.find(key);
+            if (it == blank_.end()) {
+                QImage image(size, QImage::Format_ARGB32_Premultiplied);
+                image.fill(FramePainter::backgroundColor());
+                it = blank_.insert(key, encode(image));
+            }
+            bytes = it.value();
+        }
+        return save(path(t), bytes);
+    }
+
+private:
+    QByteArray encode(const QImage& image) const {
+        QByteArray bytes;
+        QBuffer buffer(&bytes);
+        buffer.open(QIODevice::WriteOnly);
+        QImageWriter writer(&buffer, format_.toLatin1());
+        if (quality_ >= 0) writer.setQuality(quality_);
+        // Tiles carry no alpha: the board background is opaque.
+        if (!writer.write(image.convertToFormat(QImage::Format_RGB32))) return {};
+        return bytes;
+    }
+
+    static bool save(const QString& path, const QByteArray& bytes) {
+        if (bytes.isEmpty()) return false;
+        // Replaced atomically, so a viewer reading the folder never sees half a tile.
+        QSaveFile f(path);
+        if (!f.open(QIODevice::WriteOnly)) return false;
+        f.write(bytes);
+        return f.commit();
+    }
+
+    QString dir_;
+    QString format_;
+    int quality_;
+    std::mutex mutex_;
+    QHash<qint64, QByteArray> blank_;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Renders a saved board into a Deep Zoom tile pyramid."));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("scene"), QStringLiteral("Board file to render."));
+    parser.addPositionalArgument(QStringLiteral("output"), QStringLiteral("Directory for <name>.dzi and <name>_files."));
+    const QCommandLineOption nameOption(QStringLiteral("name"),
+        QStringLiteral("Base name of the pyramid (default: the board file's)."), QStringLiteral("name"));
+    const QCommandLineOption formatOption(QStringLiteral("format"),
+        QStringLiteral("Tile format, png or webp (default png)."), QStringLiteral("format"), QStringLiteral("png"));
+    const QCommandLineOption qualityOption(QStringLiteral("quality"),
+        QStringLiteral("Encoder quality 0-100, for webp."), QStringLiteral("quality"));
+    const QCommandLineOption tileSizeOption(QStringLiteral("tile-size"),
+        QStringLiteral("Tile side in pixels (default 256)."), QStringLiteral("px"));
+    const QCommandLineOption zoomOption(QStringLiteral("zoom"),
+        QStringLiteral("Deepest level's pixels per board unit, as a power of two (default 0)."), QStringLiteral("exp"));
+    const QCommandLineOption regionOption(QStringLiteral("region"),
+        QStringLiteral("Board area minX,minY,maxX,maxY (default: all ink)."), QStringLiteral("rect"));
+    const QCommandLineOption jobsOption(QStringLiteral("jobs"),
+        QStringLiteral("Worker threads (default: all cores)."), QStringLiteral("n"));
+    const QCommandLineOption fullOption(QStringLiteral("full"),
+        QStringLiteral("Render every tile even if an earlier run's tiles could be kept."));
+    parser.addOptions({nameOption, formatOption, qualityOption, tileSizeOption, zoomOption, regionOption, jobsOption,
+                       fullOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 2) parser.showHelp(1);
+    const QString format = parser.value(formatOption).toLower();
+    if (format != QStringLiteral("png") && format != QStringLiteral("webp")) {
+        err << "cancans_tiles: unknown format " << format << '\n';
+        return 1;
+    }
+    if (!QImageWriter::supportedImageFormats().contains(format.toLatin1())) {
+        err << "cancans_tiles: this Qt cannot write " << format << " (missing image format plugin)\n";
+        return 1;
+    }
+    const int quality = parser.isSet(qualityOption) ? parser.value(qualityOption).toInt() : -1;
+    const int tileSize = parser.isSet(tileSizeOption) ? parser.value(tileSizeOption).toInt()
+                                                      : DeepZoomLayout::kDefaultTileSize;
+    const double zoomExp = parser.isSet(zoomOption) ? parser.value(zoomOption).toDouble() : 0.0;
+    Rect region;
+    if (parser.isSet(regionOption) && !parseRegion(parser.value(regionOption), region)) {
+        err << "cancans_tiles: bad region " << parser.value(regionOption) << '\n';
+        return 1;
+    }
+    std::size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+    if (parser.isSet(jobsOption)) jobs = std::max(1, parser.value(jobsOption).toInt());
+
+    Scene scene;
+    if (!loadSceneFile(args[0].toStdString(), scene)) {
+        err << "cancans_tiles: cannot read " << args[0] << '\n';
+        return 1;
+    }
+    while (scene.buildPendingLod(kLodStrokesPerPass) > 0) {
+    }
+    scene.rebuildIndex();
+    scene.publish();
+    const std::shared_ptr<const SceneSnapshot> board = scene.snapshot();
+    const StrokeList& strokes = board->strokes;
+    const ElementStore& elements = *board->elements;
+
+    const QString name = parser.isSet(nameOption) ? parser.value(nameOption) : QFileInfo(args[0]).completeBaseName();
+    const QDir out(args[1]);
+    const QString filesDir = out.filePath(name + QStringLiteral("_files"));
+    const QString manifestPath = out.filePath(name + QStringLiteral(".manifest.json"));
+
+    Manifest now;
+    now.format = format;
+    now.strokes = strokes.size();
+    now.signature = strokesSignature(strokes, strokes.size());
+    now.elements = elementsSignature(elements);
+
+    // Incremental only if the earlier pyramid has the same geometry and
+    // every stroke it drew is still there unchanged.
+    Manifest before;
+    const bool hadManifest = readManifest(manifestPath, before);
+    const Rect ink = inkBounds(*board);
+    bool incremental = hadManifest && !parser.isSet(fullOption) && before.format == format &&
+                       before.layout.tileSize == tileSize && before.layout.zoomExp == zoomExp &&
+                       before.strokes <= strokes.size() && before.elements == now.elements &&
+                       before.signature == strokesSignature(strokes, before.strokes);
+    if (incremental && parser.isSet(regionOption)) {
+        const Rect& r = before.layout.region;
+        incremental = r.minX == region.minX && r.minY == region.minY && r.maxX == region.maxX && r.maxY == region.maxY;
+    } else if (incremental) {
+        // New ink outside the old region changes the pyramid's size.
+        const Rect& r = before.layout.region;
+        incremental = ink.empty() || (ink.minX >= r.minX && ink.minY >= r.minY && ink.maxX <= r.maxX && ink.maxY <= r.maxY);
+        region = r;
+    }
+    if (!incremental && !parser.isSet(regionOption)) region = ink;
+    now.layout = DeepZoomLayout(region, zoomExp, tileSize);
+    const DeepZoomLayout& layout = now.layout;
+    if (!layout.valid()) {
+        err << "cancans_tiles: " << (region.empty() ? "nothing to draw" : "the deepest level is too large; lower --zoom")
+            << '\n';
+        return 1;
+    }
+
+    std::vector<TileJob> tiles;
+    if (incremental) {
+        const auto touched = deepZoomTilesTouched(layout, strokes, before.strokes);
+        for (int l = 0; l <= layout.maxLevel; ++l) {
+            for (std::uint64_t key : touched[static_cast<std::size_t>(l)]) {
+                tiles.push_back({l, static_cast<int>(key & 0xFFFFFFFFu), static_cast<int>(key >> 32)});
+            }
+        }
+    } else {
+        // Tiles of an earlier, differently shaped pyramid would linger.
+        if (hadManifest) QDir(filesDir).removeRecursively();
+        tiles.reserve(layout.tileCount());
+        for (int l = 0; l <= layout.maxLevel; ++l) {
+            for (int row = 0; row < layout.tilesY(l); ++row) {
+                for (int col = 0; col < layout.tilesX(l); ++col) tiles.push_back({l, col, row});
+            }
+        }
+    }
+    for (int l = 0; l <= layout.maxLevel; ++l) {
+        if (!QDir().mkpath(QStringLiteral("%1/%2").arg(filesDir).arg(l))) {
+            err << "cancans_tiles: cannot create " << filesDir << '\n';
+            return 1;
+        }
+    }
+
+    TileWriter writer(filesDir, format, quality);
+    std::atomic<std::size_t> next{0};
+    std::atomic<std::size_t> failed{0};
+    QElapsedTimer timer;
+    timer.start();
+    // Workers take tiles one at a time: their cost varies too much to split
+    // the list up front. The scene holds still while they run, so they share
+    // its index, which is rebuilt above and has nothing pending.
+    const std::size_t threads = std::max<std::size_t>(1, std::min(jobs, tiles.size()));
+    const auto work = [&]() {
+        FramePainter painter;
+        QImage image;
+        std::vector<std::size_t> visible;
+        std::vector<std::uint32_t> rows;
+        for (;;) {
+            const std::size_t i = next.fetch_add(1);
+            if (i >= tiles.size()) break;
+            const TileJob& t = tiles[i];
+            const Rect area = layout.tileRect(t.level, t.col, t.row);
+            const QSize size(layout.tileSize, layout.tileSize);
+            const QSize cut(std::min(size.width(), layout.levelWidth(t.level) - t.col * layout.tileSize),
+                            std::min(size.height(), layout.levelHeight(t.level) - t.row * layout.tileSize));
+            const double levelZoom = layout.levelZoomExp(t.level);
+            // Ink just outside the tile still antialiases into its edge.
+            const Rect query = area.inflated(2.0 * std::exp2(-levelZoom));
+            visible.clear();
+            rows.clear();
+            scene.queryRect(query, visible);
+            elements.query(query, rows);
+            bool ok;
+            if (visible.empty() && rows.empty()) {
+                ok = writer.writeBlank(t, cut);
+            } else {
+                if (image.size() != cut) image = QImage(cut, QImage::Format_ARGB32_Premultiplied);
+                image.fill(FramePainter::backgroundColor());
+                Camera cam;
+                cam.setState(levelZoom, {0.0, 0.0}, {area.minX, area.minY});
+                {
+                    QPainter p(&image);
+                    p.setRenderHint(QPainter::Antialiasing, true);
+                    painter.paintScene(p, cut, cam, strokes, visible, elements, rows);
+                }
+                ok = writer.write(t, image);
+            }
+            if (!ok && failed.fetch_add(1) == 0) {
+                QTextStream(stderr) << "cancans_tiles: cannot write " << writer.path(t) << '\n';
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (std::size_t w = 1; w < threads; ++w) workers.emplace_back(work);
+    work();
+    for (std::thread& t : workers) t.join();
+
+    const double seconds = static_cast<double>(timer.nsecsElapsed()) / 1e9;
+    if (failed > 0) {
+        err << "cancans_tiles: " << failed.load() << " of " << tiles.size() << " tiles failed\n";
+        return 1;
+    }
+    if (!writeDzi(out.filePath(name + QStringLiteral(".dzi")), layout, format) || !writeManifest(manifestPath, now)) {
+        err << "cancans_tiles: cannot write " << name << ".dzi or its manifest\n";
+        return 1;
+    }
+    err << "cancans_tiles: " << tiles.size() << (incremental ? " changed" : "") << " tiles over "
+        << layout.maxLevel + 1 << " levels (" << layout.width << 'x' << layout.height << " px) in " << seconds
+        << " s on " << threads << " threads\n";
+    return 0;
+}
@@ -1,33 +1,96 @@
 #include "canvas_view.hpp"
 
+#include <QByteArray>
 #include <QColor>
-#include <QFontMetrics>
+#include <QCursor>
+#include <QDragEnterEvent>
+#include <QDropEvent>
+#include <QMimeData>
+#include <QFont>
+#include <QFontInfo>
+#include <QFontMetricsF>
+#include <QInputDialog>
 #include <QKeyEvent>
 #include <QMouseEvent>
 #include <QPainter>
-#include <QPainterPath>
+#include <QPixmap>
+#include <QTimer>
 #include <QWheelEvent>
 #include <QtGlobal>
+#include <QPen>
+#include <QStringList>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <limits>
+#include <numbers>
+#include <string_view>
 
+#include "../core/metrics.hpp"
 #include "../core/scene.hpp"
+#include "image_library.hpp"
+#include "input_recorder.hpp"
+#include "painter_backend.hpp"
+#include "render_thread.hpp"
+#include "text_renderer.hpp"
 
 namespace {
-std::uint32_t rgbFromQColor(const QColor& color) {
-    return (static_cast<std::uint32_t>(color.red()) << 16) |
-           (static_cast<std::uint32_t>(color.green()) << 8) |
-            static_cast<std::uint32_t>(color.blue());
+constexpr int kColdScanIntervalMs = 1000;
+constexpr std::uint64_t kColdAfterFrames = 600;
+constexpr std::size_t kColdScanPerSlice = 4096;
+constexpr std::size_t kLodStrokesPerSlice = 16;
+// Idle rebuilds catch the index up long before queries would, but a full
+// rebuild is one slice, so not for every stroke on a huge board.
+constexpr std::size_t kIdleRebuildMinPending = 64;
+constexpr std::size_t kIdleRebuildDivisor = 64;
+constexpr std::size_t kMaxPrefetchTiles = 96;
+constexpr double kDefaultPredictMs = 16.0;
+constexpr double kMaxPredictMs = 30.0;
+constexpr double kTextEmPx = 18.0;
+constexpr double kEraserPerBrushPx = 3.0;
+constexpr double kMinEraserPx = 12.0;
+constexpr int kMaxCursorPx = 128;
+// Full quality returns once input has been quiet this long.
+constexpr int kSettleMs = 150;
+constexpr double kHudPad = 8.0;
+constexpr double kHudMargin = 12.0;
+constexpr double kHudRadius = 6.0;
+constexpr int kHudArcSteps = 6;
+constexpr std::uint32_t kHudBackground = 0x78000000;
+constexpr std::uint32_t kHudText = 0xFFEBEBEB;
+constexpr int kMemoryHudIntervalMs = 1000;
+// Left of the frame budget for presenting, the HUD and input.
+constexpr double kProgressiveBudgetMs = 10.0;
+constexpr std::size_t kDensityStrokesPerSlice = 256;
+constexpr std::size_t kDensityCheckPerSlice = 4096;
+
+std::int64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Clockwise from the top of the top-right corner.
+void roundedRect(const QRectF& r, double radius, std::vector<Vec2>& out) {
+    const QPointF centers[] = {
+        {r.right() - radius, r.top() + radius},
+        {r.right() - radius, r.bottom() - radius},
+        {r.left() + radius, r.bottom() - radius},
+        {r.left() + radius, r.top() + radius},
+    };
+    out.clear();
+    for (int c = 0; c < 4; ++c) {
+        for (int i = 0; i <= kHudArcSteps; ++i) {
+            const double a = (c - 1 + static_cast<double>(i) / kHudArcSteps) * std::numbers::pi / 2.0;
+            out.push_back({centers[c].x() + radius * std::cos(a), centers[c].y() + radius * std::sin(a)});
+        }
+    }
 }
 
-QColor colorFromRgb(std::uint32_t rgb) {
-    return QColor(
-        static_cast<int>((rgb >> 16) & 0xFF),
-        static_cast<int>((rgb >> 8) & 0xFF),
-        static_cast<int>(rgb & 0xFF)
-    );
+QString megabytes(std::size_t bytes) {
+    return QString::number(static_cast<double>(bytes) / (1024.0 * 1024.0), 'f', 1);
 }
+
 }
 
 CanvasView::CanvasView(Scene* scene, QWidget* parent)
@@ -37,6 +100,366 @@ CanvasView::CanvasView(Scene* scene, QWidget* parent)
     setMouseTracking(true);
     setFocusPolicy(Qt::StrongFocus);
     setAttribute(Qt::WA_OpaquePaintEvent);
+
+    idle_ = new IdleScheduler(this);
+    idle_->setBusyCheck([this]() { return interacting_ || panning_ || erasing_ || scene_->isDrawing(); });
+
+    coldTimer_ = new QTimer(this);
+    coldTimer_->setInterval(kColdScanIntervalMs);
+    connect(coldTimer_, &QTimer::timeout, this, &CanvasView::scheduleIdleWork);
+    coldTimer_->start();
+
+    settleTimer_ = new QTimer(this);
+    settleTimer_->setSingleShot(true);
+    settleTimer_->setInterval(kSettleMs);
+    connect(settleTimer_, &QTimer::timeout, this, [this]() {
+        interacting_ = false;
+        schedulePrefetch();
+        update();
+    });
+
+    memoryTimer_ = new QTimer(this);
+    memoryTimer_->setInterval(kMemoryHudIntervalMs);
+    connect(memoryTimer_, &QTimer::timeout, this, &CanvasView::refreshMemoryHud);
+}
+
+CanvasView::~CanvasView() = default;
+
+void CanvasView::setCamera(const Camera& cam) {
+    cam_ = cam;
+    if (recorder_) recorder_->recordView(*this);
+    update();
+}
+
+bool CanvasView::startRecording(const QString& path) {
+    auto recorder = std::make_unique<InputRecorder>(path);
+    if (!recorder->start(*this, *scene_)) return false;
+    recorder_ = std::move(recorder);
+    return true;
+}
+
+void CanvasView::setImageLibrary(ImageLibrary* images) {
+    if (images_) disconnect(images_, nullptr, this, nullptr);
+    images_ = images;
+    painter_.setImageLibrary(images_);
+    setAcceptDrops(images_ != nullptr);
+    if (images_) {
+        connect(images_, &ImageLibrary::changed, this, [this]() {
+            submitted_.reset(); // new tiles: the async frame must be redrawn too
+            progressiveState_.reset();
+            update();
+        });
+    }
+    update();
+}
+
+void CanvasView::dragEnterEvent(QDragEnterEvent* e) {
+    if (images_ && e->mimeData()->hasUrls()) e->acceptProposedAction();
+}
+
+void CanvasView::dropEvent(QDropEvent* e) {
+    if (!images_) return;
+    // Images land at one screen pixel per image pixel, centred on the drop
+    // point; several files are cascaded.
+    QPointF at = e->position();
+    bool added = false;
+    for (const QUrl& url : e->mimeData()->urls()) {
+        if (!url.isLocalFile()) continue;
+        QSize px;
+        const std::uint64_t id = images_->addFile(url.toLocalFile(), &px);
+        if (id == 0) continue;
+
+        const double sc = cam_.scale();
+        ImageElement im;
+        im.imageId = id;
+        im.pixelWidth = static_cast<std::uint32_t>(px.width());
+        im.pixelHeight = static_cast<std::uint32_t>(px.height());
+        im.size = {px.width() / sc, px.height() / sc};
+        const Vec2 center = cam_.worldFromScreen(at.x(), at.y());
+        im.pos = {center.x - im.size.x * 0.5, center.y - im.size.y * 0.5};
+        scene_->addImage(im);
+        at += QPointF(24.0, 24.0);
+        added = true;
+    }
+    if (added) {
+        e->acceptProposedAction();
+        update();
+    }
+}
+
+void CanvasView::placeText(const QPointF& at) {
+    // New labels read at a fixed size on screen, with their top-left corner
+    // at the click. Board coordinates, in case the scene recenters while
+    // the dialog is open.
+    const double em = kTextEmPx / cam_.scale();
+    const Vec2 board = cam_.worldFromScreen(at.x(), at.y()) + scene_->origin();
+    // The dialog runs an event loop of its own; not inside the press.
+    QTimer::singleShot(0, this, [this, em, board]() {
+        bool ok = false;
+        const QString text = QInputDialog::getMultiLineText(this, tr("Text"), tr("Label:"), QString(), &ok);
+        if (!ok || text.trimmed().isEmpty() || !scene_) return;
+
+        const QSizeF box = TextRenderer::emBox(text, QString());
+        TextElement t;
+        t.text = text.toStdString();
+        t.fontSizeExp = std::log2(em);
+        t.colorRGB = brushColorRGB_;
+        t.pos = board - scene_->origin();
+        t.size = {box.width() * em, box.height() * em};
+        scene_->addText(t);
+        update();
+    });
+}
+
+double CanvasView::eraserPx() const {
+    return std::max(brushPx_ * kEraserPerBrushPx, kMinEraserPx);
+}
+
+void CanvasView::updateEraserCursor() {
+    const int d = std::min(static_cast<int>(std::ceil(eraserPx())), kMaxCursorPx - 2);
+    QPixmap pm(d + 2, d + 2);
+    pm.fill(Qt::transparent);
+    QPainter p(&pm);
+    p.setRenderHint(QPainter::Antialiasing, true);
+    p.setPen(QPen(QColor(230, 230, 230), 1.0));
+    p.drawEllipse(QRectF(1.0, 1.0, d, d));
+    p.end();
+    setCursor(QCursor(pm));
+}
+
+void CanvasView::eraseTo(const QPointF& at) {
+    // Each move erases only the capsule swept since the previous one. The
+    // anchor is kept in board coordinates so a recenter between moves
+    // does not drag it across the board.
+    const Vec2 w = cam_.worldFromScreen(at.x(), at.y());
+    const Capsule capsule{lastErase_ - scene_->origin(), w, 0.5 * eraserPx() / cam_.scale()};
+    emit aboutToErase(capsule);
+    const Rect damaged = scene_->erase(capsule);
+    lastErase_ = w + scene_->origin();
+    if (damaged.empty()) return;
+    // Raster ink there is gone; the idle check finds the cut strokes.
+    density_.raster.markStale(damaged.translated(scene_->origin()));
+    densityRebuild_.reset();
+    const Vec2 a = cam_.screenFromWorld(damaged.minX, damaged.minY);
+    const Vec2 b = cam_.screenFromWorld(damaged.maxX, damaged.maxY);
+    update(QRectF(QPointF(a.x, a.y), QPointF(b.x, b.y)).normalized().toAlignedRect().adjusted(-2, -2, 2, 2));
+}
+
+void CanvasView::scheduleIdleWork() {
+    using Priority = IdleScheduler::Priority;
+    if (scene_->lodPendingCount() > 0 && !idle_->isQueued(lodJob_)) {
+        lodJob_ = idle_->post("lod", Priority::Normal, [this](const IdleScheduler::Token& token) {
+            while (!token.shouldYield()) {
+                if (scene_->buildPendingLod(kLodStrokesPerSlice) == 0) return true;
+            }
+            return false;
+        });
+    }
+    const std::size_t pending = scene_->indexPendingCount();
+    if (pending >= std::max(kIdleRebuildMinPending, scene_->strokes().size() / kIdleRebuildDivisor) &&
+        !idle_->isQueued(indexJob_)) {
+        // Packing the tree is one long step, so it runs on a worker; this
+        // job only starts it and swaps the result in.
+        struct IndexJob {
+            Scene::IndexBuild build;
+            std::atomic<bool> built{false};
+            bool started = false;
+        };
+        auto job = std::make_shared<IndexJob>();
+        indexJob_ = idle_->post("index", Priority::Normal, [this, job](const IdleScheduler::Token&) {
+            if (!job->started) {
+                job->started = true;
+                scene_->beginIndexBuild(job->build);
+                idle_->postWorker("index build", Priority::Normal, [job](const IdleScheduler::Token&) {
+                    job->build.index.rebuild(job->build.strokes);
+                    job->built.store(true, std::memory_order_release);
+                    return true;
+                });
+                return false;
+            }
+            if (!job->built.load(std::memory_order_acquire)) return false;
+            scene_->finishIndexBuild(job->build);
+            return true;
+        });
+    }
+    // One pass over all strokes per job, a slice at a time.
+    if (!scene_->strokes().empty() && !idle_->isQueued(compactJob_)) {
+        auto visited = std::make_shared<std::size_t>(0);
+        compactJob_ = idle_->post("compact", Priority::Low, [this, visited](const IdleScheduler::Token& token) {
+            while (!token.shouldYield()) {
+                scene_->compactColdStrokes(kColdAfterFrames, kColdScanPerSlice);
+                *visited += kColdScanPerSlice;
+                if (*visited >= scene_->strokes().size()) return true;
+            }
+            return false;
+        });
+    }
+    if (!scene_->strokes().empty() && !idle_->isQueued(densityJob_)) {
+        auto next = std::make_shared<std::size_t>(0);
+        // Board extent for a rebuild, gathered over as many slices as it takes.
+        struct Extent {
+            std::size_t next = 0;
+            Rect all;
+        };
+        auto extent = std::make_shared<Extent>();
+        const std::uint64_t revision = scene_->revision();
+        densityJob_ = idle_->post("density", Priority::Low,
+                                  [this, next, extent, revision](const IdleScheduler::Token& token) {
+            const std::uint64_t shown = density_.raster.revision();
+            const StrokeList& strokes = scene_->strokes();
+            const Vec2 origin = scene_->origin();
+            if (revision != densityChecked_) {
+                if (density_.ink.size() > strokes.size()) {
+                    // Strokes went away: a different board.
+                    density_ = DensityFeed();
+                    densityRebuild_.reset();
+                }
+                while (*next < density_.ink.size()) {
+                    if (token.shouldYield()) return false;
+                    const std::size_t end = std::min(density_.ink.size(), *next + kDensityCheckPerSlice);
+                    for (; *next < end; ++*next) {
+                        const Stroke& s = strokes[*next];
+                        DensityInk& was = density_.ink[*next];
+                        const Rect now = s.empty() ? Rect() : s.inkBounds().translated(origin);
+                        if (was.points == s.pointCount() && SettledStrokes::sameBounds(was.bounds, now)) continue;
+                        density_.raster.markStale(was.bounds);
+                        density_.raster.markStale(now);
+                        was = DensityInk{now, s.pointCount()};
+                        densityRebuild_.reset();
+                    }
+                }
+                densityChecked_ = revision;
+            }
+            while (!feedDensity(density_, kDensityStrokesPerSlice)) {
+                if (token.shouldYield()) return false;
+            }
+            if (density_.raster.needsRebuild()) {
+                if (!densityRebuild_) {
+                    // Sized for the whole board up front, so nothing is left
+                    // thick by growth. Board units, as recenters may come
+                    // between slices.
+                    while (extent->next < strokes.size()) {
+                        if (token.shouldYield()) return false;
+                        const std::size_t end = std::min(strokes.size(), extent->next + kDensityCheckPerSlice);
+                        for (; extent->next < end; ++extent->next) {
+                            const Stroke& s = strokes[extent->next];
+                            if (!s.empty()) extent->all.expand(s.inkBounds().translated(origin));
+                        }
+                    }
+                    densityRebuild_ = std::make_unique<DensityFeed>();
+                    densityRebuild_->raster.cover(extent->all);
+                    *extent = Extent();
+                }
+                while (!feedDensity(*densityRebuild_, kDensityStrokesPerSlice)) {
+                    if (token.shouldYield()) return false;
+                }
+                // Strokes settle over two looks; the next round takes them.
+                if (!densityRebuild_->settled.waiting()) {
+                    density_ = std::move(*densityRebuild_);
+                    densityRebuild_.reset();
+                }
+            }
+            if (density_.raster.revision() != shown) update();
+            return true;
+        });
+    }
+}
+
+bool CanvasView::feedDensity(DensityFeed& feed, std::size_t maxStrokes) {
+    const Vec2 origin = scene_->origin();
+    return feed.settled.advance(*scene_, maxStrokes, [&](const Stroke& s) {
+        feed.raster.add(s, origin);
+        feed.ink.push_back({s.empty() ? Rect() : s.inkBounds().translated(origin), s.pointCount()});
+    });
+}
+
+void CanvasView::queryVisibleStrokes() {
+    visible_.clear();
+    const Rect view = viewWorldRect();
+    // Cells are sized for device pixels. Until the idle check has seen a
+    // shorter board, a raster with more strokes than the scene is not used.
+    if (density_.raster.strokeCount() <= scene_->strokes().size() &&
+        density_.raster.plan(cam_.zoomExp() + std::log2(devicePixelRatioF()), view, scene_->origin(), densityFrame_)) {
+        scene_->queryVisible(densityFrame_.pathAreas, densityFrame_.strokes, view, visible_);
+    } else {
+        densityFrame_ = DensityFrame();
+        scene_->queryVisible(view, visible_);
+    }
+}
+
+void CanvasView::schedulePrefetch() {
+    idle_->cancel(prefetchJob_);
+    if (!images_) return;
+
+    // Tiles a short pan or one zoom step away: the view grown by half on
+    // every side at the current level, and the whole view one level coarser.
+    struct TileRef { std::uint64_t id; int level, tx, ty; };
+    auto tiles = std::make_shared<std::vector<TileRef>>();
+    const QRectF view(QPointF(0.0, 0.0), QSizeF(size()));
+    const QRectF around = view.adjusted(-view.width() * 0.5, -view.height() * 0.5, view.width() * 0.5, view.height() * 0.5);
+    const Vec2 tl = cam_.worldFromScreen(around.left(), around.top());
+    const Vec2 br = cam_.worldFromScreen(around.right(), around.bottom());
+    std::vector<std::uint32_t> rows;
+    scene_->elements().query(Rect(tl.x, tl.y, br.x, br.y), rows);
+    const auto& images = scene_->elements().images();
+    for (std::uint32_t row : rows) {
+        if (scene_->elements().kind(row) != ElementKind::Image) continue;
+        const ImageElement& im = images[scene_->elements().slot(row)];
+        if (!images_->isReady(im.imageId)) continue;
+        const Vec2 a = cam_.screenFromWorld(im.pos.x, im.pos.y);
+        const Vec2 b = cam_.screenFromWorld(im.pos.x + im.size.x, im.pos.y + im.size.y);
+        const QRectF target = QRectF(QPointF(a.x, a.y), QPointF(b.x, b.y)).normalized();
+        if (target.isEmpty()) continue;
+        const TilePyramid pyr = images_->pyramid(im.imageId);
+        const int base = pyr.levelFor(pyr.width / (target.width() * devicePixelRatioF()));
+        for (int level = base; level <= std::min(base + 1, pyr.levels - 1); ++level) {
+            const QRectF want = target.intersected(level == base ? around : view);
+            if (want.isEmpty()) continue;
+            const double sx = pyr.levelWidth(level) / target.width();
+            const double sy = pyr.levelHeight(level) / target.height();
+            const int tx0 = std::max(0, static_cast<int>((want.left() - target.left()) * sx) / pyr.tileSize);
+            const int ty0 = std::max(0, static_cast<int>((want.top() - target.top()) * sy) / pyr.tileSize);
+            const int tx1 = std::min(pyr.tilesX(level) - 1, static_cast<int>((want.right() - target.left()) * sx) / pyr.tileSize);
+            const int ty1 = std::min(pyr.tilesY(level) - 1, static_cast<int>((want.bottom() - target.top()) * sy) / pyr.tileSize);
+            for (int ty = ty0; ty <= ty1 && tiles->size() < kMaxPrefetchTiles; ++ty) {
+                for (int tx = tx0; tx <= tx1 && tiles->size() < kMaxPrefetchTiles; ++tx) {
+                    tiles->push_back(TileRef{im.imageId, level, tx, ty});
+                }
+            }
+        }
+    }
+    if (tiles->empty()) return;
+
+    auto next = std::make_shared<std::atomic<std::size_t>>(0);
+    ImageLibrary* library = images_;
+    prefetchJob_ = idle_->postWorker("prefetch", IdleScheduler::Priority::Low,
+                                     [library, tiles, next](const IdleScheduler::Token& token) {
+        while (*next < tiles->size() && !token.shouldYield()) {
+            const TileRef& t = (*tiles)[(*next)++];
+            library->prefetch(t.id, t.level, t.tx, t.ty);
+        }
+        return *next >= tiles->size();
+    });
+}
+
+bool CanvasView::event(QEvent* e) {
+    switch (e->type()) {
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    case QEvent::MouseMove:
+    case QEvent::Wheel:
+    case QEvent::KeyPress:
+    case QEvent::TabletPress:
+    case QEvent::TabletMove:
+    case QEvent::TouchBegin:
+    case QEvent::TouchUpdate:
+        idle_->preempt();
+        break;
+    default:
+        break;
+    }
+    if (recorder_) recorder_->record(e);
+    return QWidget::event(e);
 }
 
 void CanvasView::setMode(ui::Mode mode) {
@@ -54,11 +477,18 @@ void CanvasView::setMode(ui::Mode mode) {
     case ui::Mode::Draw:
         setCursor(Qt::CrossCursor);
         break;
+    case ui::Mode::Text:
+        setCursor(Qt::IBeamCursor);
+        break;
+    case ui::Mode::Eraser:
+        updateEraserCursor();
+        break;
     default:
         setCursor(Qt::ArrowCursor);
         break;
     }
 
+    if (recorder_) recorder_->recordView(*this);
     emit modeChanged(mode_);
     update();
 }
@@ -67,6 +497,8 @@ void CanvasView::setBrushWidth(double px) {
     px = std::clamp(px, 0.5, 256.0);
     if (std::abs(brushPx_ - px) < 1e-6) return;
     brushPx_ = px;
+    if (mode_ == ui::Mode::Eraser) updateEraserCursor();
+    if (recorder_) recorder_->recordView(*this);
     emit brushWidthChanged(brushPx_);
     update();
 }
@@ -76,6 +508,7 @@ void CanvasView::setBrushColor(const QColor& color) {
     const std::uint32_t rgb = rgbFromQColor(color);
     if (brushColorRGB_ == rgb) return;
     brushColorRGB_ = rgb;
+    if (recorder_) recorder_->recordView(*this);
     emit brushColorChanged(colorFromRgb(brushColorRGB_));
     update();
 }
@@ -84,12 +517,22 @@ QColor CanvasView::brushColor() const {
     return colorFromRgb(brushColorRGB_);
 }
 
+void CanvasView::setBrushKind(BrushKind kind) {
+    if (brushKind_ == kind) return;
+    brushKind_ = kind;
+    if (recorder_) recorder_->recordView(*this);
+    emit brushKindChanged(brushKind_);
+}
+
 void CanvasView::resizeEvent(QResizeEvent*) {
     cam_.setOffsetPx(width() / 2.0, height() / 2.0);
     update();
 }
 
 void CanvasView::wheelEvent(QWheelEvent* e) {
+    Metrics::add(Metrics::Counter::WheelEvents);
+    noteViewInput(steadyNowNs());
+    noteInteraction();
     const double angle = e->angleDelta().y() / 120.0;
     const double deltaExp = angle / 6.0;
     cam_.zoomAt(e->position().x(), e->position().y(), deltaExp);
@@ -98,6 +541,7 @@ void CanvasView::wheelEvent(QWheelEvent* e) {
 }
 
 void CanvasView::mousePressEvent(QMouseEvent* e) {
+    Metrics::add(Metrics::Counter::PointerEvents);
     if (!scene_) return;
 
     if (mode_ == ui::Mode::Pan) {
@@ -109,31 +553,52 @@ void CanvasView::mousePressEvent(QMouseEvent* e) {
         }
     } else if (mode_ == ui::Mode::Draw) {
         if (e->button() == Qt::LeftButton) {
-            scene_->beginStroke(brushPx_, brushColorRGB_, cam_);
-            scene_->addScreenPoint(e->position().x(), e->position().y(), cam_);
+            const std::int64_t t = steadyNowNs();
+            predictor_.reset();
+            scene_->beginStroke(brushPx_, brushColorRGB_, cam_, brushKind_);
+            scene_->addScreenPoint(e->position().x(), e->position().y(), cam_, t);
+            predictor_.addSample(t, e->position().x(), e->position().y());
+            startLiveInk();
             update();
         }
+    } else if (mode_ == ui::Mode::Text) {
+        if (e->button() == Qt::LeftButton) placeText(e->position());
+    } else if (mode_ == ui::Mode::Eraser) {
+        if (e->button() == Qt::LeftButton) {
+            erasing_ = true;
+            lastErase_ = cam_.worldFromScreen(e->position().x(), e->position().y()) + scene_->origin();
+            eraseTo(e->position());
+        }
     }
 }
 
 void CanvasView::mouseMoveEvent(QMouseEvent* e) {
+    Metrics::add(Metrics::Counter::PointerEvents);
     if (!scene_) return;
 
     if (mode_ == ui::Mode::Pan) {
         if (!panning_) return;
+        noteViewInput(steadyNowNs());
+        noteInteraction();
         QPointF d = e->position() - lastPos_;
         lastPos_ = e->position();
         cam_.panPx(d.x(), d.y());
         update();
     } else if (mode_ == ui::Mode::Draw) {
         if (e->buttons() & Qt::LeftButton) {
-            scene_->addScreenPoint(e->position().x(), e->position().y(), cam_);
+            const std::int64_t t = steadyNowNs();
+            scene_->addScreenPoint(e->position().x(), e->position().y(), cam_, t);
+            predictor_.addSample(t, e->position().x(), e->position().y());
+            extendLiveInk();
             update();
         }
+    } else if (mode_ == ui::Mode::Eraser) {
+        if (erasing_ && (e->buttons() & Qt::LeftButton)) eraseTo(e->position());
     }
 }
 
 void CanvasView::mouseReleaseEvent(QMouseEvent* e) {
+    Metrics::add(Metrics::Counter::PointerEvents);
     if (!scene_) return;
 
     if (mode_ == ui::Mode::Pan) {
@@ -144,12 +609,21 @@ void CanvasView::mouseReleaseEvent(QMouseEvent* e) {
     } else if (mode_ == ui::Mode::Draw) {
         if (e->button() == Qt::LeftButton) {
             scene_->endStroke();
+            finishLiveInk();
+            predictor_.reset();
+            scheduleIdleWork();
             update();
         }
+    } else if (mode_ == ui::Mode::Eraser) {
+        if (e->button() == Qt::LeftButton) {
+            erasing_ = false;
+            scheduleIdleWork();
+        }
     }
 }
 
 void CanvasView::keyPressEvent(QKeyEvent* e) {
+    Metrics::add(Metrics::Counter::KeyEvents);
     switch (e->key()) {
     case Qt::Key_Space:
         spaceDown_ = true;
@@ -161,6 +635,21 @@ void CanvasView::keyPressEvent(QKeyEvent* e) {
     case Qt::Key_N:
         setMode(ui::Mode::Pan);
         break;
+    case Qt::Key_T:
+        setMode(ui::Mode::Text);
+        break;
+    case Qt::Key_E:
+        setMode(ui::Mode::Eraser);
+        break;
+    case Qt::Key_P:
+        setInkPrediction(!predictInk_);
+        break;
+    case Qt::Key_F3:
+        setMemoryHud(!memoryHud_);
+        break;
+    case Qt::Key_B:
+        setBrushKind(static_cast<BrushKind>((static_cast<int>(brushKind_) + 1) % kBrushKindCount));
+        break;
     case Qt::Key_BracketLeft:
         setBrushWidth(brushPx_ - 1.0);
         break;
@@ -181,125 +670,395 @@ void CanvasView::keyReleaseEvent(QKeyEvent* e) {
     QWidget::keyReleaseEvent(e);
 }
 
+void CanvasView::setAsyncRendering(bool enabled) {
+    if (enabled == (renderThread_ != nullptr)) return;
+    if (enabled) {
+        renderThread_ = new RenderThread(this);
+        connect(renderThread_, &RenderThread::frameReady, this, QOverload<>::of(&QWidget::update), Qt::QueuedConnection);
+        renderThread_->start();
+        submitted_.reset();
+    } else {
+        renderThread_->stop();
+        renderThread_->wait();
+        delete renderThread_;
+        renderThread_ = nullptr;
+    }
+    update();
+}
+
 void CanvasView::paintEvent(QPaintEvent*) {
+    const std::int64_t paintStart = steadyNowNs();
     recenterSceneIfNeeded();
     QPainter p(this);
-    p.setRenderHint(QPainter::Antialiasing, true);
-    p.fillRect(rect(), QColor(24, 26, 27));
 
-    drawGrid(p);
-    drawStrokes(p);
+    std::int64_t inputStamp = 0;
+    extendLiveInk();
+    if (renderThread_) {
+        submitFrameIfChanged();
+        inputStamp = presentLatestFrame(p);
+    } else if (progressiveOn_) {
+        const std::int64_t start = steadyNowNs();
+        inputStamp = takeFrameInputStamp();
+        paintProgressive(p);
+        governor_.reportFrame(static_cast<double>(steadyNowNs() - start) / 1e6, 1.0);
+    } else {
+        // Painting straight to the widget can only drop antialiasing.
+        const std::int64_t start = steadyNowNs();
+        inputStamp = takeFrameInputStamp();
+        painter_.setAntialiasing(frameQuality().antialias);
+        painter_.setLiveStroke(liveStroke_);
+        painter_.paintBackground(p, size(), cam_);
+        visibleElements_.clear();
+        queryVisibleStrokes();
+        scene_->elements().query(viewWorldRect(), visibleElements_);
+        painter_.paintScene(p, size(), cam_, scene_->strokes(), visible_, scene_->elements(), visibleElements_,
+                            &densityFrame_);
+        const double ms = static_cast<double>(steadyNowNs() - start) / 1e6;
+        governor_.reportFrame(ms, 1.0);
+        if (inputStamp != 0 && governor_.overBudget(ms)) noteInteraction();
+    }
+    if (liveStroke_ != kNoLiveStroke) FramePainter::drawBrushLayer(p, liveLayer_);
+    if (predictInk_) drawPredictedInk(p);
     drawHud(p);
-}
 
-void CanvasView::drawGrid(QPainter& p) {
-    const double targetPx = 48.0;
-    const double sc = cam_.scale();
-    if (!std::isfinite(sc) || sc <= 0.0) return;
+    const std::int64_t end = steadyNowNs();
+    if (inputStamp != 0) {
+        latency_.record(end - inputStamp);
+        Metrics::record(Metrics::Timing::InputLatency, end - inputStamp);
+    }
+    Metrics::add(Metrics::Counter::Frames);
+    Metrics::record(Metrics::Timing::Paint, end - paintStart);
+    emit painted();
+}
 
-    double worldStep = targetPx / sc;
-    if (!std::isfinite(worldStep) || worldStep <= 0.0) return;
+void CanvasView::setProgressiveRendering(bool enabled) {
+    if (progressiveOn_ == enabled) return;
+    progressiveOn_ = enabled;
+    progressive_.clear();
+    progressiveState_.reset();
+    update();
+}
 
-    const double exp10 = std::floor(std::log10(std::max(worldStep, std::numeric_limits<double>::min())));
-    const double base = std::pow(10.0, exp10);
-    const double candidates[] = {1.0, 2.0, 5.0, 10.0};
-    for (double m : candidates) {
-        if (m * base >= worldStep) { worldStep = m * base; break; }
+void CanvasView::paintProgressive(QPainter& p) {
+    const bool antialias = frameQuality().antialias;
+    painter_.setAntialiasing(antialias);
+    painter_.setLiveStroke(liveStroke_);
+    const SubmittedState state{cam_, size(), devicePixelRatioF(), scene_->revision(), liveStroke_,
+                               QualityGovernor::Quality{1.0, antialias}, density_.raster.revision()};
+    // The query counts against the budget; binning and painting take the rest.
+    const std::int64_t start = steadyNowNs();
+    if (!progressiveState_ || !(*progressiveState_ == state)) {
+        progressiveState_ = state;
+        queryVisibleStrokes();
+        const QPoint cursor = mapFromGlobal(QCursor::pos());
+        const Vec2 focus = rect().contains(cursor) ? Vec2{static_cast<double>(cursor.x()), static_cast<double>(cursor.y())}
+                                                   : Vec2{width() * 0.5, height() * 0.5};
+        progressive_.restart(cam_, size(), devicePixelRatioF(), scene_->origin(), focus, visible_);
     }
+    const double queryMs = static_cast<double>(steadyNowNs() - start) / 1e6;
+    const bool done = progressive_.paint(painter_, scene_->strokes(), scene_->elements(), &densityFrame_,
+                                         kProgressiveBudgetMs - queryMs);
+    p.drawImage(QPointF(0.0, 0.0), progressive_.image());
+    // Queued, so input waiting since this paint is handled first.
+    if (!done) QTimer::singleShot(0, this, QOverload<>::of(&QWidget::update));
+}
 
-    const Vec2 tl = cam_.worldFromScreen(0, 0);
-    const Vec2 br = cam_.worldFromScreen(width(), height());
+void CanvasView::noteInteraction() {
+    interacting_ = true;
+    settleTimer_->start();
+}
 
-    if (!std::isfinite(tl.x) || !std::isfinite(tl.y) ||
-        !std::isfinite(br.x) || !std::isfinite(br.y)) {
-        return;
-    }
+QualityGovernor::Quality CanvasView::frameQuality() const {
+    return interacting_ ? governor_.interactive(/*scalable=*/renderThread_ != nullptr) : QualityGovernor::full();
+}
 
-    double worldLeft = std::min(tl.x, br.x);
-    double worldRight = std::max(tl.x, br.x);
-    double worldTop = std::min(tl.y, br.y);
-    double worldBottom = std::max(tl.y, br.y);
-    const int maxLines = 500;
+void CanvasView::setInkPrediction(bool enabled) {
+    if (predictInk_ == enabled) return;
+    predictInk_ = enabled;
+    update();
+}
+
+void CanvasView::noteViewInput(std::int64_t timeNs) {
+    if (viewInputNs_ == 0) viewInputNs_ = timeNs;
+}
+
+std::int64_t CanvasView::takeFrameInputStamp() {
+    const std::int64_t sceneStamp = scene_->takeInputStamp();
+    const std::int64_t viewStamp = viewInputNs_;
+    viewInputNs_ = 0;
+    if (sceneStamp == 0) return viewStamp;
+    if (viewStamp == 0) return sceneStamp;
+    return std::min(sceneStamp, viewStamp);
+}
 
-    QPen minor(QColor(60, 62, 64));  minor.setWidthF(1.0);
-    QPen major(QColor(80, 84, 88));  major.setWidthF(1.2);
+void CanvasView::drawPredictedInk(QPainter& p) {
+    if (!scene_->isDrawing()) return;
+    const auto& strokes = scene_->strokes();
+    if (scene_->activeIndex() >= strokes.size()) return;
+    const Stroke& s = strokes[scene_->activeIndex()];
+    const auto& pts = s.pointsWorld();
+    if (pts.empty()) return;
+
+    // Lead by about one median latency; the segment is repainted every frame
+    // and disappears once real points catch up.
+    const double horizonMs = latency_.count() > 0
+        ? std::min(latency_.percentileMs(0.5), kMaxPredictMs)
+        : kDefaultPredictMs;
+    Vec2 ahead;
+    if (!predictor_.predict(static_cast<std::int64_t>(horizonMs * 1e6), ahead)) return;
+
+    const double penPx = s.widthScreen(cam_.zoomExp());
+    if (penPx < StrokeBatcher::kMinWidthPx) return;
+    const Vec2 last = cam_.screenFromWorld(pts.back().x, pts.back().y);
+
+    QPen pen(colorFromRgb(s.colorRGB()));
+    pen.setWidthF(std::min(penPx, StrokeBatcher::kMaxWidthPx));
+    pen.setCapStyle(Qt::RoundCap);
+    p.setRenderHint(QPainter::Antialiasing, true);
+    p.setPen(pen);
+    p.drawLine(QPointF(last.x, last.y), QPointF(ahead.x, ahead.y));
+}
 
-    int i = 0;
-    const int limit = maxLines + 2;
-    for (double x = std::floor(worldLeft / worldStep) * worldStep; i < limit && x <= worldRight + worldStep; x += worldStep, ++i) {
-        const Vec2 sx = cam_.screenFromWorld(x, 0);
-        if (!std::isfinite(sx.x)) break;
-        p.setPen((i % 5 == 0) ? major : minor);
-        p.drawLine(QPointF(sx.x, 0), QPointF(sx.x, height()));
+void CanvasView::startLiveInk() {
+    stopLiveInk();
+    if (!scene_->isDrawing() || scene_->activeIndex() >= scene_->strokes().size()) return;
+    const Stroke& s = scene_->strokes()[scene_->activeIndex()];
+    if (!BrushEngine::usesDabs(s, cam_.zoomExp())) return;
+    liveStroke_ = scene_->activeIndex();
+    liveCam_ = cam_;
+    liveBrush_.begin(s, cam_, Rect(0.0, 0.0, width(), height()), devicePixelRatioF(), liveLayer_);
+    liveBrush_.extend(s);
+}
+
+void CanvasView::extendLiveInk() {
+    if (liveStroke_ == kNoLiveStroke) return;
+    const auto& strokes = scene_->strokes();
+    if (liveStroke_ >= strokes.size()) {
+        stopLiveInk();
+        return;
+    }
+    const Stroke& s = strokes[liveStroke_];
+    if (!BrushEngine::usesDabs(s, cam_.zoomExp())) {
+        stopLiveInk();
+        return;
     }
+    // Dabs are placed in device pixels, so a moved view or a new screen
+    // starts the layer over.
+    if (!(liveCam_ == cam_) || liveLayer_.pixelRatio() != devicePixelRatioF()) {
+        liveLayer_.clear();
+        liveCam_ = cam_;
+        liveBrush_.begin(s, cam_, Rect(0.0, 0.0, width(), height()), devicePixelRatioF(), liveLayer_);
+    }
+    liveBrush_.extend(s);
+}
 
-    int j = 0;
-    for (double y = std::floor(worldTop / worldStep) * worldStep; j < limit && y <= worldBottom + worldStep; y += worldStep, ++j) {
-        const Vec2 sy = cam_.screenFromWorld(0, y);
-        if (!std::isfinite(sy.y)) break;
-        p.setPen((j % 5 == 0) ? major : minor);
-        p.drawLine(QPointF(0, sy.y), QPointF(width(), sy.y));
+void CanvasView::finishLiveInk() {
+    if (liveStroke_ == kNoLiveStroke) return;
+    if (!renderThread_) {
+        stopLiveInk();
+        return;
     }
+    extendLiveInk();
+    liveHeld_ = true;
+    liveEndRevision_ = scene_->revision();
 }
 
-void CanvasView::drawStrokes(QPainter& p) {
-    p.setRenderHint(QPainter::Antialiasing, true);
-    p.setBrush(Qt::NoBrush);
+void CanvasView::stopLiveInk() {
+    liveStroke_ = kNoLiveStroke;
+    liveHeld_ = false;
+    liveLayer_.clear();
+}
 
-    if (!scene_) return;
+void CanvasView::submitFrameIfChanged() {
+    const QualityGovernor::Quality quality = frameQuality();
+    const std::size_t liveStroke = liveHeld_ ? kNoLiveStroke : liveStroke_;
+    const SubmittedState state{cam_, size(), devicePixelRatioF(), scene_->revision(), liveStroke, quality,
+                               density_.raster.revision()};
+    if (submitted_ && *submitted_ == state) return;
+    submitted_ = state;
 
-    for (const auto& s : scene_->strokes()) {
-        const auto& pts = s.pointsWorld();
-        if (pts.size() < 2) continue;
-
-        double penPx = s.widthScreen(cam_.zoomExp());
-        if (penPx < 0.05) continue;
-        if (penPx > 4096.0) penPx = 4096.0;
-
-        QPen pen(colorFromRgb(s.colorRGB()));
-        pen.setWidthF(penPx);
-        pen.setCapStyle(Qt::RoundCap);
-        pen.setJoinStyle(Qt::RoundJoin);
-        p.setPen(pen);
-
-        QPainterPath path;
-        Vec2 first = cam_.screenFromWorld(pts[0].x, pts[0].y);
-        path.moveTo(first.x, first.y);
-        for (size_t i = 1; i < pts.size(); ++i) {
-            Vec2 screenPt = cam_.screenFromWorld(pts[i].x, pts[i].y);
-            path.lineTo(screenPt.x, screenPt.y);
-        }
-        p.drawPath(path);
+    FrameRequest req;
+    req.cam = cam_;
+    req.size = size();
+    req.dpr = devicePixelRatioF();
+    req.resolution = quality.resolution;
+    req.antialias = quality.antialias;
+    req.inputNs = takeFrameInputStamp();
+    req.liveStroke = liveStroke;
+
+    // The query thaws what is on screen; publishing afterwards hands the
+    // render thread those strokes hot. Unchanged chunks and strokes are
+    // shared with the previous snapshot, so only edits are copied.
+    queryVisibleStrokes();
+    scene_->publish();
+    req.scene = scene_->snapshot();
+    req.origin = req.scene->origin;
+    req.revision = req.scene->revision;
+    req.visible = visible_;
+    req.density = densityFrame_;
+    req.images = images_;
+    req.scene->elements->query(viewWorldRect(), req.elementRows);
+
+    renderThread_->submit(std::move(req));
+}
+
+std::int64_t CanvasView::presentLatestFrame(QPainter& p) {
+    const RenderedFrame frame = renderThread_->latest();
+    p.fillRect(rect(), FramePainter::backgroundColor());
+    if (frame.image.isNull()) {
+        FramePainter::drawGrid(p, size(), cam_);
+        return 0;
+    }
+    if (frame.serial != reportedFrame_) {
+        reportedFrame_ = frame.serial;
+        governor_.reportFrame(frame.renderMs, frame.resolution);
+        if (frame.inputNs != 0 && governor_.overBudget(frame.renderMs)) noteInteraction();
     }
+
+    // Reproject the frame to the current camera so pan and zoom respond
+    // before the render thread catches up. Recenters moved the scene by
+    // the origin difference since the frame was captured.
+    const Vec2 shift = scene_->origin() - frame.origin;
+    const Vec2 w0 = frame.cam.worldFromScreen(0.0, 0.0) - shift;
+    const Vec2 s0 = cam_.screenFromWorld(w0.x, w0.y);
+    const double k = cam_.scale() / frame.cam.scale();
+
+    p.save();
+    p.setRenderHint(QPainter::SmoothPixmapTransform, k != 1.0 || frame.resolution != 1.0);
+    p.translate(s0.x, s0.y);
+    p.scale(k, k);
+    p.drawImage(QPointF(0.0, 0.0), frame.image);
+    p.restore();
+
+    if (liveHeld_ && frame.liveStroke == kNoLiveStroke && frame.revision >= liveEndRevision_) stopLiveInk();
+
+    // Input latency is reported once, by the first paint that shows the frame.
+    if (frame.inputNs == 0 || frame.inputNs == presentedInputNs_) return 0;
+    presentedInputNs_ = frame.inputNs;
+    return frame.inputNs;
 }
 
 void CanvasView::drawHud(QPainter& p) {
     const double sc = cam_.scale();
     const double exp = std::log2(std::max(sc, 1e-12));
-    const QString text = QStringLiteral("Scale: 2^%1").arg(exp, 0, 'f', 2);
+    QStringList lines;
+    lines << QStringLiteral("Scale: 2^%1").arg(exp, 0, 'f', 2);
+    if (latency_.count() > 0) {
+        lines << QStringLiteral("Latency p50 %1  p95 %2  p99 %3 ms")
+                     .arg(latency_.percentileMs(0.50), 0, 'f', 1)
+                     .arg(latency_.percentileMs(0.95), 0, 'f', 1)
+                     .arg(latency_.percentileMs(0.99), 0, 'f', 1);
+    }
+    const QualityGovernor::Quality quality = frameQuality();
+    if (!(quality == QualityGovernor::full())) {
+        lines << QStringLiteral("Moving: %1% resolution%2")
+                     .arg(qRound(quality.resolution * 100.0))
+                     .arg(quality.antialias ? QString() : QStringLiteral(", no AA"));
+    }
+    if (progressiveOn_ && !renderThread_ && !progressive_.complete()) {
+        lines << QStringLiteral("Rendering: %1%").arg(static_cast<int>(progressive_.progress() * 100.0));
+    }
+    lines << memoryLines_;
+    if (lines != hudLines_ || size() != hudSize_) recordHud(lines);
 
-    QFont f = p.font();
-    f.setPointSizeF(f.pointSizeF() + 1);
-    p.setFont(f);
-    const QFontMetrics fm(p.font());
+    PainterBackend backend(p);
+    p.save();
+    p.setRenderHint(QPainter::Antialiasing, true);
+    hud_.replay(backend);
+    p.restore();
+}
+
+MemoryReport CanvasView::memoryReport(int waitMs) const {
+    MemoryReport report;
+    scene_->memoryUsage(report);
+    painter_.memoryUsage(report);
+    if (renderThread_) report.merge(renderThread_->memoryReport(waitMs));
+    MemoryUsage live = liveLayer_.memoryUsage();
+    live += liveBrush_.memoryUsage();
+    report.add("render.brush", live);
+    report.add("ui.hud", hud_.memoryUsage());
+    if (images_) report.add("ui.image_tiles", images_->memoryUsage());
+    MemoryUsage density = density_.raster.memoryUsage();
+    density += density_.settled.memoryUsage();
+    density.addVector(density_.ink);
+    if (densityRebuild_) {
+        density += densityRebuild_->raster.memoryUsage();
+        density += densityRebuild_->settled.memoryUsage();
+        density.addVector(densityRebuild_->ink);
+    }
+    report.add("render.density", density);
+    for (const MemorySource& source : memorySources_) source(report);
+    return report;
+}
 
-    const int pad = 8;
-    const int textW = fm.horizontalAdvance(text);
-    const int textH = fm.height();
+void CanvasView::addMemorySource(MemorySource source) {
+    memorySources_.push_back(std::move(source));
+}
 
-    QRect r(rect().right() - textW - pad * 2 - 12,
-            rect().bottom() - textH - pad * 2 - 12,
-            textW + pad * 2,
-            textH + pad * 2);
+void CanvasView::setMemoryHud(bool on) {
+    if (on == memoryHud_) return;
+    memoryHud_ = on;
+    if (on) {
+        memoryTimer_->start();
+        refreshMemoryHud();
+    } else {
+        memoryTimer_->stop();
+        memoryLines_.clear();
+        update();
+    }
+}
 
-    p.setRenderHint(QPainter::Antialiasing, true);
-    p.setPen(Qt::NoPen);
-    p.setBrush(QColor(0, 0, 0, 120));
-    p.drawRoundedRect(r, 6, 6);
+void CanvasView::refreshMemoryHud() {
+    // The render thread's part is from its previous count, so no wait here.
+    const MemoryReport report = memoryReport();
+    const MemoryUsage total = report.total();
+    QStringList lines;
+    lines << QStringLiteral("Memory: %1 MB used, %2 MB reserved, %3 allocations")
+                 .arg(megabytes(total.usedBytes), megabytes(total.reservedBytes))
+                 .arg(total.allocations);
+    for (const auto& [name, u] : report.entries()) {
+        QString line = QStringLiteral("  %1: %2 / %3 MB, %4 allocs")
+                           .arg(QString::fromStdString(name), megabytes(u.usedBytes), megabytes(u.reservedBytes))
+                           .arg(u.allocations);
+        if (u.points > 0) line += QStringLiteral(", %1 points").arg(u.points);
+        lines << line;
+    }
+    memoryLines_ = lines;
+    update();
+}
 
-    p.setPen(QColor(235, 235, 235));
-    p.drawText(r.adjusted(pad, pad, -pad, -pad),
-               Qt::AlignLeft | Qt::AlignVCenter, text);
+void CanvasView::recordHud(const QStringList& lines) {
+    hudLines_ = lines;
+    hudSize_ = size();
+    hud_.clear();
+
+    QFont f = font();
+    f.setPointSizeF(f.pointSizeF() + 1);
+    f.setPixelSize(QFontInfo(f).pixelSize());
+    const QFontMetricsF fm(f);
+
+    double textW = 0.0;
+    for (const QString& line : lines) textW = std::max(textW, fm.horizontalAdvance(line));
+    const double textH = fm.height() * lines.size();
+    const QRectF r(width() - textW - kHudPad * 2 - kHudMargin, height() - textH - kHudPad * 2 - kHudMargin,
+                   textW + kHudPad * 2, textH + kHudPad * 2);
+
+    std::vector<Vec2> panel;
+    roundedRect(r, kHudRadius, panel);
+    hud_.fill(kHudBackground, panel.data(), panel.size());
+    double baseline = r.top() + kHudPad + fm.ascent();
+    for (const QString& line : lines) {
+        const QByteArray utf8 = line.toUtf8();
+        hud_.text(kHudText, f.pixelSize(), {r.left() + kHudPad, baseline},
+                  std::string_view(utf8.constData(), static_cast<std::size_t>(utf8.size())));
+        baseline += fm.height();
+    }
+}
+
+Rect CanvasView::viewWorldRect() const {
+    const Vec2 tl = cam_.worldFromScreen(0, 0);
+    const Vec2 br = cam_.worldFromScreen(width(), height());
+    return Rect(tl.x, tl.y, br.x, br.y);
 }
 
 void CanvasView::recenterSceneIfNeeded() {
@@ -309,4 +1068,5 @@ void CanvasView::recenterSceneIfNeeded() {
     if (delta.x == 0.0 && delta.y == 0.0) return;
     scene_->translate(delta);
     cam_.shiftWorldCenter(delta);
+    Metrics::add(Metrics::Counter::Recenters);
 }
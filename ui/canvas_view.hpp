@@ -1,17 +1,45 @@
 #pragma once
 #include <QWidget>
 #include <QColor>
+#include <QSize>
+#include <QStringList>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
 #include "../core/camera.hpp"
+#include "../core/elements/stroke.hpp"
+#include "../core/ink_predictor.hpp"
+#include "../core/latency_histogram.hpp"
+#include "../core/memory_usage.hpp"
+#include "../core/polyline_cut.hpp"
+#include "../core/settled_strokes.hpp"
+#include "../render/quality_governor.hpp"
+#include "frame_painter.hpp"
+#include "idle_scheduler.hpp"
+#include "progressive_frame.hpp"
 #include "tool_mode.hpp"
 
+class ImageLibrary;
+class InputRecorder;
+class QTimer;
+class RenderThread;
 class Scene;
+class Stroke;
 
 class CanvasView : public QWidget {
     Q_OBJECT
 public:
     explicit CanvasView(Scene* scene, QWidget* parent = nullptr);
-    ~CanvasView() override = default;
+    ~CanvasView() override;
+
+    const Camera& camera() const { return cam_; }
+    void setCamera(const Camera& cam);
+    // Scene-local rectangle currently on screen.
+    Rect viewWorldRect() const;
 
     void setMode(ui::Mode mode);
     ui::Mode mode() const { return mode_; }
@@ -20,8 +48,47 @@ public:
     double brushWidth() const { return brushPx_; }
     void setBrushColor(const QColor& color);
     QColor brushColor() const;
+    void setBrushKind(BrushKind kind);
+    BrushKind brushKind() const { return brushKind_; }
+
+    // Renders on a background thread; paintEvent only presents the newest
+    // finished frame, reprojected to the current camera.
+    void setAsyncRendering(bool enabled);
+    bool asyncRendering() const { return renderThread_ != nullptr; }
+
+    // Input-to-present latency: from the input handler to the end of the
+    // paintEvent that first shows its effect.
+    const LatencyHistogram& latency() const { return latency_; }
+    // Draws provisional ink from the last real point to a short-horizon prediction.
+    void setInkPrediction(bool enabled);
+    bool inkPrediction() const { return predictInk_; }
+    // Without async rendering, frames are painted a time-budgeted part per
+    // paint event into a back buffer, nearest the cursor first.
+    void setProgressiveRendering(bool enabled);
+    bool progressiveRendering() const { return progressiveOn_; }
+
+    // Derived-data jobs that wait for the canvas to be idle.
+    IdleScheduler* idleScheduler() const { return idle_; }
+
+    // Heap held by the board and every cache behind the view, by subsystem.
+    // waitMs bounds the wait for the render thread to count its own.
+    MemoryReport memoryReport(int waitMs = 0) const;
+    using MemorySource = std::function<void(MemoryReport&)>;
+    // Adds subsystems that live outside the view to memoryReport().
+    void addMemorySource(MemorySource source);
+    // A HUD panel with the report, refreshed every second (F3).
+    void setMemoryHud(bool on);
+    bool memoryHud() const { return memoryHud_; }
+
+    // Pixels for image elements; also enables dropping image files on the view.
+    void setImageLibrary(ImageLibrary* images);
+
+    // Logs every input and paint event the view receives, starting from
+    // the current view state and board, for replay with cancans_replay.
+    bool startRecording(const QString& path);
 
 protected:
+    bool event(QEvent* e) override;
     void paintEvent(QPaintEvent*) override;
     void wheelEvent(QWheelEvent*) override;
     void mousePressEvent(QMouseEvent*) override;
@@ -30,20 +97,55 @@ protected:
     void resizeEvent(QResizeEvent*) override;
     void keyPressEvent(QKeyEvent*) override;
     void keyReleaseEvent(QKeyEvent*) override;
+    void dragEnterEvent(QDragEnterEvent*) override;
+    void dropEvent(QDropEvent*) override;
 
 signals:
     void modeChanged(ui::Mode mode);
     void brushWidthChanged(double width);
     void brushColorChanged(const QColor& color);
+    void brushKindChanged(BrushKind kind);
+    // Right before the scene cuts strokes with capsule (scene-local).
+    void aboutToErase(const Capsule& capsule);
+    // After every paint: the camera, the scene or both may have changed.
+    void painted();
 
 private:
-    void drawGrid(QPainter& p);
-    void drawStrokes(QPainter& p);
     void drawHud(QPainter& p);
+    void recordHud(const QStringList& lines);
+    void refreshMemoryHud();
+    void submitFrameIfChanged();
+    std::int64_t presentLatestFrame(QPainter& p);
+    void paintProgressive(QPainter& p);
+    void noteViewInput(std::int64_t timeNs);
+    std::int64_t takeFrameInputStamp();
+    void drawPredictedInk(QPainter& p);
+    // The stroke being drawn with a dab brush is stamped into liveLayer_ as
+    // its points arrive, rather than re-stamped by every frame.
+    void startLiveInk();
+    void extendLiveInk();
+    void finishLiveInk();
+    void stopLiveInk();
     QPointF toQt(const Vec2& v) const { return QPointF(v.x, v.y); }
     void recenterSceneIfNeeded();
+    void placeText(const QPointF& at);
+    double eraserPx() const;
+    void eraseTo(const QPointF& at);
+    void updateEraserCursor();
+    // Pan, zoom or input that overran the frame budget: render cheaper
+    // frames until the view has settled.
+    void noteInteraction();
+    QualityGovernor::Quality frameQuality() const;
+    // Queues idle-time jobs for derived data the scene has deferred.
+    void scheduleIdleWork();
+    // Strokes to draw as paths this frame, into visible_; fills densityFrame_
+    // when the view is far enough out for the density raster.
+    void queryVisibleStrokes();
+    void schedulePrefetch();
 
 private:
+    static constexpr std::size_t kNoLiveStroke = std::numeric_limits<std::size_t>::max();
+
     Camera cam_;
     Scene* scene_{nullptr};
 
@@ -51,7 +153,89 @@ private:
     bool     panning_   = false;
     bool     spaceDown_ = false;
     QPointF  lastPos_;
+    bool     erasing_   = false;
+    Vec2     lastErase_; // board coordinates
 
     double brushPx_ = 4.0; // Default brush width in pixels.
     std::uint32_t brushColorRGB_ = 0xE6E6E6; // Light grey by default.
+    BrushKind brushKind_ = BrushKind::Pen;
+
+    std::vector<std::size_t> visible_; // reused per frame
+    std::vector<std::uint32_t> visibleElements_;
+    FramePainter painter_;
+    QTimer* coldTimer_{nullptr};
+
+    struct SubmittedState {
+        Camera cam;
+        QSize size;
+        qreal dpr = 1.0;
+        std::uint64_t revision = 0;
+        std::size_t liveStroke = 0;
+        QualityGovernor::Quality quality;
+        std::uint64_t densityRevision = 0;
+        bool operator==(const SubmittedState&) const = default;
+    };
+    RenderThread* renderThread_{nullptr};
+    std::optional<SubmittedState> submitted_;
+
+    bool progressiveOn_ = false;
+    ProgressiveFrame progressive_;
+    std::optional<SubmittedState> progressiveState_; // what progressive_ is painting
+
+    BrushLayer liveLayer_;
+    BrushEngine liveBrush_;
+    Camera liveCam_;
+    std::size_t liveStroke_ = kNoLiveStroke;
+    // Async: a finished stroke stays in the layer until a frame has it.
+    bool liveHeld_ = false;
+    std::uint64_t liveEndRevision_ = 0;
+
+    // Re-recorded only when its text or the widget size changes.
+    DisplayList hud_;
+    QStringList hudLines_;
+    QSize hudSize_;
+
+    std::vector<MemorySource> memorySources_;
+    bool memoryHud_ = false;
+    QTimer* memoryTimer_{nullptr};
+    QStringList memoryLines_;
+
+    LatencyHistogram latency_;
+    std::int64_t viewInputNs_ = 0;      // oldest pan/zoom input not yet in a frame
+    std::int64_t presentedInputNs_ = 0;
+    InkPredictor predictor_;
+    bool predictInk_ = false;
+
+    QualityGovernor governor_;
+    bool interacting_ = false;
+    QTimer* settleTimer_{nullptr};
+    std::uint64_t reportedFrame_ = 0;
+
+    IdleScheduler* idle_{nullptr};
+    IdleScheduler::JobId lodJob_ = 0;
+    IdleScheduler::JobId indexJob_ = 0;
+    IdleScheduler::JobId compactJob_ = 0;
+    IdleScheduler::JobId prefetchJob_ = 0;
+    IdleScheduler::JobId densityJob_ = 0;
+
+    // Settled strokes in order, each with the board ink bounds and point
+    // count it was added with: a stroke that changes later marks both its
+    // old and new bounds stale.
+    struct DensityInk {
+        Rect bounds;
+        std::size_t points = 0;
+    };
+    struct DensityFeed {
+        DensityRaster raster;
+        SettledStrokes settled;
+        std::vector<DensityInk> ink;
+    };
+    bool feedDensity(DensityFeed& feed, std::size_t maxStrokes);
+    DensityFeed density_;
+    std::unique_ptr<DensityFeed> densityRebuild_; // replaces density_ once caught up
+    std::uint64_t densityChecked_ = 0;            // scene revision last verified
+    DensityFrame densityFrame_;
+
+    std::unique_ptr<InputRecorder> recorder_;
+    ImageLibrary* images_{nullptr};
 };
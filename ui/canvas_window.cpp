@@ -1,7 +1,12 @@
 #include "canvas_window.hpp"
 
+#include <QAction>
 #include <QEasingCurve>
+#include <QFile>
+#include <QFileDialog>
 #include <QHBoxLayout>
+#include <QInputDialog>
+#include <QMessageBox>
 #include <QResizeEvent>
 #include <QSizePolicy>
 #include <QToolButton>
@@ -10,13 +15,24 @@
 #include <QWidget>
 #include <algorithm>
 #include <cmath>
+#include <string>
 
+#include "../core/memory_budget.hpp"
+#include "../core/metrics.hpp"
 #include "canvas_view.hpp"
+#include "image_library.hpp"
+#include "metrics_server.hpp"
+#include "minimap.hpp"
+#include "pdf_export_sink.hpp"
 #include "slide_panel.hpp"
+#include "vector_import.hpp"
 
 namespace {
 constexpr int kAnimationDurationMs = 220;
 constexpr double kEpsilon = 1e-4;
+constexpr int kMinimapWidth = 220;
+constexpr int kMinimapHeight = 150;
+constexpr int kMinimapMargin = 12;
 }
 
 CanvasWindow::CanvasWindow(QWidget* parent)
@@ -27,6 +43,8 @@ CanvasWindow::CanvasWindow(QWidget* parent)
     layout->setSpacing(0);
 
     view_ = new CanvasView(&scene_, central);
+    images_ = new ImageLibrary(this);
+    view_->setImageLibrary(images_);
     layout->addWidget(view_);
     setCentralWidget(central);
 
@@ -116,16 +134,40 @@ CanvasWindow::CanvasWindow(QWidget* parent)
         applyOverlayGeometry();
     });
 
+    minimap_ = new Minimap(&scene_, view_, central);
+    minimap_->setFixedSize(kMinimapWidth, kMinimapHeight);
+    minimap_->show();
+    connect(view_, &CanvasView::painted, minimap_, &Minimap::refresh);
+    view_->addMemorySource([this](MemoryReport& report) { minimap_->memoryUsage(report); });
+
     connect(toggleButton_, &QToolButton::clicked, this, &CanvasWindow::handlePanelToggle);
     connect(panel_, &ui::SlidePanel::modeRequested, this, &CanvasWindow::handleModeRequested);
     connect(panel_, &ui::SlidePanel::brushWidthChanged, this, &CanvasWindow::handleBrushWidthRequested);
     connect(panel_, &ui::SlidePanel::brushColorChanged, this, &CanvasWindow::handleBrushColorRequested);
+    connect(panel_, &ui::SlidePanel::brushKindChanged, this, &CanvasWindow::handleBrushKindRequested);
     connect(view_, &CanvasView::modeChanged, this, &CanvasWindow::handleViewModeChanged);
+
+    auto* exportAction = new QAction(tr("Export view..."), this);
+    exportAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_E));
+    connect(exportAction, &QAction::triggered, this, &CanvasWindow::exportView);
+    addAction(exportAction);
+
+    auto* importAction = new QAction(tr("Import vectors..."), this);
+    importAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_I));
+    connect(importAction, &QAction::triggered, this, &CanvasWindow::importVectors);
+    addAction(importAction);
+
+    auto* memoryAction = new QAction(tr("Save memory report..."), this);
+    memoryAction->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_M));
+    connect(memoryAction, &QAction::triggered, this, &CanvasWindow::saveMemoryReport);
+    addAction(memoryAction);
     connect(view_, &CanvasView::brushWidthChanged, panel_, &ui::SlidePanel::setBrushWidth);
     connect(view_, &CanvasView::brushColorChanged, panel_, &ui::SlidePanel::setBrushColor);
+    connect(view_, &CanvasView::brushKindChanged, panel_, &ui::SlidePanel::setBrushKind);
 
     panel_->setBrushWidth(view_->brushWidth());
     panel_->setBrushColor(view_->brushColor());
+    panel_->setBrushKind(view_->brushKind());
     panel_->setMode(view_->mode());
 
     panelExpanded_ = false;
@@ -136,6 +178,115 @@ CanvasWindow::CanvasWindow(QWidget* parent)
     applyOverlayGeometry();
 }
 
+void CanvasWindow::startSync(SyncLink::Role role, const QString& serverName) {
+    if (sync_) return;
+    sync_ = new SyncLink(&scene_, role, serverName, this);
+    connect(sync_, &SyncLink::sceneChanged, view_, QOverload<>::of(&QWidget::update));
+    if (role == SyncLink::Role::Publisher) connect(view_, &CanvasView::aboutToErase, sync_, &SyncLink::publishErase);
+}
+
+bool CanvasWindow::startMetrics(const QString& address, QString* error) {
+    if (metrics_) return true;
+    auto* server = new MetricsServer(this);
+    if (!server->listen(address)) {
+        if (error) *error = server->errorString();
+        delete server;
+        return false;
+    }
+    server->addSource([this](std::string& out) {
+        // Without waiting: the render thread's part is from its last count.
+        const MemoryReport report = view_->memoryReport();
+        Metrics::writeHeader(out, "cancans_scene_strokes", "gauge", "Strokes in the scene.");
+        Metrics::writeSample(out, "cancans_scene_strokes", "", static_cast<double>(scene_.strokes().size()));
+        Metrics::writeHeader(out, "cancans_scene_points", "gauge", "Stroke points in the scene.");
+        Metrics::writeSample(out, "cancans_scene_points", "", static_cast<double>(scene_.pointCount()));
+
+        Metrics::writeHeader(out, "cancans_memory_used_bytes", "gauge", "Live heap bytes by subsystem.");
+        for (const auto& [name, u] : report.entries()) {
+            Metrics::writeSample(out, "cancans_memory_used_bytes", "subsystem=\"" + Metrics::labelValue(name) + "\"",
+                                 static_cast<double>(u.usedBytes));
+        }
+        Metrics::writeHeader(out, "cancans_memory_reserved_bytes", "gauge", "Allocated heap bytes by subsystem.");
+        for (const auto& [name, u] : report.entries()) {
+            Metrics::writeSample(out, "cancans_memory_reserved_bytes",
+                                 "subsystem=\"" + Metrics::labelValue(name) + "\"", static_cast<double>(u.reservedBytes));
+        }
+
+        const std::vector<MemoryBudget::ClientUsage> caches = MemoryBudget::instance().usageByClient();
+        Metrics::writeHeader(out, "cancans_cache_bytes", "gauge", "Bytes charged to the memory budget by cache.");
+        for (const MemoryBudget::ClientUsage& c : caches) {
+            Metrics::writeSample(out, "cancans_cache_bytes", "cache=\"" + Metrics::labelValue(c.name) + "\"",
+                                 static_cast<double>(c.bytes));
+        }
+        Metrics::writeHeader(out, "cancans_cache_entries", "gauge", "Entries charged to the memory budget by cache.");
+        for (const MemoryBudget::ClientUsage& c : caches) {
+            Metrics::writeSample(out, "cancans_cache_entries", "cache=\"" + Metrics::labelValue(c.name) + "\"",
+                                 static_cast<double>(c.entries));
+        }
+        Metrics::writeHeader(out, "cancans_cache_evictions_total", "counter", "Entries the memory budget evicted.");
+        for (const MemoryBudget::ClientUsage& c : caches) {
+            Metrics::writeSample(out, "cancans_cache_evictions_total", "cache=\"" + Metrics::labelValue(c.name) + "\"",
+                                 static_cast<double>(c.evictions));
+        }
+    });
+    metrics_ = server;
+    return true;
+}
+
+void CanvasWindow::exportView() {
+    const QString path = QFileDialog::getSaveFileName(this, tr("Export view"), QString(),
+                                                      tr("SVG (*.svg);;PDF (*.pdf)"));
+    if (path.isEmpty()) return;
+    bool ok = false;
+    const double factor = QInputDialog::getDouble(this, tr("Export view"), tr("Output pixels per screen pixel:"),
+                                                  1.0, 0.125, 64.0, 3, &ok);
+    if (!ok) return;
+
+    ExportOptions options;
+    options.worldRect = view_->viewWorldRect();
+    options.zoomExp = view_->camera().zoomExp() + std::log2(factor);
+    options.backgroundRGB = static_cast<std::uint32_t>(FramePainter::backgroundColor().rgb() & 0xFFFFFF);
+    scene_.publish();
+    if (!exportBoardToFile(*scene_.snapshot(), options, path)) {
+        QMessageBox::warning(this, tr("Export view"), tr("Could not export to %1.").arg(path));
+    }
+}
+
+void CanvasWindow::importVectors() {
+    const QString path = QFileDialog::getOpenFileName(this, tr("Import vectors"), QString(),
+                                                      tr("Vector data (*.svg *.geojson *.json)"));
+    if (path.isEmpty()) return;
+
+    const QColor color = view_->brushColor();
+    const auto rgb = static_cast<std::uint32_t>(color.rgb() & 0xFFFFFF);
+    const double widthExp = std::log2(view_->brushWidth()) - view_->camera().zoomExp();
+    QString error;
+    if (importVectorFile(path, scene_, view_->viewWorldRect(), widthExp, rgb, &error) == 0) {
+        QMessageBox::warning(this, tr("Import vectors"),
+                             error.isEmpty() ? tr("No lines found in %1.").arg(path) : error);
+        return;
+    }
+    view_->update();
+}
+
+bool CanvasWindow::writeMemoryReport(const QString& path) const {
+    // Long enough for the render thread to finish a frame and count.
+    constexpr int kRenderThreadWaitMs = 500;
+    const std::string json = view_->memoryReport(kRenderThreadWaitMs).toJson();
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    return file.write(json.data(), static_cast<qint64>(json.size())) == static_cast<qint64>(json.size());
+}
+
+void CanvasWindow::saveMemoryReport() {
+    const QString path = QFileDialog::getSaveFileName(this, tr("Save memory report"), QString(),
+                                                      tr("JSON (*.json)"));
+    if (path.isEmpty()) return;
+    if (!writeMemoryReport(path)) {
+        QMessageBox::warning(this, tr("Save memory report"), tr("Could not write %1.").arg(path));
+    }
+}
+
 void CanvasWindow::resizeEvent(QResizeEvent* e) {
     QMainWindow::resizeEvent(e);
     updateOverlayLayout();
@@ -186,6 +337,11 @@ void CanvasWindow::applyOverlayGeometry() {
     panel_->raise();
     handleWidget_->raise();
     toggleButton_->raise();
+
+    if (minimap_ && centralWidget()) {
+        minimap_->move(centralWidget()->width() - minimap_->width() - kMinimapMargin, kMinimapMargin);
+        minimap_->raise();
+    }
 }
 
 void CanvasWindow::setPanelExpanded(bool expanded) {
@@ -241,3 +397,7 @@ void CanvasWindow::handleBrushColorRequested(const QColor& color) {
 void CanvasWindow::handleBrushWidthRequested(double px) {
     view_->setBrushWidth(px);
 }
+
+void CanvasWindow::handleBrushKindRequested(BrushKind kind) {
+    view_->setBrushKind(kind);
+}
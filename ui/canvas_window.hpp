@@ -3,6 +3,7 @@
 #include <QMainWindow>
 #include <QSize>
 #include "../core/scene.hpp"
+#include "sync_link.hpp"
 #include "tool_mode.hpp"
 
 class QToolButton;
@@ -10,6 +11,9 @@ class QVariantAnimation;
 class QWidget;
 
 class CanvasView;
+class ImageLibrary;
+class MetricsServer;
+class Minimap;
 
 namespace ui {
 class SlidePanel;
@@ -20,10 +24,21 @@ class CanvasWindow : public QMainWindow {
 public:
     explicit CanvasWindow(QWidget* parent = nullptr);
 
+    void startSync(SyncLink::Role role, const QString& serverName);
+    // Serves Prometheus metrics on a localhost port or a local socket; see
+    // MetricsServer. Returns false with a message if it cannot listen.
+    bool startMetrics(const QString& address, QString* error = nullptr);
+    CanvasView* view() const { return view_; }
+    // Writes the view's MemoryReport, minimap included, as JSON.
+    bool writeMemoryReport(const QString& path) const;
+
 protected:
     void resizeEvent(QResizeEvent*) override;
 
 private:
+    void exportView();
+    void importVectors();
+    void saveMemoryReport();
     void updateOverlayLayout();
     void applyOverlayGeometry();
     void setPanelExpanded(bool expanded);
@@ -32,13 +47,18 @@ private:
     void handleModeRequested(ui::Mode mode);
     void handleBrushWidthRequested(double px);
     void handleBrushColorRequested(const QColor& color);
+    void handleBrushKindRequested(BrushKind kind);
 
 private:
     Scene scene_;
     CanvasView* view_{nullptr};
+    ImageLibrary* images_{nullptr};
+    SyncLink* sync_{nullptr};
+    MetricsServer* metrics_{nullptr};
     QWidget* panelContainer_{nullptr};
     QWidget* handleWidget_{nullptr};
     ui::SlidePanel* panel_{nullptr};
+    Minimap* minimap_{nullptr};
     QToolButton* toggleButton_{nullptr};
     QVariantAnimation* panelAnimation_{nullptr};
     bool panelExpanded_ = false;
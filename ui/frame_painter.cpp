@@ -0,0 +1,348 @@
+#include "frame_painter.hpp"
+
+#include <QImage>
+#include <QPainter>
+#include <QPen>
+#include <QRegion>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "../core/stroke_list.hpp"
+#include "image_library.hpp"
+#include "painter_backend.hpp"
+
+namespace {
+// Upper bound on tiles per image per frame; only hit if level choice is off.
+constexpr int kMaxTilesPerImage = 1024;
+const QColor kImagePlaceholder(52, 56, 60);
+
+// Rounded to whole pixels, so neighbouring density tiles and path areas
+// meet without gaps or overlap.
+QRect screenRect(const Camera& cam, const Rect& area) {
+    const Vec2 a = cam.screenFromWorld(area.minX, area.minY);
+    const Vec2 b = cam.screenFromWorld(area.maxX, area.maxY);
+    return QRect(QPoint(static_cast<int>(std::lround(a.x)), static_cast<int>(std::lround(a.y))),
+                 QPoint(static_cast<int>(std::lround(b.x)) - 1, static_cast<int>(std::lround(b.y)) - 1));
+}
+}
+
+QColor colorFromRgb(std::uint32_t rgb) {
+    return QColor(
+        static_cast<int>((rgb >> 16) & 0xFF),
+        static_cast<int>((rgb >> 8) & 0xFF),
+        static_cast<int>(rgb & 0xFF)
+    );
+}
+
+std::uint32_t rgbFromQColor(const QColor& color) {
+    return (static_cast<std::uint32_t>(color.red()) << 16) |
+           (static_cast<std::uint32_t>(color.green()) << 8) |
+            static_cast<std::uint32_t>(color.blue());
+}
+
+void FramePainter::paintBackground(QPainter& p, const QSize& size, const Camera& cam) {
+    p.setRenderHint(QPainter::Antialiasing, antialias_);
+    p.fillRect(QRect(QPoint(0, 0), size), backgroundColor());
+    drawGrid(p, size, cam);
+}
+
+void FramePainter::paintScene(QPainter& p, const QSize& size, const Camera& cam,
+                              const StrokeList& strokes, const std::vector<std::size_t>& visible,
+                              const ElementStore& elements, const std::vector<std::uint32_t>& rows,
+                              const DensityFrame* density) {
+    beginScene(cam, size);
+    drawScene(p, size, cam, strokes, visible, elements, rows, density);
+}
+
+void FramePainter::beginScene(const Camera& cam, const QSize& size) {
+    clip_ = Rect(0.0, 0.0, size.width(), size.height());
+    renderer_.beginFrame(cam, clip_);
+}
+
+void FramePainter::clipScene(const QRect& part) {
+    clip_ = Rect(part.left(), part.top(), part.left() + part.width(), part.top() + part.height());
+    renderer_.clipTo(clip_);
+}
+
+void FramePainter::drawScene(QPainter& p, const QSize& size, const Camera& cam,
+                             const StrokeList& strokes, const std::vector<std::size_t>& visible,
+                             const ElementStore& elements, const std::vector<std::uint32_t>& rows,
+                             const DensityFrame* density) {
+    constexpr std::size_t kNone = std::numeric_limits<std::size_t>::max();
+    PainterBackend backend(p);
+    QRegion pathArea;
+    std::size_t clipped = 0; // visible strokes below this index are in the images
+    if (density) {
+        pathArea = drawDensity(p, cam, *density);
+        clipped = density->strokes;
+    }
+    const auto slotOf = [&](std::size_t k) { return strokes[visible[k]].drawSlot(visible[k]); };
+    std::size_t k = 0;
+    std::size_t r = 0;
+    // Alternate: strokes below the next element, then elements below the next stroke.
+    while (k < visible.size() || r < rows.size()) {
+        const std::size_t strokeLimit = r < rows.size() ? elements.z(rows[r]) : kNone;
+        std::size_t strokeEnd = k;
+        while (strokeEnd < visible.size() && slotOf(strokeEnd) < strokeLimit) ++strokeEnd;
+        if (strokeEnd > k) p.setRenderHint(QPainter::Antialiasing, antialias_);
+        // Runs of strokes inside and outside the raster; erase pieces may
+        // interleave with raster strokes in draw order.
+        while (k < strokeEnd) {
+            const bool inRaster = visible[k] < clipped;
+            std::size_t runEnd = k + 1;
+            while (runEnd < strokeEnd && (visible[runEnd] < clipped) == inRaster) ++runEnd;
+            if (inRaster) {
+                p.save();
+                p.setClipRegion(pathArea, Qt::IntersectClip);
+            }
+            drawStrokes(p, cam, strokes, visible.data() + k, visible.data() + runEnd, backend);
+            if (inRaster) p.restore();
+            k = runEnd;
+        }
+        const std::size_t nextStroke = k < visible.size() ? slotOf(k) : kNone;
+        std::size_t end = r;
+        while (end < rows.size() && elements.z(rows[end]) <= nextStroke) ++end;
+        drawElements(p, cam, size, elements, rows, r, end);
+        r = end;
+    }
+}
+
+void FramePainter::drawStrokes(QPainter& p, const Camera& cam, const StrokeList& strokes,
+                               const std::size_t* first, const std::size_t* last, PainterBackend& backend) {
+    while (first != last) {
+        const bool dabs = BrushEngine::usesDabs(strokes[*first], cam.zoomExp());
+        const std::size_t* runEnd = first + 1;
+        while (runEnd != last && BrushEngine::usesDabs(strokes[*runEnd], cam.zoomExp()) == dabs) ++runEnd;
+        if (!dabs) {
+            renderer_.draw(strokes, first, runEnd, backend);
+        } else {
+            const double dpr = p.device() ? p.device()->devicePixelRatioF() : 1.0;
+            brushLayer_.clear();
+            for (; first != runEnd; ++first) {
+                if (*first != liveStroke_) brush_.draw(strokes[*first], cam, clip_, dpr, brushLayer_);
+            }
+            drawBrushLayer(p, brushLayer_);
+        }
+        first = runEnd;
+    }
+}
+
+QRegion FramePainter::drawDensity(QPainter& p, const Camera& cam, const DensityFrame& density) {
+    const int side = density.imageSize;
+    p.save();
+    p.setRenderHint(QPainter::SmoothPixmapTransform, true);
+    for (const DensityFrame::Image& im : density.images) {
+        const QImage image(reinterpret_cast<const uchar*>(im.pixels->data()), side, side, side * 4,
+                           QImage::Format_ARGB32_Premultiplied);
+        p.drawImage(screenRect(cam, im.area), image);
+    }
+    p.restore();
+    QRegion paths;
+    for (const Rect& area : density.pathAreas) paths += screenRect(cam, area);
+    return paths;
+}
+
+void FramePainter::memoryUsage(MemoryReport& report) const {
+    renderer_.memoryUsage(report);
+    MemoryUsage brush = brushLayer_.memoryUsage();
+    brush += brush_.memoryUsage();
+    report.add("render.brush", brush);
+    text_.memoryUsage(report);
+}
+
+void FramePainter::drawGrid(QPainter& p, const QSize& size, const Camera& cam) {
+    const double targetPx = 48.0;
+    const double sc = cam.scale();
+    if (!std::isfinite(sc) || sc <= 0.0) return;
+
+    double worldStep = targetPx / sc;
+    if (!std::isfinite(worldStep) || worldStep <= 0.0) return;
+
+    const double exp10 = std::floor(std::log10(std::max(worldStep, std::numeric_limits<double>::min())));
+    const double base = std::pow(10.0, exp10);
+    const double candidates[] = {1.0, 2.0, 5.0, 10.0};
+    for (double m : candidates) {
+        if (m * base >= worldStep) { worldStep = m * base; break; }
+    }
+
+    const Vec2 tl = cam.worldFromScreen(0, 0);
+    const Vec2 br = cam.worldFromScreen(size.width(), size.height());
+
+    if (!std::isfinite(tl.x) || !std::isfinite(tl.y) ||
+        !std::isfinite(br.x) || !std::isfinite(br.y)) {
+        return;
+    }
+
+    double worldLeft = std::min(tl.x, br.x);
+    double worldRight = std::max(tl.x, br.x);
+    double worldTop = std::min(tl.y, br.y);
+    double worldBottom = std::max(tl.y, br.y);
+    const int maxLines = 500;
+
+    QPen minor(QColor(60, 62, 64));  minor.setWidthF(1.0);
+    QPen major(QColor(80, 84, 88));  major.setWidthF(1.2);
+
+    int i = 0;
+    const int limit = maxLines + 2;
+    for (double x = std::floor(worldLeft / worldStep) * worldStep; i < limit && x <= worldRight + worldStep; x += worldStep, ++i) {
+        const Vec2 sx = cam.screenFromWorld(x, 0);
+        if (!std::isfinite(sx.x)) break;
+        p.setPen((i % 5 == 0) ? major : minor);
+        p.drawLine(QPointF(sx.x, 0), QPointF(sx.x, size.height()));
+    }
+
+    int j = 0;
+    for (double y = std::floor(worldTop / worldStep) * worldStep; j < limit && y <= worldBottom + worldStep; y += worldStep, ++j) {
+        const Vec2 sy = cam.screenFromWorld(0, y);
+        if (!std::isfinite(sy.y)) break;
+        p.setPen((j % 5 == 0) ? major : minor);
+        p.drawLine(QPointF(0, sy.y), QPointF(size.width(), sy.y));
+    }
+}
+
+void FramePainter::drawElements(QPainter& p, const Camera& cam, const QSize& size, const ElementStore& elements,
+                                const std::vector<std::uint32_t>& rows, std::size_t begin, std::size_t end) {
+    while (begin < end) {
+        const ElementKind kind = elements.kind(rows[begin]);
+        std::size_t runEnd = begin + 1;
+        while (runEnd < end && elements.kind(rows[runEnd]) == kind) ++runEnd;
+        switch (kind) {
+        case ElementKind::Shape: drawShapes(p, cam, size, elements, rows, begin, runEnd); break;
+        case ElementKind::Image: drawImages(p, cam, size, elements, rows, begin, runEnd); break;
+        case ElementKind::Text: text_.draw(p, cam, size, elements, rows, begin, runEnd); break;
+        }
+        begin = runEnd;
+    }
+}
+
+void FramePainter::drawShapes(QPainter& p, const Camera& cam, const QSize& size, const ElementStore& elements,
+                              const std::vector<std::uint32_t>& rows, std::size_t begin, std::size_t end) {
+    const auto& shapes = elements.shapes();
+    const ElementStyle* current = nullptr;
+    double penPx = 0.0;
+    QRectF clip;
+    for (std::size_t i = begin; i < end; ++i) {
+        const std::uint32_t row = rows[i];
+        const ElementStyle& style = elements.style(row);
+        if (&style != current) {
+            current = &style;
+            penPx = std::exp2(style.strokeWidthExp + cam.zoomExp());
+            if (penPx >= StrokeBatcher::kMinWidthPx) {
+                QPen pen(colorFromRgb(style.strokeRGB));
+                pen.setWidthF(std::min(penPx, StrokeBatcher::kMaxWidthPx));
+                pen.setJoinStyle(Qt::RoundJoin);
+                pen.setCapStyle(Qt::RoundCap);
+                p.setPen(pen);
+            } else {
+                p.setPen(Qt::NoPen);
+            }
+            p.setBrush(style.filled ? QBrush(colorFromRgb(style.fillRGB)) : QBrush(Qt::NoBrush));
+            // Huge rectangles are cut down to the view so QPainter stays in range.
+            const double margin = penPx + 1.0;
+            clip = QRectF(-margin, -margin, size.width() + 2.0 * margin, size.height() + 2.0 * margin);
+        }
+
+        const Shape& shape = shapes[elements.slot(row)];
+        const Vec2 a = cam.screenFromWorld(shape.pos.x, shape.pos.y);
+        const Vec2 b = cam.screenFromWorld(shape.pos.x + shape.size.x, shape.pos.y + shape.size.y);
+        switch (shape.kind) {
+        case Shape::Kind::Rect:
+            p.drawRect(QRectF(QPointF(a.x, a.y), QPointF(b.x, b.y)).normalized().intersected(clip));
+            break;
+        case Shape::Kind::Ellipse:
+            p.drawEllipse(QRectF(QPointF(a.x, a.y), QPointF(b.x, b.y)).normalized());
+            break;
+        case Shape::Kind::Line:
+            p.drawLine(QPointF(a.x, a.y), QPointF(b.x, b.y));
+            break;
+        }
+    }
+}
+
+void FramePainter::drawImages(QPainter& p, const Camera& cam, const QSize& size, const ElementStore& elements,
+                              const std::vector<std::uint32_t>& rows, std::size_t begin, std::size_t end) {
+    const auto& images = elements.images();
+    const QRectF view(QPointF(0.0, 0.0), QSizeF(size));
+    const double dpr = p.device() ? p.device()->devicePixelRatioF() : 1.0;
+    p.setRenderHint(QPainter::SmoothPixmapTransform, true);
+
+    for (std::size_t i = begin; i < end; ++i) {
+        const ImageElement& im = images[elements.slot(rows[i])];
+        const Vec2 a = cam.screenFromWorld(im.pos.x, im.pos.y);
+        const Vec2 b = cam.screenFromWorld(im.pos.x + im.size.x, im.pos.y + im.size.y);
+        const QRectF target = QRectF(QPointF(a.x, a.y), QPointF(b.x, b.y)).normalized();
+        const QRectF visible = target.intersected(view);
+        if (visible.isEmpty()) continue;
+
+        if (!images_ || !images_->isReady(im.imageId)) {
+            p.fillRect(visible, kImagePlaceholder);
+            continue;
+        }
+        const TilePyramid pyr = images_->pyramid(im.imageId);
+        const int level = pyr.levelFor(pyr.width / (target.width() * dpr));
+        const int tile = pyr.tileSize;
+        // Level pixels per screen pixel, on each axis.
+        const double sx = pyr.levelWidth(level) / target.width();
+        const double sy = pyr.levelHeight(level) / target.height();
+        const int tx0 = std::max(0, static_cast<int>((visible.left() - target.left()) * sx) / tile);
+        const int ty0 = std::max(0, static_cast<int>((visible.top() - target.top()) * sy) / tile);
+        const int tx1 = std::min(pyr.tilesX(level) - 1, static_cast<int>((visible.right() - target.left()) * sx) / tile);
+        const int ty1 = std::min(pyr.tilesY(level) - 1, static_cast<int>((visible.bottom() - target.top()) * sy) / tile);
+        if ((tx1 - tx0 + 1) * (ty1 - ty0 + 1) > kMaxTilesPerImage) {
+            p.fillRect(visible, kImagePlaceholder);
+            continue;
+        }
+
+        for (int ty = ty0; ty <= ty1; ++ty) {
+            for (int tx = tx0; tx <= tx1; ++tx) {
+                // Tile rectangle in level pixels, then on screen.
+                const QRectF px(tx * tile, ty * tile,
+                                std::min(tile, pyr.levelWidth(level) - tx * tile),
+                                std::min(tile, pyr.levelHeight(level) - ty * tile));
+                const QRectF dest(target.left() + px.left() / sx, target.top() + px.top() / sy,
+                                  px.width() / sx, px.height() / sy);
+                const QImage t = images_->tile(im.imageId, level, tx, ty);
+                if (!t.isNull()) {
+                    p.drawImage(dest, t);
+                    continue;
+                }
+                // Not paged in yet: stretch the part of a coarser tile we still have.
+                bool drawn = false;
+                for (int up = level + 1; up < pyr.levels && !drawn; ++up) {
+                    const int shift = up - level;
+                    const int ctx = (tx * tile >> shift) / tile;
+                    const int cty = (ty * tile >> shift) / tile;
+                    const QImage coarse = images_->cachedTile(im.imageId, up, ctx, cty);
+                    if (coarse.isNull()) continue;
+                    const double f = 1.0 / (1 << shift);
+                    const QRectF src(px.left() * f - ctx * tile, px.top() * f - cty * tile, px.width() * f, px.height() * f);
+                    p.drawImage(dest, coarse, src);
+                    drawn = true;
+                }
+                if (!drawn) {
+                    p.fillRect(dest, kImagePlaceholder);
+                    // Keep the coarsest level resident so later misses have a fallback.
+                    images_->tile(im.imageId, pyr.levels - 1, 0, 0);
+                }
+            }
+        }
+    }
+}
+
+void FramePainter::drawBatch(QPainter& p, const StrokeBatch& b) {
+    PainterBackend backend(p);
+    replayBatch(backend, b);
+}
+
+void FramePainter::drawBrushLayer(QPainter& p, const BrushLayer& layer) {
+    constexpr int kTile = BrushLayer::kTileSize;
+    const double ratio = layer.pixelRatio();
+    for (std::size_t i = 0; i < layer.tileCount(); ++i) {
+        const BrushLayer::Tile& t = layer.tile(i);
+        QImage image(reinterpret_cast<const uchar*>(t.pixels.data()), kTile, kTile,
+                     kTile * 4, QImage::Format_ARGB32_Premultiplied);
+        image.setDevicePixelRatio(ratio);
+        p.drawImage(QPointF(t.tx * kTile / ratio, t.ty * kTile / ratio), image);
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <QColor>
+#include <QSize>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+#include "../core/camera.hpp"
+#include "../core/element_store.hpp"
+#include "../render/brush_engine.hpp"
+#include "../render/density_raster.hpp"
+#include "../render/renderer.hpp"
+#include "../render/stroke_batcher.hpp"
+#include "text_renderer.hpp"
+
+class ImageLibrary;
+class PainterBackend;
+class QPainter;
+class QRegion;
+class StrokeList;
+
+// Paints the board (background, grid, strokes) for a camera and a list of
+// visible strokes. It owns no widget state, so the same code serves the GUI
+// thread and the render thread. Strokes go through a retained Renderer and
+// reach the QPainter through a PainterBackend; brush strokes are stamped into
+// a BrushLayer.
+class FramePainter {
+public:
+    static QColor backgroundColor() { return QColor(24, 26, 27); }
+
+    // Source of image tiles; without one, images draw as placeholders.
+    void setImageLibrary(ImageLibrary* images) { images_ = images; }
+    // Off for cheap frames while the view is moving.
+    void setAntialiasing(bool on) { antialias_ = on; }
+    // A stroke the caller stamps itself as it grows; paintScene skips it.
+    void setLiveStroke(std::size_t index) { liveStroke_ = index; }
+
+    void paintBackground(QPainter& p, const QSize& size, const Camera& cam);
+    // Visible strokes (scene indices, draw order) and element rows (draw
+    // order), interleaved by element z.
+    // Strokes may be the live scene's or a snapshot's; painting never
+    // changes their storage tier. With a density frame its images go under
+    // everything and the strokes it holds are clipped to its path areas.
+    void paintScene(QPainter& p, const QSize& size, const Camera& cam,
+                    const StrokeList& strokes, const std::vector<std::size_t>& visible,
+                    const ElementStore& elements, const std::vector<std::uint32_t>& rows,
+                    const DensityFrame* density = nullptr);
+    // paintScene in parts: beginScene once per frame, then clipScene and
+    // drawScene for each part with the painter clipped to it. Strokes are
+    // cut to the part before they are rasterized.
+    void beginScene(const Camera& cam, const QSize& size);
+    void clipScene(const QRect& part);
+    void drawScene(QPainter& p, const QSize& size, const Camera& cam,
+                   const StrokeList& strokes, const std::vector<std::size_t>& visible,
+                   const ElementStore& elements, const std::vector<std::uint32_t>& rows,
+                   const DensityFrame* density = nullptr);
+
+    // Caches kept between frames: the retained renderer, the brush layer
+    // ("render.brush") and text layouts and glyphs.
+    void memoryUsage(MemoryReport& report) const;
+
+    static void drawGrid(QPainter& p, const QSize& size, const Camera& cam);
+    // One pen and one path for the whole batch; also used by the PDF export.
+    static void drawBatch(QPainter& p, const StrokeBatch& b);
+    static void drawBrushLayer(QPainter& p, const BrushLayer& layer);
+    // Images of a density frame; returns the path areas on screen.
+    static QRegion drawDensity(QPainter& p, const Camera& cam, const DensityFrame& density);
+
+private:
+    // Draws rows[begin, end) as runs of one kind each.
+    void drawElements(QPainter& p, const Camera& cam, const QSize& size, const ElementStore& elements,
+                      const std::vector<std::uint32_t>& rows, std::size_t begin, std::size_t end);
+    void drawImages(QPainter& p, const Camera& cam, const QSize& size, const ElementStore& elements,
+                    const std::vector<std::uint32_t>& rows, std::size_t begin, std::size_t end);
+    static void drawShapes(QPainter& p, const Camera& cam, const QSize& size, const ElementStore& elements,
+                           const std::vector<std::uint32_t>& rows, std::size_t begin, std::size_t end);
+    // Draws strokes[*first .. *last) inside clip_, pen runs retained and
+    // brush runs stamped.
+    void drawStrokes(QPainter& p, const Camera& cam, const StrokeList& strokes,
+                     const std::size_t* first, const std::size_t* last, PainterBackend& backend);
+
+private:
+    Renderer renderer_; // retained per painter, so per thread
+    BrushLayer brushLayer_;
+    BrushEngine brush_;
+    std::size_t liveStroke_ = std::numeric_limits<std::size_t>::max();
+    ImageLibrary* images_ = nullptr;
+    Rect clip_;         // screen pixels strokes are cut to
+    TextRenderer text_;
+    bool antialias_ = true;
+};
+
+QColor colorFromRgb(std::uint32_t rgb);
+std::uint32_t rgbFromQColor(const QColor& color);
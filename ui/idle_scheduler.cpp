@@ -0,0 +1,152 @@
+#include "idle_scheduler.hpp"
+
+#include <QMetaObject>
+#include <QRunnable>
+#include <algorithm>
+#include <thread>
+
+namespace {
+constexpr std::chrono::milliseconds kTick{4};
+constexpr std::chrono::milliseconds kQuiet{250};
+// A GUI slice must stay well under a frame; workers can take longer.
+constexpr std::chrono::milliseconds kGuiSlice{3};
+constexpr std::chrono::milliseconds kWorkerSlice{20};
+}
+
+bool IdleScheduler::Token::shouldYield() const {
+    return preempted_->load(std::memory_order_relaxed) || cancelled_->load(std::memory_order_relaxed) ||
+           std::chrono::steady_clock::now() >= deadline_;
+}
+
+IdleScheduler::IdleScheduler(QObject* parent)
+    : QObject(parent) {
+    // Leave a core for the GUI and render threads.
+    pool_.setMaxThreadCount(std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 2));
+    timer_.setInterval(kTick);
+    connect(&timer_, &QTimer::timeout, this, &IdleScheduler::tick);
+}
+
+IdleScheduler::~IdleScheduler() {
+    preempted_ = true;
+    for (Job& job : jobs_) *job.cancelled = true;
+    pool_.waitForDone();
+}
+
+IdleScheduler::JobId IdleScheduler::post(const char* name, Priority priority, Step step) {
+    return enqueue(name, priority, false, std::move(step));
+}
+
+IdleScheduler::JobId IdleScheduler::postWorker(const char* name, Priority priority, Step step) {
+    return enqueue(name, priority, true, std::move(step));
+}
+
+IdleScheduler::JobId IdleScheduler::enqueue(const char* name, Priority priority, bool worker, Step step) {
+    Job job;
+    job.id = nextId_++;
+    job.name = name;
+    job.priority = priority;
+    job.worker = worker;
+    job.order = nextOrder_++;
+    job.step = std::move(step);
+    job.cancelled = std::make_shared<std::atomic<bool>>(false);
+    jobs_.push_back(std::move(job));
+    if (!timer_.isActive()) timer_.start();
+    return jobs_.back().id;
+}
+
+void IdleScheduler::cancel(JobId id) {
+    const auto it = std::find_if(jobs_.begin(), jobs_.end(), [id](const Job& j) { return j.id == id; });
+    if (it == jobs_.end()) return;
+    *it->cancelled = true;
+    // A running worker still owns its step; it is dropped when it reports back.
+    if (!it->running) jobs_.erase(it);
+}
+
+void IdleScheduler::cancelAll() {
+    for (Job& job : jobs_) *job.cancelled = true;
+    std::erase_if(jobs_, [](const Job& j) { return !j.running; });
+}
+
+bool IdleScheduler::isQueued(JobId id) const {
+    return std::any_of(jobs_.begin(), jobs_.end(), [id](const Job& j) { return j.id == id && !*j.cancelled; });
+}
+
+void IdleScheduler::preempt() {
+    preempted_.store(true, std::memory_order_relaxed);
+    lastInput_ = std::chrono::steady_clock::now();
+}
+
+bool IdleScheduler::idle() const {
+    if (std::chrono::steady_clock::now() - lastInput_ < kQuiet) return false;
+    return !busy_ || !busy_();
+}
+
+IdleScheduler::Token IdleScheduler::makeToken(const Job& job, std::chrono::milliseconds slice) const {
+    Token token;
+    token.deadline_ = std::chrono::steady_clock::now() + slice;
+    token.preempted_ = &preempted_;
+    token.cancelled_ = job.cancelled.get();
+    return token;
+}
+
+std::vector<IdleScheduler::Job>::iterator IdleScheduler::next(bool worker) {
+    auto best = jobs_.end();
+    for (auto it = jobs_.begin(); it != jobs_.end(); ++it) {
+        if (it->worker != worker || it->running) continue;
+        if (best == jobs_.end() || std::pair(it->priority, it->order) < std::pair(best->priority, best->order)) best = it;
+    }
+    return best;
+}
+
+void IdleScheduler::tick() {
+    if (jobs_.empty()) {
+        timer_.stop();
+        return;
+    }
+    if (!idle()) return;
+    preempted_.store(false, std::memory_order_relaxed);
+
+    // Workers: fill the pool, most important first.
+    while (workersRunning_ < pool_.maxThreadCount()) {
+        const auto it = next(true);
+        if (it == jobs_.end()) break;
+        startWorker(*it);
+    }
+
+    // One GUI slice per tick so the event loop keeps turning.
+    const auto it = next(false);
+    if (it == jobs_.end()) return;
+    const JobId id = it->id;
+    Step step = it->step; // the step may post or cancel jobs
+    const bool done = step(makeToken(*it, kGuiSlice));
+    const auto job = std::find_if(jobs_.begin(), jobs_.end(), [id](const Job& j) { return j.id == id; });
+    if (job == jobs_.end()) return;
+    if (done || *job->cancelled) {
+        jobs_.erase(job);
+    } else {
+        job->order = nextOrder_++;
+    }
+}
+
+void IdleScheduler::startWorker(Job& job) {
+    job.running = true;
+    ++workersRunning_;
+    const JobId id = job.id;
+    const Token token = makeToken(job, kWorkerSlice);
+    pool_.start(QRunnable::create([this, id, token, step = job.step, keep = job.cancelled]() {
+        const bool done = step(token);
+        QMetaObject::invokeMethod(this, [this, id, done]() { workerFinished(id, done); }, Qt::QueuedConnection);
+    }));
+}
+
+void IdleScheduler::workerFinished(JobId id, bool done) {
+    --workersRunning_;
+    const auto it = std::find_if(jobs_.begin(), jobs_.end(), [id](const Job& j) { return j.id == id; });
+    if (it == jobs_.end()) return;
+    it->running = false;
+    if (done || *it->cancelled) {
+        jobs_.erase(it);
+    } else {
+        it->order = nextOrder_++;
+    }
+}
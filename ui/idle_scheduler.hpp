@@ -0,0 +1,84 @@
+#pragma once
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Runs derived-data work that nothing waits on (LOD levels, index
+// rebuilds, tile prefetch, cold-stroke compression) while the canvas is
+// idle: only after input has been quiet for a moment and the view reports
+// no frame work, highest priority first. Jobs are cooperative: each call
+// does a small piece of work, checks its token and returns true once the
+// job is complete. GUI jobs run on the event loop and may touch the scene;
+// worker jobs run on a pool and must stay on thread-safe state. Input
+// preempts both immediately through the token.
+class IdleScheduler : public QObject {
+    Q_OBJECT
+public:
+    enum class Priority { High = 0, Normal = 1, Low = 2 };
+    using JobId = std::uint64_t;
+
+    class Token {
+    public:
+        // Out of time, input arrived or the job was cancelled.
+        bool shouldYield() const;
+        bool cancelled() const { return cancelled_->load(std::memory_order_relaxed); }
+
+    private:
+        friend class IdleScheduler;
+        std::chrono::steady_clock::time_point deadline_;
+        const std::atomic<bool>* preempted_ = nullptr;
+        const std::atomic<bool>* cancelled_ = nullptr;
+    };
+    using Step = std::function<bool(const Token&)>;
+
+    explicit IdleScheduler(QObject* parent = nullptr);
+    ~IdleScheduler() override;
+
+    JobId post(const char* name, Priority priority, Step step);
+    JobId postWorker(const char* name, Priority priority, Step step);
+    void cancel(JobId id);
+    void cancelAll();
+    bool isQueued(JobId id) const;
+
+    // Input arrived: running jobs yield now and nothing starts until the
+    // input has been quiet again.
+    void preempt();
+    // Polled before every slice; true while frames are being produced.
+    void setBusyCheck(std::function<bool()> busy) { busy_ = std::move(busy); }
+
+private:
+    struct Job {
+        JobId id = 0;
+        const char* name = "";
+        Priority priority = Priority::Normal;
+        bool worker = false;
+        bool running = false;
+        std::uint64_t order = 0; // round robin within a priority
+        Step step;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+    };
+
+    JobId enqueue(const char* name, Priority priority, bool worker, Step step);
+    void tick();
+    bool idle() const;
+    Token makeToken(const Job& job, std::chrono::milliseconds slice) const;
+    void startWorker(Job& job);
+    void workerFinished(JobId id, bool done);
+    std::vector<Job>::iterator next(bool worker);
+
+    std::vector<Job> jobs_;
+    JobId nextId_ = 1;
+    std::uint64_t nextOrder_ = 0;
+    QTimer timer_;
+    QThreadPool pool_;
+    int workersRunning_ = 0;
+    std::atomic<bool> preempted_{false};
+    std::chrono::steady_clock::time_point lastInput_;
+    std::function<bool()> busy_;
+};
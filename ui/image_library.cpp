@@ -0,0 +1,257 @@
+#include "image_library.hpp"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+
+#include "../core/metrics.hpp"
+
+namespace {
+constexpr int kManifestVersion = 1;
+// Decode limit for sources, in MiB: an 8-bit RGBA image of about 23k px
+// square. Qt's default of 256 MiB refuses large scans.
+constexpr int kDecodeLimitMiB = 2048;
+
+QString manifestPath(const QString& dir) {
+    return dir + QStringLiteral("/manifest.json");
+}
+
+// A finished pyramid for this exact file, if an earlier run built one.
+bool readManifest(const QString& dir, const TilePyramid& expected) {
+    QFile f(manifestPath(dir));
+    if (!f.open(QIODevice::ReadOnly)) return false;
+    const QJsonObject m = QJsonDocument::fromJson(f.readAll()).object();
+    return m.value(QStringLiteral("version")).toInt() == kManifestVersion &&
+           m.value(QStringLiteral("width")).toInt() == expected.width &&
+           m.value(QStringLiteral("height")).toInt() == expected.height &&
+           m.value(QStringLiteral("tileSize")).toInt() == expected.tileSize &&
+           m.value(QStringLiteral("levels")).toInt() == expected.levels;
+}
+
+bool writeManifest(const QString& dir, const TilePyramid& pyramid) {
+    QJsonObject m;
+    m.insert(QStringLiteral("version"), kManifestVersion);
+    m.insert(QStringLiteral("width"), pyramid.width);
+    m.insert(QStringLiteral("height"), pyramid.height);
+    m.insert(QStringLiteral("tileSize"), pyramid.tileSize);
+    m.insert(QStringLiteral("levels"), pyramid.levels);
+    QSaveFile f(manifestPath(dir));
+    if (!f.open(QIODevice::WriteOnly)) return false;
+    f.write(QJsonDocument(m).toJson(QJsonDocument::Compact));
+    return f.commit();
+}
+}
+
+ImageLibrary::ImageLibrary(QObject* parent)
+    : QObject(parent) {
+    // The limit is process-wide, so it is raised once here, before any
+    // worker decodes, rather than per image.
+    if (QImageReader::allocationLimit() != 0 && QImageReader::allocationLimit() < kDecodeLimitMiB) {
+        QImageReader::setAllocationLimit(kDecodeLimitMiB);
+    }
+    pool_.setMaxThreadCount(std::max(1, QThread::idealThreadCount() / 2));
+    budgetClient_ = MemoryBudget::instance().registerClient("image.tiles", [this](MemoryBudget::Key key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tiles_.erase(key);
+    });
+}
+
+ImageLibrary::~ImageLibrary() {
+    pool_.clear();
+    pool_.waitForDone();
+    MemoryBudget::instance().unregisterClient(budgetClient_);
+}
+
+std::uint64_t ImageLibrary::addFile(const QString& path, QSize* pixelSize) {
+    QImageReader reader(path);
+    reader.setAutoTransform(true);
+    QSize size = reader.size();
+    if (!size.isValid()) return 0;
+    if (reader.transformation() & QImageIOHandler::TransformationRotate90) size.transpose();
+    if (pixelSize) *pixelSize = size;
+
+    const QFileInfo info(path);
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(info.absoluteFilePath().toUtf8());
+    hash.addData(QByteArray::number(info.size()));
+    hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+                        QStringLiteral("/tiles/") + QString::fromLatin1(hash.result().toHex().left(16));
+
+    Entry entry;
+    entry.source = info.absoluteFilePath();
+    entry.dir = dir;
+    entry.pyramid = TilePyramid(size.width(), size.height());
+    entry.ready = readManifest(dir, entry.pyramid);
+
+    std::uint64_t id = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        id = nextId_++;
+        entries_.emplace(id, entry);
+    }
+    if (!entry.ready) {
+        pool_.start(QRunnable::create([this, id, entry]() { build(id, entry.source, entry.dir, entry.pyramid); }));
+    }
+    return id;
+}
+
+QString ImageLibrary::errorString(std::uint64_t id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto found = entries_.find(id);
+    return found != entries_.end() ? found->second.error : QString();
+}
+
+bool ImageLibrary::isReady(std::uint64_t id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto found = entries_.find(id);
+    return found != entries_.end() && found->second.ready;
+}
+
+TilePyramid ImageLibrary::pyramid(std::uint64_t id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto found = entries_.find(id);
+    return found != entries_.end() ? found->second.pyramid : TilePyramid{};
+}
+
+MemoryUsage ImageLibrary::memoryUsage() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    MemoryUsage u;
+    u.addMap(entries_);
+    for (const auto& [id, e] : entries_) {
+        for (const QString* s : {&e.source, &e.dir, &e.error}) {
+            const auto bytes = static_cast<std::size_t>(s->size()) * sizeof(QChar);
+            if (bytes > 0) u.addBlock(bytes, static_cast<std::size_t>(s->capacity()) * sizeof(QChar));
+        }
+    }
+    u.addMap(tiles_);
+    for (const auto& [key, image] : tiles_) {
+        const auto bytes = static_cast<std::size_t>(image.sizeInBytes());
+        if (bytes > 0) u.addBlock(bytes, bytes);
+    }
+    u.addSet(loading_);
+    return u;
+}
+
+QImage ImageLibrary::tile(std::uint64_t id, int level, int tx, int ty) {
+    const TileKey key = tileKey(id, level, tx, ty);
+    QImage image;
+    QString path;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto found = tiles_.find(key);
+        Metrics::add(found != tiles_.end() ? Metrics::Counter::ImageTileHits : Metrics::Counter::ImageTileMisses);
+        if (found != tiles_.end()) {
+            image = found->second;
+        } else {
+            const auto entry = entries_.find(id);
+            if (entry == entries_.end() || !entry->second.ready || !loading_.insert(key).second) return QImage();
+            path = tilePath(entry->second.dir, level, tx, ty);
+        }
+    }
+    if (!image.isNull()) {
+        // Outside our lock: touching never evicts, but keep one lock order anyway.
+        MemoryBudget::instance().touch(budgetClient_, key);
+        return image;
+    }
+    pool_.start(QRunnable::create([this, key, path]() { load(key, path); }));
+    return QImage();
+}
+
+QImage ImageLibrary::cachedTile(std::uint64_t id, int level, int tx, int ty) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto found = tiles_.find(tileKey(id, level, tx, ty));
+    return found != tiles_.end() ? found->second : QImage();
+}
+
+ImageLibrary::TileKey ImageLibrary::tileKey(std::uint64_t id, int level, int tx, int ty) {
+    // 24 bits of id, 6 of level, 17 per tile coordinate.
+    return (id << 40) | (static_cast<TileKey>(level) << 34) |
+           (static_cast<TileKey>(ty) << 17) | static_cast<TileKey>(tx);
+}
+
+QString ImageLibrary::tilePath(const QString& dir, int level, int tx, int ty) {
+    return QStringLiteral("%1/%2/%3_%4.png").arg(dir).arg(level).arg(ty).arg(tx);
+}
+
+void ImageLibrary::build(std::uint64_t id, QString source, QString dir, TilePyramid pyramid) {
+    const QString error = buildPyramid(source, dir, pyramid);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto found = entries_.find(id);
+        if (found != entries_.end()) {
+            found->second.ready = error.isEmpty();
+            found->second.error = error;
+        }
+    }
+    if (!error.isEmpty()) {
+        qWarning("cannot tile image %s: %s", qPrintable(source), qPrintable(error));
+        return;
+    }
+    emit changed();
+}
+
+QString ImageLibrary::buildPyramid(const QString& source, const QString& dir, const TilePyramid& pyramid) {
+    QImageReader reader(source);
+    reader.setAutoTransform(true);
+    QImage level = reader.read();
+    if (level.isNull()) return reader.errorString();
+    level = level.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    const int tile = pyramid.tileSize;
+    for (int l = 0; l < pyramid.levels; ++l) {
+        if (l > 0) {
+            level = level.scaled(pyramid.levelWidth(l), pyramid.levelHeight(l),
+                                 Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        }
+        const QString levelDir = QStringLiteral("%1/%2").arg(dir).arg(l);
+        if (!QDir().mkpath(levelDir)) return QStringLiteral("cannot create %1").arg(levelDir);
+        for (int ty = 0; ty < pyramid.tilesY(l); ++ty) {
+            for (int tx = 0; tx < pyramid.tilesX(l); ++tx) {
+                const QRect rect = QRect(tx * tile, ty * tile, tile, tile).intersected(level.rect());
+                const QString path = tilePath(dir, l, tx, ty);
+                if (!level.copy(rect).save(path)) return QStringLiteral("cannot write %1").arg(path);
+            }
+        }
+    }
+    if (!writeManifest(dir, pyramid)) return QStringLiteral("cannot write %1").arg(manifestPath(dir));
+    return QString();
+}
+
+void ImageLibrary::prefetch(std::uint64_t id, int level, int tx, int ty) {
+    const TileKey key = tileKey(id, level, tx, ty);
+    QString path;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tiles_.count(key)) return;
+        const auto entry = entries_.find(id);
+        if (entry == entries_.end() || !entry->second.ready || !loading_.insert(key).second) return;
+        path = tilePath(entry->second.dir, level, tx, ty);
+    }
+    decode(key, path);
+}
+
+void ImageLibrary::load(TileKey key, QString path) {
+    if (decode(key, path)) emit changed();
+}
+
+bool ImageLibrary::decode(TileKey key, const QString& path) {
+    QImage image(path);
+    if (!image.isNull()) image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        loading_.erase(key);
+        if (image.isNull()) return false;
+        tiles_[key] = image;
+    }
+    MemoryBudget::instance().charge(budgetClient_, key, static_cast<std::size_t>(image.sizeInBytes()));
+    return true;
+}
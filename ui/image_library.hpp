@@ -0,0 +1,76 @@
+#pragma once
+#include <QImage>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include "../core/memory_budget.hpp"
+#include "../core/memory_usage.hpp"
+#include "../render/tile_pyramid.hpp"
+
+// Pixels of image elements. Each source file is cut once, in the
+// background, into a tiled mip pyramid of PNG files under the cache
+// directory; a later session with the same file reuses it. Painting pages
+// in only the tiles it asks for, loading them on a worker thread; decoded
+// tiles are charged to the MemoryBudget and evicted least recently used.
+//
+// Lookups are thread-safe, so the render thread can paint images too.
+class ImageLibrary : public QObject {
+    Q_OBJECT
+public:
+    explicit ImageLibrary(QObject* parent = nullptr);
+    ~ImageLibrary() override;
+
+    // Returns an id for the file (0 if it is not a readable image) and
+    // starts building its pyramid unless a finished one is on disk.
+    std::uint64_t addFile(const QString& path, QSize* pixelSize = nullptr);
+
+    bool isReady(std::uint64_t id) const;
+    // Why building the pyramid failed; empty while it builds or once ready.
+    QString errorString(std::uint64_t id) const;
+    TilePyramid pyramid(std::uint64_t id) const;
+    // The decoded tile, or a null image after queueing a background load.
+    QImage tile(std::uint64_t id, int level, int tx, int ty);
+    // Same, but never queues a load; for fallbacks from coarser levels.
+    QImage cachedTile(std::uint64_t id, int level, int tx, int ty);
+    // Decodes a tile on the calling thread unless it is resident or already
+    // loading; for idle-time prefetch. Does not signal changed().
+    void prefetch(std::uint64_t id, int level, int tx, int ty);
+    // Decoded tiles and the bookkeeping around them.
+    MemoryUsage memoryUsage() const;
+
+signals:
+    // A pyramid finished building or requested tiles arrived.
+    void changed();
+
+private:
+    struct Entry {
+        QString source;
+        QString dir;
+        TilePyramid pyramid;
+        bool ready = false;
+        QString error;
+    };
+    using TileKey = MemoryBudget::Key;
+
+    static TileKey tileKey(std::uint64_t id, int level, int tx, int ty);
+    static QString tilePath(const QString& dir, int level, int tx, int ty);
+    void build(std::uint64_t id, QString source, QString dir, TilePyramid pyramid);
+    // Returns an error message, or an empty string once the pyramid is on disk.
+    static QString buildPyramid(const QString& source, const QString& dir, const TilePyramid& pyramid);
+    void load(TileKey key, QString path);
+    bool decode(TileKey key, const QString& path);
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::uint64_t, Entry> entries_;
+    std::unordered_map<TileKey, QImage> tiles_;
+    std::unordered_set<TileKey> loading_;
+    std::uint64_t nextId_ = 1;
+
+    MemoryBudget::ClientId budgetClient_ = 0;
+    QThreadPool pool_;
+};
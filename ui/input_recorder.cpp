@@ -0,0 +1,119 @@
+#include "input_recorder.hpp"
+
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QResizeEvent>
+#include <QWheelEvent>
+
+#include "../core/scene.hpp"
+#include "canvas_view.hpp"
+#include "frame_painter.hpp"
+
+namespace {
+constexpr qsizetype kFlushBytes = 64 * 1024;
+}
+
+InputRecorder::InputRecorder(const QString& path)
+    : file_(path) {}
+
+InputRecorder::~InputRecorder() {
+    flush();
+}
+
+bool InputRecorder::start(const CanvasView& view, const Scene& scene) {
+    if (!file_.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+    InputLogHeader h;
+    h.width = view.width();
+    h.height = view.height();
+    h.zoomExp = view.camera().zoomExp();
+    h.offsetPx = view.camera().offsetPx();
+    h.worldCenter = view.camera().worldCenter();
+    h.mode = static_cast<int>(view.mode());
+    h.brushPx = view.brushWidth();
+    h.brushColorRGB = rgbFromQColor(view.brushColor());
+    h.brushKind = static_cast<std::uint32_t>(view.brushKind());
+    writer_.begin(h, scene);
+    clock_.start();
+    started_ = true;
+    flush();
+    return true;
+}
+
+void InputRecorder::record(const QEvent* e) {
+    if (!started_) return;
+
+    using T = InputRecord::Type;
+    InputRecord r;
+    switch (e->type()) {
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    case QEvent::MouseMove: {
+        const auto* me = static_cast<const QMouseEvent*>(e);
+        r.type = e->type() == QEvent::MouseButtonPress ? T::MousePress
+               : e->type() == QEvent::MouseButtonRelease ? T::MouseRelease
+               : T::MouseMove;
+        r.pos = {me->position().x(), me->position().y()};
+        r.button = static_cast<std::uint32_t>(me->button());
+        r.buttons = static_cast<std::uint32_t>(me->buttons().toInt());
+        r.modifiers = static_cast<std::uint32_t>(me->modifiers().toInt());
+        break;
+    }
+    case QEvent::Wheel: {
+        const auto* we = static_cast<const QWheelEvent*>(e);
+        r.type = T::Wheel;
+        r.pos = {we->position().x(), we->position().y()};
+        r.buttons = static_cast<std::uint32_t>(we->buttons().toInt());
+        r.modifiers = static_cast<std::uint32_t>(we->modifiers().toInt());
+        r.wheelDelta = we->angleDelta().y();
+        break;
+    }
+    case QEvent::KeyPress:
+    case QEvent::KeyRelease: {
+        const auto* ke = static_cast<const QKeyEvent*>(e);
+        r.type = e->type() == QEvent::KeyPress ? T::KeyPress : T::KeyRelease;
+        r.key = static_cast<std::uint32_t>(ke->key());
+        r.modifiers = static_cast<std::uint32_t>(ke->modifiers().toInt());
+        break;
+    }
+    case QEvent::Resize: {
+        const auto* re = static_cast<const QResizeEvent*>(e);
+        r.type = T::Resize;
+        r.width = re->size().width();
+        r.height = re->size().height();
+        break;
+    }
+    case QEvent::Paint:
+        r.type = T::Paint;
+        break;
+    default:
+        return;
+    }
+    r.timeNs = clock_.nsecsElapsed();
+    writer_.append(r);
+    // One write per frame keeps the file current without a syscall per move.
+    if (r.type == T::Paint || writer_.pendingBytes() >= static_cast<std::size_t>(kFlushBytes)) flush();
+}
+
+void InputRecorder::recordView(const CanvasView& view) {
+    if (!started_) return;
+    InputRecord r;
+    r.type = InputRecord::Type::ViewState;
+    r.timeNs = clock_.nsecsElapsed();
+    r.mode = static_cast<int>(view.mode());
+    r.brushPx = view.brushWidth();
+    r.brushColorRGB = rgbFromQColor(view.brushColor());
+    r.brushKind = static_cast<std::uint32_t>(view.brushKind());
+    r.zoomExp = view.camera().zoomExp();
+    r.offsetPx = view.camera().offsetPx();
+    r.worldCenter = view.camera().worldCenter();
+    writer_.append(r);
+}
+
+void InputRecorder::flush() {
+    if (!started_) return;
+    const std::vector<std::uint8_t> bytes = writer_.takeBytes();
+    if (bytes.empty()) return;
+    file_.write(reinterpret_cast<const char*>(bytes.data()), static_cast<qint64>(bytes.size()));
+    file_.flush();
+}
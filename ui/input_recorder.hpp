@@ -0,0 +1,32 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include "../core/input_log.hpp"
+
+class CanvasView;
+class QEvent;
+class Scene;
+
+// Streams the input a CanvasView receives to a log that cancans_replay
+// can play back headlessly, along with the view's settings whenever they
+// are changed from elsewhere (the side panel, the minimap).
+class InputRecorder {
+public:
+    explicit InputRecorder(const QString& path);
+    ~InputRecorder();
+
+    // Writes the header: current view state and a snapshot of the board.
+    bool start(const CanvasView& view, const Scene& scene);
+    void record(const QEvent* e);
+    // The view's mode, brush and camera as they are now.
+    void recordView(const CanvasView& view);
+
+private:
+    void flush();
+
+    QFile file_;
+    InputLogWriter writer_;
+    QElapsedTimer clock_;
+    bool started_ = false;
+};
@@ -1,11 +1,82 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include "../core/memory_budget.hpp"
+#include "canvas_view.hpp"
 #include "canvas_window.hpp"
 
 int main(int argc, char** argv){
     QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption publishOption(QStringLiteral("sync-publish"),
+        QStringLiteral("Publish strokes to the sync hub <name>."), QStringLiteral("name"));
+    const QCommandLineOption followOption(QStringLiteral("sync-follow"),
+        QStringLiteral("Mirror strokes from the sync hub <name>."), QStringLiteral("name"));
+    const QCommandLineOption budgetOption(QStringLiteral("memory-budget"),
+        QStringLiteral("Cap for cache memory in MiB (default 1024)."), QStringLiteral("mib"));
+    const QCommandLineOption asyncOption(QStringLiteral("async-render"),
+        QStringLiteral("Render frames on a background thread."));
+    const QCommandLineOption progressiveOption(QStringLiteral("progressive-render"),
+        QStringLiteral("Paint large frames over several events, nearest the cursor first."));
+    const QCommandLineOption predictOption(QStringLiteral("predict-ink"),
+        QStringLiteral("Draw provisional ink ahead of the pen."));
+    const QCommandLineOption recordOption(QStringLiteral("record"),
+        QStringLiteral("Record canvas input to <file> for cancans_replay."), QStringLiteral("file"));
+    const QCommandLineOption metricsOption(QStringLiteral("metrics"),
+        QStringLiteral("Serve Prometheus metrics on localhost <port> or local socket <name>."),
+        QStringLiteral("address"));
+    const QCommandLineOption memoryReportOption(QStringLiteral("memory-report"),
+        QStringLiteral("Write a JSON memory report to <file> on exit."), QStringLiteral("file"));
+    parser.addOption(publishOption);
+    parser.addOption(followOption);
+    parser.addOption(budgetOption);
+    parser.addOption(asyncOption);
+    parser.addOption(progressiveOption);
+    parser.addOption(predictOption);
+    parser.addOption(recordOption);
+    parser.addOption(metricsOption);
+    parser.addOption(memoryReportOption);
+    parser.process(app);
+
+    if (parser.isSet(budgetOption)) {
+        bool ok = false;
+        const qulonglong mib = parser.value(budgetOption).toULongLong(&ok);
+        if (ok) MemoryBudget::instance().setBudget(static_cast<std::size_t>(mib) << 20);
+    }
+
     CanvasWindow w;
     w.resize(1200, 800);
     w.setWindowTitle(QStringLiteral("Infinite Canvas - zoom/pan MVP"));
+    if (parser.isSet(publishOption)) {
+        w.startSync(SyncLink::Role::Publisher, parser.value(publishOption));
+    } else if (parser.isSet(followOption)) {
+        w.startSync(SyncLink::Role::Follower, parser.value(followOption));
+    }
+    if (parser.isSet(asyncOption)) {
+        w.view()->setAsyncRendering(true);
+    }
+    if (parser.isSet(progressiveOption)) {
+        w.view()->setProgressiveRendering(true);
+    }
+    if (parser.isSet(predictOption)) {
+        w.view()->setInkPrediction(true);
+    }
+    if (parser.isSet(metricsOption)) {
+        QString error;
+        if (!w.startMetrics(parser.value(metricsOption), &error)) {
+            qWarning("cannot serve metrics on %s: %s", qPrintable(parser.value(metricsOption)), qPrintable(error));
+        }
+    }
     w.show();
+    if (parser.isSet(recordOption) && !w.view()->startRecording(parser.value(recordOption))) {
+        qWarning("cannot record to %s", qPrintable(parser.value(recordOption)));
+    }
+    if (parser.isSet(memoryReportOption)) {
+        const QString path = parser.value(memoryReportOption);
+        QObject::connect(&app, &QCoreApplication::aboutToQuit, &w, [&w, path]() {
+            if (!w.writeMemoryReport(path)) qWarning("cannot write memory report to %s", qPrintable(path));
+        });
+    }
     return app.exec();
 }
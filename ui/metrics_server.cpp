@@ -0,0 +1,108 @@
+#include "metrics_server.hpp"
+
+#include <QHostAddress>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <memory>
+
+#include "../core/metrics.hpp"
+
+namespace {
+// Scrapers send a few hundred bytes; anything longer is answered as is.
+constexpr qsizetype kMaxRequestBytes = 8192;
+// A client that has not sent its request by then is dropped.
+constexpr int kRequestTimeoutMs = 5000;
+// Long enough for a live server on the same machine to accept.
+constexpr int kProbeMs = 200;
+
+QByteArray response(const char* status, const std::string& body) {
+    QByteArray out("HTTP/1.0 ");
+    out += status;
+    out += "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: ";
+    out += QByteArray::number(static_cast<qulonglong>(body.size()));
+    out += "\r\nConnection: close\r\n\r\n";
+    out.append(body.data(), static_cast<qsizetype>(body.size()));
+    return out;
+}
+}
+
+MetricsServer::MetricsServer(QObject* parent)
+    : QObject(parent) {}
+
+bool MetricsServer::listen(const QString& address) {
+    bool numeric = false;
+    const uint port = address.toUInt(&numeric);
+    if (numeric && port <= 0xFFFF) {
+        tcp_ = new QTcpServer(this);
+        if (!tcp_->listen(QHostAddress::LocalHost, static_cast<quint16>(port))) {
+            error_ = tcp_->errorString();
+            return false;
+        }
+        connect(tcp_, &QTcpServer::newConnection, this, [this]() {
+            while (QTcpSocket* s = tcp_->nextPendingConnection()) {
+                connect(s, &QTcpSocket::disconnected, s, &QObject::deleteLater);
+                serve(s, [s]() { s->disconnectFromHost(); });
+            }
+        });
+        return true;
+    }
+    local_ = new QLocalServer(this);
+    if (!local_->listen(address)) {
+        // A socket file left by a crashed run refuses connections and may be
+        // replaced; one that accepts belongs to a live server.
+        QLocalSocket probe;
+        probe.connectToServer(address);
+        const bool live = probe.waitForConnected(kProbeMs);
+        if (live || !QLocalServer::removeServer(address) || !local_->listen(address)) {
+            error_ = local_->errorString();
+            return false;
+        }
+    }
+    connect(local_, &QLocalServer::newConnection, this, [this]() {
+        while (QLocalSocket* s = local_->nextPendingConnection()) {
+            connect(s, &QLocalSocket::disconnected, s, &QObject::deleteLater);
+            serve(s, [s]() { s->disconnectFromServer(); });
+        }
+    });
+    return true;
+}
+
+void MetricsServer::addSource(Source source) {
+    sources_.push_back(std::move(source));
+}
+
+std::string MetricsServer::scrape() const {
+    std::string out;
+    Metrics::writePrometheus(out);
+    for (const Source& source : sources_) source(out);
+    return out;
+}
+
+void MetricsServer::serve(QIODevice* socket, std::function<void()> close) {
+    struct Request {
+        QByteArray head;
+        bool answered = false;
+    };
+    auto request = std::make_shared<Request>();
+    auto* timeout = new QTimer(socket);
+    timeout->setSingleShot(true);
+    connect(timeout, &QTimer::timeout, socket, [request, close]() {
+        if (request->answered) return;
+        request->answered = true;
+        close();
+    });
+    timeout->start(kRequestTimeoutMs);
+    connect(socket, &QIODevice::readyRead, socket, [this, socket, request, close]() {
+        if (request->answered) return;
+        request->head.append(socket->readAll());
+        const QByteArray& head = request->head;
+        if (!head.contains("\r\n\r\n") && !head.contains("\n\n") && head.size() < kMaxRequestBytes) return;
+        request->answered = true;
+        const bool wanted = head.startsWith("GET /metrics") || head.startsWith("GET / ");
+        socket->write(wanted ? response("200 OK", scrape()) : response("404 Not Found", "not found\n"));
+        close();
+    });
+}
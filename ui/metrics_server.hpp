@@ -0,0 +1,40 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include <functional>
+#include <string>
+#include <vector>
+
+class QIODevice;
+class QLocalServer;
+class QTcpServer;
+
+// Answers HTTP GET /metrics with Metrics and the gauges of its sources in
+// the Prometheus text format, for scrapers on the same machine. A numeric
+// address listens on that port of 127.0.0.1, anything else on a local
+// socket of that name (curl --unix-socket); a stale socket file is replaced,
+// a live server's is not. Scrapes run on the GUI thread, so sources may read
+// the scene; one response per connection, and a client that does not send
+// its request in time is dropped.
+class MetricsServer : public QObject {
+    Q_OBJECT
+public:
+    using Source = std::function<void(std::string& out)>;
+
+    explicit MetricsServer(QObject* parent = nullptr);
+
+    bool listen(const QString& address);
+    QString errorString() const { return error_; }
+    void addSource(Source source);
+
+    std::string scrape() const;
+
+private:
+    void serve(QIODevice* socket, std::function<void()> close);
+
+private:
+    QTcpServer* tcp_{nullptr};
+    QLocalServer* local_{nullptr};
+    QString error_;
+    std::vector<Source> sources_;
+};
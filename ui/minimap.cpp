@@ -0,0 +1,213 @@
+#include "minimap.hpp"
+
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPen>
+#include <QTimer>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+#include "../core/scene.hpp"
+#include "canvas_view.hpp"
+
+namespace {
+constexpr std::size_t kStrokesPerRefresh = 256;
+constexpr std::size_t kStrokesPerSlice = 1024;
+constexpr std::size_t kCheckPerSlice = 16384;
+// Long enough for a peer's next point to arrive.
+constexpr int kSettleMs = 300;
+constexpr double kPad = 6.0;
+constexpr double kRadius = 10.0;
+// Room around the ink, as a fraction of the shown extent.
+constexpr double kMargin = 0.06;
+const QColor kBackground(20, 22, 27, 235);
+const QColor kBorder(70, 76, 96, 150);
+const QColor kViewOutline(120, 140, 255);
+
+bool sameRect(const Rect& a, const Rect& b) {
+    return a.minX == b.minX && a.minY == b.minY && a.maxX == b.maxX && a.maxY == b.maxY;
+}
+}
+
+Minimap::Minimap(Scene* scene, CanvasView* view, QWidget* parent)
+    : QWidget(parent)
+    , scene_(scene)
+    , view_(view) {
+    setAttribute(Qt::WA_TranslucentBackground);
+    setCursor(Qt::PointingHandCursor);
+    setToolTip(tr("Board overview: click to jump there"));
+
+    settleTimer_ = new QTimer(this);
+    settleTimer_->setSingleShot(true);
+    settleTimer_->setInterval(kSettleMs);
+    connect(settleTimer_, &QTimer::timeout, this, &Minimap::refresh);
+}
+
+void Minimap::refresh() {
+    if (!addStrokes(summary_, kStrokesPerRefresh) || rebuild_ || scene_->revision() != checkedRevision_) {
+        scheduleCheck();
+    }
+    if (summary_.pyramid.revision() != imageRevision_ || !(view_->camera() == shownCam_) ||
+        !(scene_->origin() == shownOrigin_) || view_->size() != shownViewSize_) {
+        update();
+    }
+}
+
+void Minimap::memoryUsage(MemoryReport& report) const {
+    MemoryUsage u = summary_.pyramid.memoryUsage();
+    u += summary_.settled.memoryUsage();
+    if (rebuild_) {
+        u += rebuild_->pyramid.memoryUsage();
+        u += rebuild_->settled.memoryUsage();
+    }
+    u.addVector(pixels_);
+    const auto bytes = static_cast<std::size_t>(image_.sizeInBytes());
+    if (bytes > 0) u.addBlock(bytes, bytes);
+    report.add("ui.minimap", u);
+}
+
+bool Minimap::addStrokes(Summary& summary, std::size_t maxStrokes) {
+    const Vec2 origin = scene_->origin();
+    const bool done = summary.settled.advance(*scene_, maxStrokes,
+                                              [&](const Stroke& s) { summary.pyramid.add(s, origin); });
+    if (summary.settled.waiting()) settleTimer_->start();
+    return done;
+}
+
+void Minimap::scheduleCheck() {
+    IdleScheduler* idle = view_->idleScheduler();
+    if (idle->isQueued(checkJob_)) return;
+    auto next = std::make_shared<std::size_t>(0);
+    const std::uint64_t revision = scene_->revision();
+    checkJob_ = idle->post("minimap", IdleScheduler::Priority::Low,
+                           [this, next, revision](const IdleScheduler::Token& token) {
+        const StrokeList& strokes = scene_->strokes();
+        const Vec2 origin = scene_->origin();
+        // A rebuild under way is the one that has to be current.
+        const SettledStrokes& settled = rebuild_ ? rebuild_->settled : summary_.settled;
+        bool stale = settled.count() > strokes.size();
+        while (!stale && *next < settled.count()) {
+            if (token.shouldYield()) return false;
+            const std::size_t end = std::min(settled.count(), *next + kCheckPerSlice);
+            for (; *next < end && !stale; ++*next) stale = !settled.unchanged(strokes, origin, *next);
+        }
+        if (stale) {
+            // Ink cannot be taken out of the cells: summarize again beside
+            // the shown pyramid, which keeps taking new strokes meanwhile.
+            rebuild_ = std::make_unique<Summary>();
+            *next = 0;
+        }
+        while (!addStrokes(summary_, kStrokesPerSlice)) {
+            if (token.shouldYield()) return false;
+        }
+        if (rebuild_) {
+            while (!addStrokes(*rebuild_, kStrokesPerSlice)) {
+                if (token.shouldYield()) return false;
+            }
+            // Strokes settle over two looks; the next round takes them.
+            if (rebuild_->settled.waiting()) return true;
+            summary_ = std::move(*rebuild_);
+            rebuild_.reset();
+            image_ = QImage(); // the new pyramid counts revisions afresh
+        }
+        checkedRevision_ = revision;
+        update();
+        return true;
+    });
+}
+
+QRectF Minimap::mapRect() const {
+    return QRectF(rect()).adjusted(kPad, kPad, -kPad, -kPad);
+}
+
+Rect Minimap::viewArea() const {
+    return view_->viewWorldRect().translated(scene_->origin());
+}
+
+Rect Minimap::shownArea() const {
+    Rect area = summary_.pyramid.bounds();
+    area.expand(viewArea());
+    const QRectF map = mapRect();
+    if (area.empty() || map.isEmpty()) return area;
+
+    // Grow the short side to the widget's aspect, then leave a margin.
+    const double aspect = map.width() / map.height();
+    double w = std::max(area.width(), area.height() * aspect);
+    double h = w / aspect;
+    w *= 1.0 + 2.0 * kMargin;
+    h *= 1.0 + 2.0 * kMargin;
+    const Vec2 c = area.center();
+    return Rect(c.x - w * 0.5, c.y - h * 0.5, c.x + w * 0.5, c.y + h * 0.5);
+}
+
+void Minimap::paintEvent(QPaintEvent*) {
+    QPainter p(this);
+    p.setRenderHint(QPainter::Antialiasing, true);
+    p.setPen(QPen(kBorder, 1.0));
+    p.setBrush(kBackground);
+    p.drawRoundedRect(QRectF(rect()).adjusted(0.5, 0.5, -0.5, -0.5), kRadius, kRadius);
+
+    shownCam_ = view_->camera();
+    shownOrigin_ = scene_->origin();
+    shownViewSize_ = view_->size();
+    const QRectF map = mapRect();
+    const Rect area = shownArea();
+    if (map.isEmpty() || area.empty() || !(area.width() > 0.0)) return;
+
+    const qreal dpr = devicePixelRatioF();
+    const QSize px(static_cast<int>(map.width() * dpr), static_cast<int>(map.height() * dpr));
+    const SummaryPyramid& summary = summary_.pyramid;
+    if (summary.revision() != imageRevision_ || !sameRect(area, imageArea_) ||
+        image_.size() != px || image_.devicePixelRatio() != dpr) {
+        imageRevision_ = summary.revision();
+        imageArea_ = area;
+        summary.render(summary.levelFor(area.width() / px.width()), area, px.width(), px.height(), pixels_);
+        image_ = QImage(px, QImage::Format_ARGB32_Premultiplied);
+        for (int y = 0; y < px.height(); ++y) {
+            std::memcpy(image_.scanLine(y), pixels_.data() + static_cast<std::size_t>(y) * px.width(),
+                        static_cast<std::size_t>(px.width()) * sizeof(std::uint32_t));
+        }
+        image_.setDevicePixelRatio(dpr);
+    }
+    p.drawImage(map.topLeft(), image_);
+
+    // The view, at least a few pixels big so it stays findable on huge boards.
+    const Rect view = viewArea();
+    const double sx = map.width() / area.width();
+    const double sy = map.height() / area.height();
+    QRectF outline(map.left() + (view.minX - area.minX) * sx, map.top() + (view.minY - area.minY) * sy,
+                   view.width() * sx, view.height() * sy);
+    if (outline.width() < 4.0 || outline.height() < 4.0) {
+        const QPointF c = outline.center();
+        outline = QRectF(c.x() - 2.0, c.y() - 2.0, 4.0, 4.0);
+    }
+    p.setPen(QPen(kViewOutline, 1.5));
+    p.setBrush(Qt::NoBrush);
+    p.drawRect(outline);
+}
+
+void Minimap::mousePressEvent(QMouseEvent* e) {
+    if (e->button() == Qt::LeftButton) centerViewAt(e->position());
+}
+
+void Minimap::mouseMoveEvent(QMouseEvent* e) {
+    if (e->buttons() & Qt::LeftButton) centerViewAt(e->position());
+}
+
+void Minimap::centerViewAt(const QPointF& pos) {
+    const QRectF map = mapRect();
+    const Rect area = shownArea();
+    if (map.isEmpty() || area.empty()) return;
+    const double fx = std::clamp((pos.x() - map.left()) / map.width(), 0.0, 1.0);
+    const double fy = std::clamp((pos.y() - map.top()) / map.height(), 0.0, 1.0);
+    const Vec2 target = Vec2(area.minX + fx * area.width(), area.minY + fy * area.height()) - scene_->origin();
+
+    // Keep the zoom and put target in the middle of the view.
+    Camera cam = view_->camera();
+    const Vec2 off = cam.offsetPx();
+    const double scale = cam.scale();
+    const Vec2 center(view_->width() * 0.5, view_->height() * 0.5);
+    cam.setState(cam.zoomExp(), off, Vec2(target.x - (center.x - off.x) / scale, target.y - (center.y - off.y) / scale));
+    view_->setCamera(cam);
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <QImage>
+#include <QSize>
+#include <QWidget>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "../core/camera.hpp"
+#include "../core/settled_strokes.hpp"
+#include "../render/summary_pyramid.hpp"
+#include "idle_scheduler.hpp"
+
+class CanvasView;
+class QTimer;
+class Scene;
+
+// Overview of the whole board with the view outlined; clicking or dragging
+// centres the view there. It draws from a SummaryPyramid that takes strokes
+// as they are committed, so a repaint costs the same on any board. Strokes
+// that change after being summarized (erased, or remote ones that were
+// still growing) are caught by an idle check, which builds a new pyramid
+// beside the shown one and swaps it in once it has caught up.
+class Minimap : public QWidget {
+    Q_OBJECT
+public:
+    Minimap(Scene* scene, CanvasView* view, QWidget* parent = nullptr);
+
+    // Picks up committed strokes and repaints if the board or the view moved.
+    void refresh();
+    // Adds "ui.minimap": the pyramid and the image drawn from it.
+    void memoryUsage(MemoryReport& report) const;
+
+protected:
+    void paintEvent(QPaintEvent*) override;
+    void mousePressEvent(QMouseEvent*) override;
+    void mouseMoveEvent(QMouseEvent*) override;
+
+private:
+    struct Summary {
+        SummaryPyramid pyramid;
+        SettledStrokes settled;
+    };
+
+    // Summarizes strokes in order, looking at no more than maxStrokes.
+    // Returns false if it stopped for the limit rather than at the last
+    // committed stroke or at one that is still changing.
+    bool addStrokes(Summary& summary, std::size_t maxStrokes);
+    void scheduleCheck();
+    QRectF mapRect() const;  // widget pixels the board is drawn in
+    Rect viewArea() const;   // board units
+    Rect shownArea() const;  // board units, with the aspect of mapRect()
+    void centerViewAt(const QPointF& pos);
+
+    Scene* scene_;
+    CanvasView* view_;
+    Summary summary_;
+    std::unique_ptr<Summary> rebuild_; // replaces summary_ once caught up
+    QTimer* settleTimer_{nullptr};
+    IdleScheduler::JobId checkJob_ = 0;
+    std::uint64_t checkedRevision_ = 0; // scene revision last verified
+
+    QImage image_;
+    std::vector<std::uint32_t> pixels_;
+    std::uint64_t imageRevision_ = 0;
+    Rect imageArea_;
+    Camera shownCam_;
+    Vec2 shownOrigin_;
+    QSize shownViewSize_;
+};
@@ -0,0 +1,59 @@
+#include "painter_backend.hpp"
+
+#include <QColor>
+#include <QFont>
+#include <QPainter>
+#include <QPainterPath>
+#include <QPen>
+#include <QString>
+#include <algorithm>
+
+void PainterBackend::polylines(std::uint32_t argb, double widthPx, const Vec2* pts,
+                               const std::uint32_t* runEnds, std::size_t runs) {
+    QPen pen(QColor::fromRgba(argb));
+    pen.setWidthF(widthPx);
+    pen.setCapStyle(Qt::RoundCap);
+    pen.setJoinStyle(Qt::RoundJoin);
+    p_.setPen(pen);
+    p_.setBrush(Qt::NoBrush);
+
+    QPainterPath path;
+    std::uint32_t start = 0;
+    for (std::size_t r = 0; r < runs; ++r) {
+        const std::uint32_t end = runEnds[r];
+        path.moveTo(pts[start].x, pts[start].y);
+        for (std::uint32_t k = start + 1; k < end; ++k) {
+            path.lineTo(pts[k].x, pts[k].y);
+        }
+        start = end;
+    }
+    p_.drawPath(path);
+}
+
+void PainterBackend::fills(std::uint32_t argb, const Vec2* pts, const std::uint32_t* ends, std::size_t polygons) {
+    QPainterPath fill;
+    fill.setFillRule(Qt::WindingFill);
+    std::uint32_t start = 0;
+    for (std::size_t i = 0; i < polygons; ++i) {
+        const std::uint32_t end = ends[i];
+        fill.moveTo(pts[start].x, pts[start].y);
+        for (std::uint32_t k = start + 1; k < end; ++k) {
+            fill.lineTo(pts[k].x, pts[k].y);
+        }
+        fill.closeSubpath();
+        start = end;
+    }
+    p_.setPen(Qt::NoPen);
+    p_.setBrush(QColor::fromRgba(argb));
+    p_.drawPath(fill);
+    p_.setBrush(Qt::NoBrush);
+}
+
+void PainterBackend::text(std::uint32_t argb, double sizePx, const Vec2& baseline, std::string_view utf8) {
+    QFont f = p_.font();
+    f.setPixelSize(std::max(1, qRound(sizePx)));
+    p_.setFont(f);
+    p_.setPen(QColor::fromRgba(argb));
+    p_.drawText(QPointF(baseline.x, baseline.y),
+                QString::fromUtf8(utf8.data(), static_cast<qsizetype>(utf8.size())));
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "../render/renderer.hpp"
+
+class QPainter;
+
+// Replays into a QPainter, one path per call. Text uses the painter's font
+// family at the requested pixel size. Leaves no brush set.
+class PainterBackend : public RenderBackend {
+public:
+    explicit PainterBackend(QPainter& p) : p_(p) {}
+
+    void polylines(std::uint32_t argb, double widthPx, const Vec2* pts,
+                   const std::uint32_t* runEnds, std::size_t runs) override;
+    void fills(std::uint32_t argb, const Vec2* pts, const std::uint32_t* ends, std::size_t polygons) override;
+    void text(std::uint32_t argb, double sizePx, const Vec2& baseline, std::string_view utf8) override;
+
+private:
+    QPainter& p_;
+};
@@ -0,0 +1,54 @@
+#include "pdf_export_sink.hpp"
+
+#include <QPageLayout>
+#include <QPageSize>
+#include <fstream>
+
+#include "frame_painter.hpp"
+
+PdfExportSink::PdfExportSink(const QString& path)
+    : path_(path) {}
+
+PdfExportSink::~PdfExportSink() {
+    if (painter_) painter_->end();
+}
+
+bool PdfExportSink::begin(double widthPx, double heightPx, std::uint32_t backgroundRGB, bool fillBackground) {
+    writer_ = std::make_unique<QPdfWriter>(path_);
+    writer_->setResolution(72);
+    writer_->setPageLayout(QPageLayout(QPageSize(QSizeF(widthPx, heightPx), QPageSize::Point),
+                                       QPageLayout::Portrait, QMarginsF()));
+    writer_->setCreator(QStringLiteral("cancans"));
+
+    painter_ = std::make_unique<QPainter>();
+    if (!painter_->begin(writer_.get())) {
+        painter_.reset();
+        return false;
+    }
+    painter_->setRenderHint(QPainter::Antialiasing, true);
+    if (fillBackground) painter_->fillRect(QRectF(0.0, 0.0, widthPx, heightPx), colorFromRgb(backgroundRGB));
+    painter_->setBrush(Qt::NoBrush);
+    return true;
+}
+
+void PdfExportSink::writeBatch(const StrokeBatch& b) {
+    FramePainter::drawBatch(*painter_, b);
+}
+
+bool PdfExportSink::end() {
+    const bool ok = painter_ && painter_->end();
+    painter_.reset();
+    writer_.reset();
+    return ok;
+}
+
+bool exportBoardToFile(const SceneSnapshot& snapshot, const ExportOptions& options, const QString& path) {
+    if (path.endsWith(QStringLiteral(".pdf"), Qt::CaseInsensitive)) {
+        PdfExportSink sink(path);
+        return exportBoard(snapshot, options, sink);
+    }
+    std::ofstream out(path.toStdString(), std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    SvgExportSink sink(out);
+    return exportBoard(snapshot, options, sink);
+}
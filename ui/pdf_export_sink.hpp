@@ -0,0 +1,26 @@
+#pragma once
+#include <QPainter>
+#include <QPdfWriter>
+#include <QString>
+#include <memory>
+#include "../render/board_export.hpp"
+
+// Single-page PDF, one point per output pixel. Batches are painted as they
+// arrive; QPdfWriter streams page content, so memory stays flat.
+class PdfExportSink : public ExportSink {
+public:
+    explicit PdfExportSink(const QString& path);
+    ~PdfExportSink() override;
+
+    bool begin(double widthPx, double heightPx, std::uint32_t backgroundRGB, bool fillBackground) override;
+    void writeBatch(const StrokeBatch& b) override;
+    bool end() override;
+
+private:
+    QString path_;
+    std::unique_ptr<QPdfWriter> writer_;
+    std::unique_ptr<QPainter> painter_;
+};
+
+// Exports by file suffix: .pdf through PdfExportSink, anything else as SVG.
+bool exportBoardToFile(const SceneSnapshot& snapshot, const ExportOptions& options, const QString& path);
@@ -0,0 +1,183 @@
+#include "progressive_frame.hpp"
+
+#include <QElapsedTimer>
+#include <QPainter>
+#include <algorithm>
+#include <cmath>
+
+#include "../core/element_store.hpp"
+#include "../core/stroke_list.hpp"
+#include "frame_painter.hpp"
+
+namespace {
+// Antialiasing and the hairline minimum reach this far past the ink bounds.
+constexpr double kFringePx = 2.0;
+// Preview strokes span at least this share of the view's longer side...
+constexpr double kPreviewShare = 0.25;
+// ...and only this many of the largest are drawn.
+constexpr std::size_t kMaxPreviewStrokes = 256;
+// Strokes binned between looks at the clock.
+constexpr std::size_t kBinStrokesPerStep = 2048;
+}
+
+void ProgressiveFrame::clear() {
+    buffer_ = QImage();
+    visible_.clear();
+    binned_ = 0;
+    large_.clear();
+    tiles_.clear();
+    order_.clear();
+    next_ = 0;
+    preview_.clear();
+    totalWork_ = 0;
+    doneWork_ = 0;
+}
+
+double ProgressiveFrame::progress() const {
+    if (binned_ < visible_.size()) return 0.0;
+    return totalWork_ == 0 ? 1.0 : static_cast<double>(doneWork_) / static_cast<double>(totalWork_);
+}
+
+QRect ProgressiveFrame::tileRect(std::size_t tile) const {
+    const int tx = static_cast<int>(tile % static_cast<std::size_t>(tilesX_));
+    const int ty = static_cast<int>(tile / static_cast<std::size_t>(tilesX_));
+    return QRect(tx * kTilePx, ty * kTilePx, kTilePx, kTilePx).intersected(QRect(QPoint(0, 0), size_));
+}
+
+void ProgressiveFrame::restart(const Camera& cam, const QSize& size, qreal dpr, const Vec2& origin, const Vec2& focus,
+                               const std::vector<std::size_t>& visible) {
+    const QSize pixelSize(static_cast<int>(std::ceil(size.width() * dpr)),
+                          static_cast<int>(std::ceil(size.height() * dpr)));
+    const bool moved = !(cam == cam_) || size != size_ || !(origin == origin_) ||
+                       buffer_.isNull() || buffer_.size() != pixelSize;
+    fresh_ = buffer_.isNull();
+    if (moved) {
+        QImage next(pixelSize, QImage::Format_ARGB32_Premultiplied);
+        next.setDevicePixelRatio(dpr);
+        QPainter p(&next);
+        p.fillRect(QRect(QPoint(0, 0), size), FramePainter::backgroundColor());
+        FramePainter::drawGrid(p, size, cam);
+        if (!fresh_) {
+            // As the async view presents a frame for a newer camera.
+            const Vec2 shift = origin - origin_;
+            const Vec2 w0 = cam_.worldFromScreen(0.0, 0.0) - shift;
+            const Vec2 s0 = cam.screenFromWorld(w0.x, w0.y);
+            const double k = cam.scale() / cam_.scale();
+            p.setRenderHint(QPainter::SmoothPixmapTransform, k != 1.0);
+            p.translate(s0.x, s0.y);
+            p.scale(k, k);
+            p.drawImage(QPointF(0.0, 0.0), buffer_);
+        }
+        p.end();
+        buffer_ = next;
+    }
+    cam_ = cam;
+    size_ = size;
+    origin_ = origin;
+    focus_ = focus;
+
+    tilesX_ = std::max(1, (size.width() + kTilePx - 1) / kTilePx);
+    tilesY_ = std::max(1, (size.height() + kTilePx - 1) / kTilePx);
+    tiles_.resize(static_cast<std::size_t>(tilesX_) * static_cast<std::size_t>(tilesY_));
+    for (std::vector<std::size_t>& t : tiles_) t.clear();
+    visible_ = visible;
+    binned_ = 0;
+    large_.clear();
+    order_.clear();
+    next_ = 0;
+    preview_.clear();
+    totalWork_ = 0;
+    doneWork_ = 0;
+    if (visible_.empty()) plan();
+}
+
+void ProgressiveFrame::bin(const StrokeList& strokes, std::size_t maxStrokes) {
+    const double previewPx = kPreviewShare * std::max(size_.width(), size_.height());
+    const auto clampTile = [](double px, int n) {
+        return static_cast<int>(std::clamp(std::floor(px / kTilePx), 0.0, static_cast<double>(n - 1)));
+    };
+    const std::size_t end = std::min(visible_.size(), binned_ + maxStrokes);
+    for (; binned_ < end; ++binned_) {
+        const std::size_t i = visible_[binned_];
+        const Rect ink = strokes[i].inkBounds();
+        const Vec2 a = cam_.screenFromWorld(ink.minX, ink.minY);
+        const Vec2 b = cam_.screenFromWorld(ink.maxX, ink.maxY);
+        const double extentPx = std::max(b.x - a.x, b.y - a.y);
+        if (fresh_ && extentPx >= previewPx) large_.push_back({extentPx, binned_});
+        const int tx0 = clampTile(a.x - kFringePx, tilesX_);
+        const int tx1 = clampTile(b.x + kFringePx, tilesX_);
+        const int ty0 = clampTile(a.y - kFringePx, tilesY_);
+        const int ty1 = clampTile(b.y + kFringePx, tilesY_);
+        for (int ty = ty0; ty <= ty1; ++ty) {
+            for (int tx = tx0; tx <= tx1; ++tx) {
+                tiles_[static_cast<std::size_t>(ty) * static_cast<std::size_t>(tilesX_) + static_cast<std::size_t>(tx)]
+                    .push_back(i);
+            }
+        }
+    }
+    if (binned_ >= visible_.size()) plan();
+}
+
+void ProgressiveFrame::plan() {
+    // Largest first for the cut, then back to draw order.
+    if (large_.size() > kMaxPreviewStrokes) {
+        std::nth_element(large_.begin(), large_.begin() + kMaxPreviewStrokes, large_.end(),
+                         [](const Large& x, const Large& y) { return x.extentPx > y.extentPx; });
+        large_.resize(kMaxPreviewStrokes);
+    }
+    std::sort(large_.begin(), large_.end(), [](const Large& x, const Large& y) { return x.position < y.position; });
+    preview_.clear();
+    for (const Large& l : large_) preview_.push_back(visible_[l.position]);
+    large_.clear();
+
+    const std::size_t count = tiles_.size();
+    order_.resize(count);
+    std::vector<double> distance(count);
+    totalWork_ = 0;
+    for (std::size_t t = 0; t < count; ++t) {
+        order_[t] = t;
+        const QRect r = tileRect(t);
+        const QPointF c = QRectF(r).center();
+        distance[t] = std::hypot(c.x() - focus_.x, c.y() - focus_.y);
+        totalWork_ += tiles_[t].size() + 1;
+    }
+    std::sort(order_.begin(), order_.end(), [&](std::size_t x, std::size_t y) { return distance[x] < distance[y]; });
+    next_ = 0;
+    doneWork_ = 0;
+}
+
+bool ProgressiveFrame::paint(FramePainter& painter, const StrokeList& strokes, const ElementStore& elements,
+                             const DensityFrame* density, double budgetMs) {
+    if (buffer_.isNull() || complete()) return complete();
+    QElapsedTimer timer;
+    timer.start();
+    const auto spent = [&]() { return static_cast<double>(timer.nsecsElapsed()) / 1e6 >= budgetMs; };
+    while (binned_ < visible_.size()) {
+        bin(strokes, kBinStrokesPerStep);
+        if (spent()) return complete();
+    }
+    QPainter p(&buffer_);
+    painter.beginScene(cam_, size_);
+    if (!preview_.empty()) {
+        painter.drawScene(p, size_, cam_, strokes, preview_, elements, {});
+        preview_.clear();
+    }
+    const int fringe = static_cast<int>(std::ceil(kFringePx));
+    while (next_ < order_.size()) {
+        const std::size_t t = order_[next_++];
+        const QRect r = tileRect(t);
+        const Vec2 a = cam_.worldFromScreen(r.left(), r.top());
+        const Vec2 b = cam_.worldFromScreen(r.left() + r.width(), r.top() + r.height());
+        rows_.clear();
+        elements.query(Rect(a.x, a.y, b.x, b.y), rows_);
+        p.save();
+        p.setClipRect(r);
+        painter.paintBackground(p, size_, cam_);
+        painter.clipScene(r.adjusted(-fringe, -fringe, fringe, fringe));
+        painter.drawScene(p, size_, cam_, strokes, tiles_[t], elements, rows_, density);
+        p.restore();
+        doneWork_ += tiles_[t].size() + 1;
+        if (spent()) break;
+    }
+    return complete();
+}
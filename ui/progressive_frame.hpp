@@ -0,0 +1,75 @@
+#pragma once
+#include <QImage>
+#include <QSize>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../core/camera.hpp"
+
+class ElementStore;
+class FramePainter;
+class StrokeList;
+struct DensityFrame;
+
+// A frame painted over several paint events into a back buffer, so a view
+// with more strokes than one event can draw keeps taking input and shows
+// where it has got to. The visible strokes are first sorted into square
+// tiles, within the same time budget. Then the largest strokes go first as
+// a preview, then the tiles nearest the focus point (the cursor), each
+// complete in draw order, with the strokes cut to the tile before they are
+// rasterized. Until a tile is repainted it shows the previous frame, moved
+// to the new camera.
+class ProgressiveFrame {
+public:
+    static constexpr int kTilePx = 128;
+
+    void clear();
+    bool isNull() const { return buffer_.isNull(); }
+    bool complete() const { return binned_ >= visible_.size() && next_ >= order_.size() && preview_.empty(); }
+    // Share of the frame's work done, weighted by the strokes in each tile.
+    double progress() const;
+    // At the device pixel ratio of restart(); draw at the widget's origin.
+    const QImage& image() const { return buffer_; }
+
+    // Starts the frame over. origin is the scene origin, so a recenter
+    // since the previous start moves the old content with the strokes;
+    // focus is in widget pixels; visible are scene indices in draw order.
+    void restart(const Camera& cam, const QSize& size, qreal dpr, const Vec2& origin, const Vec2& focus,
+                 const std::vector<std::size_t>& visible);
+    // Sorts strokes into tiles, then paints, until budgetMs has passed,
+    // always at least one step. Strokes and elements must be those of the
+    // visible strokes restart() was given. Returns complete().
+    bool paint(FramePainter& painter, const StrokeList& strokes, const ElementStore& elements,
+               const DensityFrame* density, double budgetMs);
+
+private:
+    struct Large {
+        double extentPx;
+        std::size_t position; // in visible_, which is in draw order
+    };
+
+    QRect tileRect(std::size_t tile) const;
+    // Puts the next visible strokes into the tiles they touch.
+    void bin(const StrokeList& strokes, std::size_t maxStrokes);
+    // Once every stroke is binned: the preview and the tile order.
+    void plan();
+
+    QImage buffer_;
+    Camera cam_;
+    QSize size_;
+    Vec2 origin_;
+    Vec2 focus_;
+    bool fresh_ = false;                          // nothing of an earlier frame to show
+    int tilesX_ = 0;
+    int tilesY_ = 0;
+    std::vector<std::size_t> visible_;
+    std::size_t binned_ = 0;                      // of visible_
+    std::vector<Large> large_;                    // preview candidates
+    std::vector<std::vector<std::size_t>> tiles_; // visible strokes per tile, draw order
+    std::vector<std::size_t> order_;              // tiles, nearest the focus first
+    std::size_t next_ = 0;
+    std::vector<std::size_t> preview_;            // drawn whole by the first paint
+    std::size_t totalWork_ = 0;
+    std::size_t doneWork_ = 0;
+    std::vector<std::uint32_t> rows_;             // reused per tile
+};
@@ -0,0 +1,157 @@
+#include "render_thread.hpp"
+
+#include <QElapsedTimer>
+#include <QPainter>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+#include "../core/metrics.hpp"
+#include "../core/scene.hpp"
+
+namespace {
+constexpr std::size_t kMaxBuffers = 3;
+}
+
+RenderThread::RenderThread(QObject* parent)
+    : QThread(parent) {}
+
+RenderThread::~RenderThread() {
+    stop();
+    wait();
+}
+
+void RenderThread::submit(FrameRequest request) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Input a dropped frame would have shown first is shown by this one.
+        if (pending_ && pending_->inputNs != 0 &&
+            (request.inputNs == 0 || pending_->inputNs < request.inputNs)) {
+            request.inputNs = pending_->inputNs;
+        }
+        pending_ = std::move(request);
+    }
+    wake_.notify_one();
+}
+
+RenderedFrame RenderThread::latest() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return latest_;
+}
+
+void RenderThread::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    counted_.notify_all();
+}
+
+MemoryReport RenderThread::memoryReport(int waitMs) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const std::uint64_t want = memorySerial_ + 1;
+    memoryWanted_ = true;
+    wake_.notify_one();
+    if (waitMs > 0) {
+        counted_.wait_for(lock, std::chrono::milliseconds(waitMs),
+                          [&]() { return stopping_ || memorySerial_ >= want; });
+    }
+    return memory_;
+}
+
+MemoryReport RenderThread::countMemory() const {
+    MemoryReport report;
+    painter_.memoryUsage(report);
+    MemoryUsage buffers;
+    buffers.addVector(pool_);
+    for (const QImage& image : pool_) {
+        const auto bytes = static_cast<std::size_t>(image.sizeInBytes());
+        buffers.addBlock(bytes, bytes);
+    }
+    report.add("ui.frame_buffers", buffers);
+    return report;
+}
+
+void RenderThread::run() {
+    for (;;) {
+        FrameRequest req;
+        bool count = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this]() { return stopping_ || pending_.has_value() || memoryWanted_; });
+            if (stopping_) return;
+            // A count goes first; a pending frame is picked up on the next turn.
+            std::swap(count, memoryWanted_);
+            if (!count) {
+                req = std::move(*pending_);
+                pending_.reset();
+            }
+        }
+        if (count) {
+            MemoryReport report = countMemory();
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                memory_ = std::move(report);
+                ++memorySerial_;
+            }
+            counted_.notify_all();
+            continue;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+
+        // A reduced-resolution frame keeps its logical size through the
+        // device pixel ratio, so the GUI's drawImage upscales it.
+        const qreal dpr = req.dpr * req.resolution;
+        const QSize pixelSize(static_cast<int>(std::ceil(req.size.width() * dpr)),
+                              static_cast<int>(std::ceil(req.size.height() * dpr)));
+        QImage image = acquireBuffer(pixelSize, dpr);
+        {
+            QPainter p(&image);
+            painter_.setImageLibrary(req.images);
+            painter_.setAntialiasing(req.antialias);
+            painter_.setLiveStroke(req.liveStroke);
+            painter_.paintBackground(p, req.size, req.cam);
+            painter_.paintScene(p, req.size, req.cam, req.scene->strokes, req.visible, *req.scene->elements,
+                                req.elementRows, &req.density);
+        }
+
+        pool_.push_back(image);
+        if (pool_.size() > kMaxBuffers) pool_.erase(pool_.begin());
+
+        RenderedFrame frame;
+        frame.image = image;
+        frame.cam = req.cam;
+        frame.origin = req.origin;
+        frame.revision = req.revision;
+        frame.liveStroke = req.liveStroke;
+        frame.inputNs = req.inputNs;
+        frame.renderMs = static_cast<double>(timer.nsecsElapsed()) / 1e6;
+        Metrics::record(Metrics::Timing::RenderFrame, timer.nsecsElapsed());
+        frame.resolution = req.resolution;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            frame.serial = ++serial_;
+            latest_ = std::move(frame);
+        }
+        emit frameReady();
+    }
+}
+
+QImage RenderThread::acquireBuffer(const QSize& pixelSize, qreal dpr) {
+    // A pooled buffer is free once neither latest_ nor the GUI holds a copy.
+    // It leaves the pool while being painted so QPainter does not detach it.
+    for (auto it = pool_.begin(); it != pool_.end(); ++it) {
+        if (it->size() == pixelSize && it->isDetached()) {
+            QImage img = std::move(*it);
+            pool_.erase(it);
+            img.setDevicePixelRatio(dpr);
+            return img;
+        }
+    }
+    QImage fresh(pixelSize, QImage::Format_ARGB32_Premultiplied);
+    fresh.setDevicePixelRatio(dpr);
+    return fresh;
+}
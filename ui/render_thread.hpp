@@ -0,0 +1,94 @@
+#pragma once
+#include <QImage>
+#include <QSize>
+#include <QThread>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include "../core/camera.hpp"
+#include "../core/memory_usage.hpp"
+#include "frame_painter.hpp"
+
+class ImageLibrary;
+struct SceneSnapshot;
+
+// Everything a frame needs, captured on the GUI thread. The scene comes as
+// a published snapshot, so the render thread never touches the live Scene.
+struct FrameRequest {
+    Camera cam;
+    QSize size;
+    qreal dpr = 1.0;
+    Vec2 origin;                 // snapshot origin
+    std::uint64_t revision = 0;  // snapshot revision
+    std::int64_t inputNs = 0;    // oldest input shown first by this frame
+    std::shared_ptr<const SceneSnapshot> scene;
+    std::vector<std::size_t> visible;         // stroke indices, in draw order
+    std::vector<std::uint32_t> elementRows;   // visible rows, in draw order
+    DensityFrame density;                     // raster ink far out; empty otherwise
+    std::size_t liveStroke = std::numeric_limits<std::size_t>::max(); // drawn by the GUI
+    ImageLibrary* images = nullptr;                     // thread-safe tile source
+    double resolution = 1.0;     // fraction of dpr to render at; the GUI upscales
+    bool antialias = true;
+};
+
+struct RenderedFrame {
+    QImage image;
+    Camera cam;
+    Vec2 origin;
+    std::uint64_t revision = 0;
+    std::size_t liveStroke = std::numeric_limits<std::size_t>::max();
+    std::int64_t inputNs = 0;
+    double renderMs = 0.0;
+    double resolution = 1.0;
+    std::uint64_t serial = 0;    // increases with every rendered frame
+};
+
+// Renders frame requests off the GUI thread into a small pool of images
+// (up to three: presented, latest, in progress). Requests are a mailbox of
+// one: a newer submit replaces a request that has not started yet, and
+// inherits its input timestamp if that is older.
+class RenderThread : public QThread {
+    Q_OBJECT
+public:
+    explicit RenderThread(QObject* parent = nullptr);
+    ~RenderThread() override;
+
+    void submit(FrameRequest request);
+    RenderedFrame latest() const;
+    void stop();
+    // Caches and frame buffers of the render thread, which counts them
+    // between frames. Returns the last count after asking for a new one,
+    // waiting up to waitMs for it.
+    MemoryReport memoryReport(int waitMs = 0);
+
+signals:
+    void frameReady();
+
+protected:
+    void run() override;
+
+private:
+    QImage acquireBuffer(const QSize& pixelSize, qreal dpr);
+    MemoryReport countMemory() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable counted_;
+    std::optional<FrameRequest> pending_;
+    RenderedFrame latest_;
+    std::uint64_t serial_ = 0;
+    bool memoryWanted_ = false;
+    std::uint64_t memorySerial_ = 0; // counts taken so far
+    MemoryReport memory_;
+    bool stopping_ = false;
+
+    // Render thread only.
+    std::vector<QImage> pool_;
+    FramePainter painter_;
+};
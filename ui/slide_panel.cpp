@@ -2,6 +2,7 @@
 
 #include <QAbstractButton>
 #include <QButtonGroup>
+#include <QComboBox>
 #include <QDoubleSpinBox>
 #include <QGridLayout>
 #include <QLabel>
@@ -157,6 +158,24 @@ void SlidePanel::setupUi() {
     modeButtons_->addButton(drawButton, static_cast<int>(Mode::Draw));
     layout->addWidget(drawButton);
 
+    auto* textButton = new QToolButton(this);
+    textButton->setText(tr("Text"));
+    textButton->setCheckable(true);
+    textButton->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
+    textButton->setArrowType(Qt::NoArrow);
+    textButton->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
+    modeButtons_->addButton(textButton, static_cast<int>(Mode::Text));
+    layout->addWidget(textButton);
+
+    auto* eraseButton = new QToolButton(this);
+    eraseButton->setText(tr("Erase"));
+    eraseButton->setCheckable(true);
+    eraseButton->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
+    eraseButton->setArrowType(Qt::NoArrow);
+    eraseButton->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
+    modeButtons_->addButton(eraseButton, static_cast<int>(Mode::Eraser));
+    layout->addWidget(eraseButton);
+
     modeStack_ = new QStackedWidget(this);
     modeStack_->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 
@@ -186,6 +205,17 @@ void SlidePanel::setupUi() {
     drawLayout->addWidget(strokeLabel);
     drawLayout->addWidget(brushSpin_);
 
+    auto* kindLabel = new QLabel(tr("Brush"), drawPage);
+    brushKindCombo_ = new QComboBox(drawPage);
+    // Items follow BrushKind order.
+    brushKindCombo_->addItems({tr("Pen"), tr("Soft"), tr("Grain")});
+    connect(brushKindCombo_, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index) {
+        if (index >= 0) emit brushKindChanged(static_cast<BrushKind>(index));
+    });
+
+    drawLayout->addWidget(kindLabel);
+    drawLayout->addWidget(brushKindCombo_);
+
     auto* colorLabel = new QLabel(tr("Color"), drawPage);
     colorLabel->setStyleSheet(QStringLiteral("margin-top: 6px;"));
     drawLayout->addWidget(colorLabel);
@@ -273,8 +303,28 @@ void SlidePanel::setupUi() {
     drawLayout->addWidget(colorEdit_);
     drawLayout->addStretch(1);
 
+    auto* textPage = new QWidget(this);
+    auto* textLayout = new QVBoxLayout(textPage);
+    textLayout->setContentsMargins(0, 0, 0, 0);
+    textLayout->setSpacing(8);
+    auto* textInfo = new QLabel(tr("Click the board to place a label. It uses the brush colour."), textPage);
+    textInfo->setWordWrap(true);
+    textLayout->addWidget(textInfo);
+    textLayout->addStretch(1);
+
+    auto* erasePage = new QWidget(this);
+    auto* eraseLayout = new QVBoxLayout(erasePage);
+    eraseLayout->setContentsMargins(0, 0, 0, 0);
+    eraseLayout->setSpacing(8);
+    auto* eraseInfo = new QLabel(tr("Drag over strokes to erase. The eraser grows with the brush width ([ and ])."), erasePage);
+    eraseInfo->setWordWrap(true);
+    eraseLayout->addWidget(eraseInfo);
+    eraseLayout->addStretch(1);
+
     pageMap_.insert(Mode::Pan, modeStack_->addWidget(navPage));
     pageMap_.insert(Mode::Draw, modeStack_->addWidget(drawPage));
+    pageMap_.insert(Mode::Text, modeStack_->addWidget(textPage));
+    pageMap_.insert(Mode::Eraser, modeStack_->addWidget(erasePage));
     modeStack_->setCurrentIndex(pageMap_.value(Mode::Pan));
 
     layout->addWidget(modeStack_, 1);
@@ -301,6 +351,12 @@ void SlidePanel::setBrushWidth(double px) {
     brushSpin_->setValue(px);
 }
 
+void SlidePanel::setBrushKind(BrushKind kind) {
+    if (!brushKindCombo_) return;
+    QSignalBlocker blocker(brushKindCombo_);
+    brushKindCombo_->setCurrentIndex(static_cast<int>(kind));
+}
+
 void SlidePanel::setBrushColor(const QColor& color) {
     if (!color.isValid()) return;
     if (color == currentColor_) return;
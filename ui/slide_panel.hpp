@@ -3,9 +3,11 @@
 #include <QFrame>
 #include <QHash>
 #include <QString>
+#include "../core/elements/stroke.hpp"
 #include "tool_mode.hpp"
 
 class QButtonGroup;
+class QComboBox;
 class QDoubleSpinBox;
 class QLineEdit;
 class QStackedWidget;
@@ -20,12 +22,14 @@ public:
     void setMode(Mode mode);
     void setBrushWidth(double px);
     void setBrushColor(const QColor& color);
+    void setBrushKind(BrushKind kind);
     int preferredWidth() const { return width(); }
 
 signals:
     void modeRequested(Mode mode);
     void brushWidthChanged(double px);
     void brushColorChanged(const QColor& color);
+    void brushKindChanged(BrushKind kind);
 
 private:
     void setupUi();
@@ -40,6 +44,7 @@ private:
     QButtonGroup* modeButtons_{nullptr};
     QStackedWidget* modeStack_{nullptr};
     QDoubleSpinBox* brushSpin_{nullptr};
+    QComboBox* brushKindCombo_{nullptr};
     QButtonGroup* colorButtons_{nullptr};
     QLineEdit* colorEdit_{nullptr};
     QHash<Mode, int> pageMap_;
@@ -0,0 +1,93 @@
+#include "sync_link.hpp"
+
+#include <QByteArray>
+#include <QLocalSocket>
+#include <QTimer>
+#include <vector>
+
+#include "../core/scene.hpp"
+
+namespace {
+constexpr int kFrameIntervalMs = 16;
+constexpr int kRetryIntervalMs = 1000;
+}
+
+SyncLink::SyncLink(Scene* scene, Role role, const QString& serverName, QObject* parent)
+    : QObject(parent)
+    , scene_(scene)
+    , role_(role)
+    , serverName_(serverName) {
+    Q_ASSERT(scene_);
+    socket_ = new QLocalSocket(this);
+    frameTimer_ = new QTimer(this);
+    frameTimer_->setInterval(kFrameIntervalMs);
+    retryTimer_ = new QTimer(this);
+    retryTimer_->setInterval(kRetryIntervalMs);
+    retryTimer_->setSingleShot(true);
+
+    connect(socket_, &QLocalSocket::connected, this, &SyncLink::handleConnected);
+    connect(socket_, &QLocalSocket::readyRead, this, &SyncLink::readFrames);
+    // The hub keeps the session log, so a dropped link is not resumed: a
+    // reconnect would replay (or republish) strokes we already have.
+    connect(socket_, &QLocalSocket::disconnected, frameTimer_, &QTimer::stop);
+    connect(socket_, &QLocalSocket::errorOccurred, this, [this](QLocalSocket::LocalSocketError) {
+        if (!everConnected_ && socket_->state() == QLocalSocket::UnconnectedState) retryTimer_->start();
+    });
+    connect(frameTimer_, &QTimer::timeout, this, &SyncLink::publishFrame);
+    connect(retryTimer_, &QTimer::timeout, this, &SyncLink::connectToHub);
+
+    connectToHub();
+}
+
+bool SyncLink::isConnected() const {
+    return socket_->state() == QLocalSocket::ConnectedState;
+}
+
+void SyncLink::connectToHub() {
+    if (everConnected_ || socket_->state() != QLocalSocket::UnconnectedState) return;
+    socket_->connectToServer(serverName_);
+}
+
+void SyncLink::handleConnected() {
+    everConnected_ = true;
+    if (role_ == Role::Publisher) {
+        publishFrame();
+        frameTimer_->start();
+    }
+}
+
+void SyncLink::publishFrame() {
+    if (!isConnected()) return;
+    const std::vector<std::uint8_t> payload = publisher_.poll(*scene_);
+    if (payload.empty()) return;
+
+    std::vector<std::uint8_t> framed;
+    appendSyncFrame(framed, payload);
+    socket_->write(reinterpret_cast<const char*>(framed.data()), static_cast<qint64>(framed.size()));
+}
+
+void SyncLink::publishErase(const Capsule& capsule) {
+    if (role_ != Role::Publisher || !isConnected()) return;
+    const std::vector<std::uint8_t> payload = publisher_.erase(*scene_, capsule);
+
+    std::vector<std::uint8_t> framed;
+    appendSyncFrame(framed, payload);
+    socket_->write(reinterpret_cast<const char*>(framed.data()), static_cast<qint64>(framed.size()));
+}
+
+void SyncLink::readFrames() {
+    const QByteArray bytes = socket_->readAll();
+    if (role_ != Role::Follower) return;
+
+    reader_.feed(reinterpret_cast<const std::uint8_t*>(bytes.constData()), static_cast<std::size_t>(bytes.size()));
+    bool changed = false;
+    std::vector<std::uint8_t> payload;
+    while (reader_.next(payload)) {
+        applier_.apply(payload.data(), payload.size(), *scene_);
+        changed = true;
+    }
+    if (reader_.failed()) {
+        socket_->abort();
+    }
+    if (changed) emit sceneChanged();
+}
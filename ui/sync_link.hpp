@@ -0,0 +1,46 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include "../core/sync_ops.hpp"
+
+class QLocalSocket;
+class QTimer;
+class Scene;
+
+// Connects a scene to a sync hub over QLocalSocket (a Unix domain socket on
+// Unix, a named pipe on Windows). A publisher sends one frame of stroke ops
+// per display frame; followers apply incoming frames to their own scene.
+// Until the hub is reachable the link keeps retrying once a second.
+class SyncLink : public QObject {
+    Q_OBJECT
+public:
+    enum class Role { Publisher, Follower };
+
+    SyncLink(Scene* scene, Role role, const QString& serverName, QObject* parent = nullptr);
+
+    Role role() const { return role_; }
+    bool isConnected() const;
+    // Publisher only: sends an erase the local scene is about to apply.
+    void publishErase(const Capsule& capsule);
+
+signals:
+    void sceneChanged();
+
+private:
+    void connectToHub();
+    void handleConnected();
+    void publishFrame();
+    void readFrames();
+
+private:
+    Scene* scene_{nullptr};
+    Role role_;
+    QString serverName_;
+    QLocalSocket* socket_{nullptr};
+    QTimer* frameTimer_{nullptr};
+    QTimer* retryTimer_{nullptr};
+    SyncPublisher publisher_;
+    SyncApplier applier_;
+    SyncFrameReader reader_;
+    bool everConnected_ = false;
+};
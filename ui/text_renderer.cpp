@@ -0,0 +1,254 @@
+#include "text_renderer.hpp"
+#include <QFont>
+#include <QPainter>
+#include <QTextLayout>
+#include <QTextOption>
+#include <algorithm>
+#include <cmath>
+
+#include "../core/metrics.hpp"
+#include "frame_painter.hpp"
+
+namespace {
+// Labels are shaped once at this pixel size and scaled from there.
+constexpr int kLayoutPx = 64;
+// Below this em size a label is unreadable; draw its box instead.
+constexpr double kMinReadablePx = 4.0;
+// Above this, glyph bitmaps get big and few; use the outlines.
+constexpr double kMaxAtlasPx = 128.0;
+constexpr std::size_t kMaxAtlasPages = 8;
+constexpr std::size_t kMaxLayouts = 8192;
+constexpr std::uint64_t kLayoutKeepPasses = 240;
+constexpr qreal kLineWidth = 1e6;
+
+QFont layoutFont(const QString& family) {
+    QFont font;
+    if (!family.isEmpty()) font.setFamily(family);
+    font.setPixelSize(kLayoutPx);
+    return font;
+}
+
+// Lays out one line per '\n' without wrapping; returns the box in layout pixels.
+QSizeF shape(QTextLayout& layout) {
+    QTextOption option;
+    option.setWrapMode(QTextOption::NoWrap);
+    layout.setTextOption(option);
+    layout.beginLayout();
+    qreal y = 0.0;
+    qreal width = 0.0;
+    for (QTextLine line = layout.createLine(); line.isValid(); line = layout.createLine()) {
+        line.setLineWidth(kLineWidth);
+        line.setPosition(QPointF(0.0, y));
+        y += line.height();
+        width = std::max(width, line.naturalTextWidth());
+    }
+    layout.endLayout();
+    return QSizeF(width, y);
+}
+
+QString labelText(const std::string& utf8) {
+    QString s = QString::fromStdString(utf8);
+    s.replace(QLatin1Char('\n'), QChar::LineSeparator);
+    return s;
+}
+}
+
+int GlyphAtlas::bucketFor(double pixelSize) {
+    return static_cast<int>(std::lround(4.0 * std::log2(std::max(pixelSize, 1.0))));
+}
+
+double GlyphAtlas::bucketPixels(int bucket) {
+    return std::exp2(bucket / 4.0);
+}
+
+std::size_t GlyphAtlas::KeyHash::operator()(const Key& k) const {
+    std::uint64_t h = (static_cast<std::uint64_t>(k.glyph) << 32) ^ k.rgb;
+    h ^= (static_cast<std::uint64_t>(k.font) << 8 | static_cast<std::uint64_t>(k.bucket & 0xFF)) * 0x9E3779B97F4A7C15ull;
+    return static_cast<std::size_t>(h ^ (h >> 29));
+}
+
+int GlyphAtlas::fontId(const QRawFont& font) {
+    const QString name = font.familyName() + QLatin1Char('|') + font.styleName() + QLatin1Char('|') +
+                         QString::number(font.weight());
+    auto it = fonts_.find(name);
+    if (it == fonts_.end()) it = fonts_.insert(name, static_cast<int>(fonts_.size()));
+    return it.value();
+}
+
+const GlyphAtlas::Glyph& GlyphAtlas::glyph(const QRawFont& font, int bucket, std::uint32_t rgb, quint32 glyphIndex) {
+    const Key key{fontId(font), bucket, rgb, glyphIndex};
+    auto it = glyphs_.find(key);
+    if (it != glyphs_.end()) {
+        Metrics::add(Metrics::Counter::GlyphHits);
+        return it->second;
+    }
+    Metrics::add(Metrics::Counter::GlyphMisses);
+
+    QRawFont sized(font);
+    sized.setPixelSize(bucketPixels(bucket));
+    const QImage alpha = sized.alphaMapForGlyph(glyphIndex, QRawFont::PixelAntialiasing);
+    Glyph g;
+    if (!alpha.isNull() && alpha.width() > 0 && alpha.height() > 0) {
+        g = place(alpha, rgb);
+        const QRectF box = sized.boundingRect(glyphIndex);
+        g.offset = QPointF(std::floor(box.left()), std::floor(box.top()));
+    }
+    return glyphs_.emplace(key, g).first->second;
+}
+
+MemoryUsage GlyphAtlas::memoryUsage() const {
+    MemoryUsage u;
+    u.addVector(pages_);
+    for (const QImage& page : pages_) {
+        const auto bytes = static_cast<std::size_t>(page.sizeInBytes());
+        u.addBlock(bytes, bytes);
+    }
+    u.addMap(glyphs_);
+    return u;
+}
+
+GlyphAtlas::Glyph GlyphAtlas::place(const QImage& alpha, std::uint32_t rgb) {
+    Glyph g;
+    const int w = alpha.width();
+    const int h = alpha.height();
+    if (w >= kPageSize || h >= kPageSize) return g;
+
+    if (shelfX_ + w + 1 > kPageSize) {
+        shelfY_ += shelfHeight_ + 1;
+        shelfX_ = 0;
+        shelfHeight_ = 0;
+    }
+    if (pages_.empty() || shelfY_ + h + 1 > kPageSize) {
+        pages_.emplace_back(kPageSize, kPageSize, QImage::Format_ARGB32_Premultiplied);
+        pages_.back().fill(Qt::transparent);
+        shelfX_ = shelfY_ = shelfHeight_ = 0;
+    }
+
+    g.page = static_cast<int>(pages_.size() - 1);
+    g.rect = QRect(shelfX_, shelfY_, w, h);
+    shelfX_ += w + 1;
+    shelfHeight_ = std::max(shelfHeight_, h);
+
+    // Tint once here so drawing is a plain premultiplied blit.
+    const std::uint32_t r = (rgb >> 16) & 0xFF, gr = (rgb >> 8) & 0xFF, b = rgb & 0xFF;
+    QImage& page = pages_.back();
+    for (int y = 0; y < h; ++y) {
+        auto* out = reinterpret_cast<QRgb*>(page.scanLine(g.rect.top() + y)) + g.rect.left();
+        for (int x = 0; x < w; ++x) {
+            std::uint32_t a;
+            switch (alpha.format()) {
+            case QImage::Format_Alpha8:
+            case QImage::Format_Grayscale8: a = alpha.constScanLine(y)[x]; break;
+            case QImage::Format_Indexed8: a = static_cast<std::uint32_t>(alpha.pixelIndex(x, y)); break;
+            default: a = static_cast<std::uint32_t>(qAlpha(alpha.pixel(x, y))); break;
+            }
+            out[x] = qRgba(static_cast<int>(r * a / 255), static_cast<int>(gr * a / 255),
+                           static_cast<int>(b * a / 255), static_cast<int>(a));
+        }
+    }
+    return g;
+}
+
+QSizeF TextRenderer::emBox(const QString& text, const QString& family) {
+    QString s = text;
+    s.replace(QLatin1Char('\n'), QChar::LineSeparator);
+    QTextLayout layout(s, layoutFont(family));
+    return shape(layout) / kLayoutPx;
+}
+
+const TextRenderer::Layout& TextRenderer::layoutFor(ElementStore::Id id, const TextElement& t) {
+    Layout& l = layouts_[id];
+    if (l.runs.empty() || l.text != t.text || l.family != t.family) {
+        QTextLayout layout(labelText(t.text), layoutFont(QString::fromStdString(t.family)));
+        shape(layout);
+        l.text = t.text;
+        l.family = t.family;
+        l.runs = layout.glyphRuns();
+    }
+    l.lastFrame = frame_;
+    return l;
+}
+
+void TextRenderer::memoryUsage(MemoryReport& report) const {
+    MemoryUsage layouts;
+    layouts.addMap(layouts_);
+    for (const auto& [id, l] : layouts_) {
+        layouts.addString(l.text);
+        layouts.addString(l.family);
+        layouts.addVector(l.runs);
+        // Glyph indexes and positions, one shared array each.
+        for (const QGlyphRun& run : l.runs) {
+            const auto glyphs = static_cast<std::size_t>(run.glyphIndexes().size());
+            layouts.addBlock(glyphs * sizeof(quint32), glyphs * sizeof(quint32));
+            layouts.addBlock(glyphs * sizeof(QPointF), glyphs * sizeof(QPointF));
+        }
+    }
+    report.add("ui.text_layouts", layouts);
+    report.add("ui.glyph_atlas", atlas_.memoryUsage());
+}
+
+void TextRenderer::sweep() {
+    if (layouts_.size() > kMaxLayouts) {
+        std::erase_if(layouts_, [this](const auto& kv) { return kv.second.lastFrame + kLayoutKeepPasses < frame_; });
+    }
+    // Labels in many colours and sizes can fill pages; start over rather than grow.
+    if (atlas_.pageCount() > kMaxAtlasPages) atlas_ = GlyphAtlas();
+}
+
+void TextRenderer::draw(QPainter& p, const Camera& cam, const QSize& size, const ElementStore& elements,
+                        const std::vector<std::uint32_t>& rows, std::size_t begin, std::size_t end) {
+    ++frame_;
+    sweep();
+
+    const auto& texts = elements.texts();
+    const QRectF view(QPointF(0.0, 0.0), QSizeF(size));
+    p.setRenderHint(QPainter::SmoothPixmapTransform, true);
+
+    for (std::size_t i = begin; i < end; ++i) {
+        const std::uint32_t row = rows[i];
+        const TextElement& t = texts[elements.slot(row)];
+        const Vec2 a = cam.screenFromWorld(t.pos.x, t.pos.y);
+        const Vec2 b = cam.screenFromWorld(t.pos.x + t.size.x, t.pos.y + t.size.y);
+        const QRectF box = QRectF(QPointF(a.x, a.y), QPointF(b.x, b.y)).normalized();
+        if (!box.intersects(view)) continue;
+
+        const double emPx = std::exp2(t.fontSizeExp + cam.zoomExp());
+        if (emPx < kMinReadablePx) {
+            if (box.width() * box.height() >= 1.0) {
+                QColor shade = colorFromRgb(t.colorRGB);
+                shade.setAlpha(80);
+                p.fillRect(box, shade);
+            }
+            continue;
+        }
+
+        const Layout& layout = layoutFor(elements.id(row), t);
+        const double scale = emPx / kLayoutPx;
+        const QPointF origin(a.x, a.y);
+
+        if (emPx > kMaxAtlasPx) {
+            p.save();
+            p.translate(origin);
+            p.scale(scale, scale);
+            p.setPen(colorFromRgb(t.colorRGB));
+            for (const QGlyphRun& run : layout.runs) p.drawGlyphRun(QPointF(0.0, 0.0), run);
+            p.restore();
+            continue;
+        }
+
+        const int bucket = GlyphAtlas::bucketFor(emPx);
+        const double k = emPx / GlyphAtlas::bucketPixels(bucket);
+        for (const QGlyphRun& run : layout.runs) {
+            const QRawFont font = run.rawFont();
+            const QList<quint32> glyphs = run.glyphIndexes();
+            const QList<QPointF> positions = run.positions();
+            for (qsizetype g = 0; g < glyphs.size(); ++g) {
+                const GlyphAtlas::Glyph& glyph = atlas_.glyph(font, bucket, t.colorRGB, glyphs[g]);
+                if (glyph.page < 0) continue;
+                const QPointF pen = origin + positions[g] * scale;
+                const QRectF dest(pen + glyph.offset * k, QSizeF(glyph.rect.size()) * k);
+                if (dest.intersects(view)) p.drawImage(dest, atlas_.page(glyph.page), glyph.rect);
+            }
+        }
+    }
+}
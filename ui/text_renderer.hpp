@@ -0,0 +1,93 @@
+#pragma once
+#include <QGlyphRun>
+#include <QHash>
+#include <QImage>
+#include <QRawFont>
+#include <QRect>
+#include <QSizeF>
+#include <QString>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "../core/camera.hpp"
+#include "../core/element_store.hpp"
+#include "../core/memory_usage.hpp"
+
+class QPainter;
+
+// Glyph bitmaps shared by every label: one rasterization per (font, size
+// bucket, colour, glyph), shelf-packed into a few large pages so a frame
+// full of labels blits from the same images instead of shaping and
+// rasterizing each string.
+class GlyphAtlas {
+public:
+    struct Glyph {
+        int page = -1;     // -1: blank glyph (space), nothing to draw
+        QRect rect;        // in the page
+        QPointF offset;    // bitmap top-left relative to the pen, in bucket pixels
+    };
+
+    static constexpr int kPageSize = 1024;
+
+    // Bucket sizes step by a quarter octave, so a glyph is never scaled by
+    // more than ~9% when blitted.
+    static int bucketFor(double pixelSize);
+    static double bucketPixels(int bucket);
+
+    const Glyph& glyph(const QRawFont& font, int bucket, std::uint32_t rgb, quint32 glyphIndex);
+    const QImage& page(int index) const { return pages_[static_cast<std::size_t>(index)]; }
+    std::size_t pageCount() const { return pages_.size(); }
+    MemoryUsage memoryUsage() const;
+
+private:
+    struct Key {
+        int font;
+        int bucket;
+        std::uint32_t rgb;
+        quint32 glyph;
+        bool operator==(const Key&) const = default;
+    };
+    struct KeyHash {
+        std::size_t operator()(const Key& k) const;
+    };
+
+    int fontId(const QRawFont& font);
+    Glyph place(const QImage& alpha, std::uint32_t rgb);
+
+    std::vector<QImage> pages_;
+    int shelfX_ = 0;
+    int shelfY_ = 0;
+    int shelfHeight_ = 0;
+    std::unordered_map<Key, Glyph, KeyHash> glyphs_;
+    QHash<QString, int> fonts_;
+};
+
+// Draws text elements. Each label is shaped once into glyph runs at a
+// reference size and cached by element id; drawing scales the cached
+// positions and blits glyphs from the atlas. Labels too small to read are
+// drawn as boxes, very large ones straight from the font outlines.
+class TextRenderer {
+public:
+    // Layout box of text per unit of em size, for sizing new labels.
+    static QSizeF emBox(const QString& text, const QString& family);
+
+    void draw(QPainter& p, const Camera& cam, const QSize& size, const ElementStore& elements,
+              const std::vector<std::uint32_t>& rows, std::size_t begin, std::size_t end);
+    // Adds "ui.text_layouts" and "ui.glyph_atlas".
+    void memoryUsage(MemoryReport& report) const;
+
+private:
+    struct Layout {
+        std::string text; // what was shaped, to catch reused ids
+        std::string family;
+        std::vector<QGlyphRun> runs; // positions in reference pixels
+        std::uint64_t lastFrame = 0;
+    };
+
+    const Layout& layoutFor(ElementStore::Id id, const TextElement& t);
+    void sweep();
+
+    std::unordered_map<ElementStore::Id, Layout> layouts_;
+    GlyphAtlas atlas_;
+    std::uint64_t frame_ = 0;
+};
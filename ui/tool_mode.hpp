@@ -6,7 +6,9 @@ namespace ui {
 enum class Mode {
     Pan = 0,   // на будущее — перетаскивание
     Draw = 1,  // рисование пером
-    Select = 2 // на будущее — выделение
+    Select = 2, // на будущее — выделение
+    Text = 3,   // подписи: клик ставит текст
+    Eraser = 4  // стирает части штрихов под курсором
 };
 
 } // namespace ui
@@ -0,0 +1,242 @@
+#include "vector_import.hpp"
+
+#include <QColor>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QXmlStreamReader>
+#include <algorithm>
+#include <cmath>
+
+#include "../core/scene.hpp"
+#include "../core/svg_path.hpp"
+
+namespace {
+// Curves are flattened to this error in SVG user units (pixels, usually).
+constexpr double kSvgFlattenTolerance = 0.1;
+// Imported content fills this share of the target rectangle.
+constexpr double kFitMargin = 0.9;
+
+struct SvgStyle {
+    double width = 0.0;
+    std::uint32_t colorRGB = 0;
+    bool hasColor = false;
+    std::uint32_t fillRGB = 0;
+    bool filled = false;
+};
+
+void applyStyleProperty(SvgStyle& style, QStringView name, QStringView value) {
+    value = value.trimmed();
+    if (name == u"stroke") {
+        const QColor c = QColor::fromString(value);
+        if (c.isValid()) {
+            style.colorRGB = static_cast<std::uint32_t>(c.rgb() & 0xFFFFFF);
+            style.hasColor = true;
+        }
+    } else if (name == u"fill") {
+        const QColor c = value == u"none" ? QColor() : QColor::fromString(value);
+        style.filled = c.isValid();
+        if (style.filled) style.fillRGB = static_cast<std::uint32_t>(c.rgb() & 0xFFFFFF);
+    } else if (name == u"stroke-width") {
+        bool ok = false;
+        QStringView number = value;
+        if (number.endsWith(u"px")) number.chop(2);
+        const double w = number.toDouble(&ok);
+        if (ok && w > 0.0) style.width = w;
+    }
+}
+
+SvgStyle styleFor(const QXmlStreamAttributes& attrs, SvgStyle style) {
+    applyStyleProperty(style, u"stroke", attrs.value(u"stroke"));
+    applyStyleProperty(style, u"stroke-width", attrs.value(u"stroke-width"));
+    if (attrs.hasAttribute(u"fill")) applyStyleProperty(style, u"fill", attrs.value(u"fill"));
+    const QStringView css = attrs.value(u"style");
+    for (QStringView decl : css.split(u';')) {
+        const auto colon = decl.indexOf(u':');
+        if (colon < 0) continue;
+        applyStyleProperty(style, decl.left(colon).trimmed(), decl.mid(colon + 1));
+    }
+    return style;
+}
+
+void addPath(std::vector<ImportedPath>& out, std::vector<Vec2>&& pts, const SvgStyle& style) {
+    if (pts.size() < 2) return;
+    out.push_back(ImportedPath{std::move(pts), style.width, style.colorRGB, style.hasColor});
+}
+
+void addShape(std::vector<ImportedShape>* out, Shape::Kind kind, double x, double y, double w, double h,
+              const SvgStyle& style) {
+    if (!out || !(w > 0.0 && h > 0.0)) return;
+    ImportedShape s;
+    s.shape.kind = kind;
+    s.shape.pos = {x, y};
+    s.shape.size = {w, h};
+    s.style.width = style.width;
+    s.style.colorRGB = style.colorRGB;
+    s.style.hasColor = style.hasColor;
+    s.fillRGB = style.fillRGB;
+    s.filled = style.filled;
+    out->push_back(s);
+}
+
+void collectGeometry(const QJsonObject& obj, std::vector<ImportedPath>& out);
+
+std::vector<Vec2> readLine(const QJsonArray& coords) {
+    std::vector<Vec2> pts;
+    pts.reserve(static_cast<std::size_t>(coords.size()));
+    for (const QJsonValue& c : coords) {
+        const QJsonArray pos = c.toArray();
+        if (pos.size() < 2) continue;
+        pts.push_back({pos[0].toDouble(), -pos[1].toDouble()});
+    }
+    return pts;
+}
+
+void addLines(const QJsonArray& lines, std::vector<ImportedPath>& out) {
+    for (const QJsonValue& line : lines) {
+        std::vector<Vec2> pts = readLine(line.toArray());
+        if (pts.size() >= 2) out.push_back(ImportedPath{std::move(pts)});
+    }
+}
+
+void collectGeometry(const QJsonObject& obj, std::vector<ImportedPath>& out) {
+    const QString type = obj.value(QStringLiteral("type")).toString();
+    const QJsonArray coords = obj.value(QStringLiteral("coordinates")).toArray();
+    if (type == QStringLiteral("FeatureCollection")) {
+        for (const QJsonValue& f : obj.value(QStringLiteral("features")).toArray()) collectGeometry(f.toObject(), out);
+    } else if (type == QStringLiteral("Feature")) {
+        collectGeometry(obj.value(QStringLiteral("geometry")).toObject(), out);
+    } else if (type == QStringLiteral("GeometryCollection")) {
+        for (const QJsonValue& g : obj.value(QStringLiteral("geometries")).toArray()) collectGeometry(g.toObject(), out);
+    } else if (type == QStringLiteral("LineString")) {
+        addLines(QJsonArray{coords}, out);
+    } else if (type == QStringLiteral("MultiLineString") || type == QStringLiteral("Polygon")) {
+        addLines(coords, out);
+    } else if (type == QStringLiteral("MultiPolygon")) {
+        for (const QJsonValue& polygon : coords) addLines(polygon.toArray(), out);
+    }
+}
+}
+
+bool readSvgPaths(const QString& path, std::vector<ImportedPath>& out, QString* error,
+                  std::vector<ImportedShape>* shapes) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    QXmlStreamReader xml(&file);
+    std::vector<SvgStyle> styles{SvgStyle{}};
+    std::vector<std::vector<Vec2>> subpaths;
+    while (!xml.atEnd()) {
+        const auto token = xml.readNext();
+        if (token == QXmlStreamReader::EndElement) {
+            if (styles.size() > 1) styles.pop_back();
+            continue;
+        }
+        if (token != QXmlStreamReader::StartElement) continue;
+
+        const QXmlStreamAttributes attrs = xml.attributes();
+        const SvgStyle style = styleFor(attrs, styles.back());
+        styles.push_back(style);
+
+        const QStringView name = xml.name();
+        if (name == u"path") {
+            subpaths.clear();
+            const QByteArray d = attrs.value(u"d").toLatin1();
+            flattenSvgPath(std::string_view(d.constData(), static_cast<std::size_t>(d.size())),
+                           kSvgFlattenTolerance, subpaths);
+            for (auto& pts : subpaths) addPath(out, std::move(pts), style);
+        } else if (name == u"polyline" || name == u"polygon") {
+            std::vector<Vec2> pts;
+            const QByteArray text = attrs.value(u"points").toLatin1();
+            parseSvgPoints(std::string_view(text.constData(), static_cast<std::size_t>(text.size())), pts);
+            if (name == u"polygon" && pts.size() > 2) pts.push_back(pts.front());
+            addPath(out, std::move(pts), style);
+        } else if (name == u"rect") {
+            addShape(shapes, Shape::Kind::Rect, attrs.value(u"x").toDouble(), attrs.value(u"y").toDouble(),
+                     attrs.value(u"width").toDouble(), attrs.value(u"height").toDouble(), style);
+        } else if (name == u"circle" || name == u"ellipse") {
+            const double rx = attrs.value(name == u"circle" ? u"r" : u"rx").toDouble();
+            const double ry = attrs.value(name == u"circle" ? u"r" : u"ry").toDouble();
+            addShape(shapes, Shape::Kind::Ellipse, attrs.value(u"cx").toDouble() - rx,
+                     attrs.value(u"cy").toDouble() - ry, 2.0 * rx, 2.0 * ry, style);
+        } else if (name == u"line") {
+            addPath(out, {{attrs.value(u"x1").toDouble(), attrs.value(u"y1").toDouble()},
+                          {attrs.value(u"x2").toDouble(), attrs.value(u"y2").toDouble()}}, style);
+        }
+    }
+    if (xml.hasError()) {
+        if (error) *error = xml.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool readGeoJsonLines(const QString& path, std::vector<ImportedPath>& out, QString* error) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (doc.isNull()) {
+        if (error) *error = parseError.errorString();
+        return false;
+    }
+    collectGeometry(doc.object(), out);
+    return true;
+}
+
+std::size_t importVectorFile(const QString& path, Scene& scene, const Rect& worldRect,
+                             double defaultWidthExp, std::uint32_t defaultColorRGB, QString* error) {
+    std::vector<ImportedPath> paths;
+    std::vector<ImportedShape> shapes;
+    const bool ok = path.endsWith(QStringLiteral(".svg"), Qt::CaseInsensitive)
+        ? readSvgPaths(path, paths, error, &shapes)
+        : readGeoJsonLines(path, paths, error);
+    if (!ok || (paths.empty() && shapes.empty()) || worldRect.empty()) return 0;
+
+    Rect source;
+    for (const ImportedPath& p : paths) {
+        for (const Vec2& v : p.points) source.expand(v);
+    }
+    for (const ImportedShape& s : shapes) source.expand(s.shape.bounds());
+    const double extent = std::max(source.width(), source.height());
+    const double scale = extent > 0.0
+        ? kFitMargin * std::min(worldRect.width() / std::max(source.width(), extent * 1e-9),
+                                worldRect.height() / std::max(source.height(), extent * 1e-9))
+        : 1.0;
+    const Vec2 from = source.center();
+    const Vec2 to = worldRect.center();
+
+    std::vector<StrokeData> data;
+    data.reserve(paths.size());
+    for (ImportedPath& p : paths) {
+        for (Vec2& v : p.points) {
+            v = {(v.x - from.x) * scale + to.x, (v.y - from.y) * scale + to.y};
+        }
+        StrokeData d;
+        d.widthExp = p.width > 0.0 ? std::log2(p.width * scale) : defaultWidthExp;
+        d.colorRGB = p.hasColor ? p.colorRGB : defaultColorRGB;
+        d.points = std::move(p.points);
+        data.push_back(std::move(d));
+    }
+    const std::size_t before = scene.strokes().size();
+    scene.addStrokes(std::move(data));
+
+    for (ImportedShape& s : shapes) {
+        s.shape.pos = {(s.shape.pos.x - from.x) * scale + to.x, (s.shape.pos.y - from.y) * scale + to.y};
+        s.shape.size = {s.shape.size.x * scale, s.shape.size.y * scale};
+        ElementStyle style;
+        style.strokeWidthExp = s.style.width > 0.0 ? std::log2(s.style.width * scale) : defaultWidthExp;
+        style.strokeRGB = s.style.hasColor ? s.style.colorRGB : defaultColorRGB;
+        style.fillRGB = s.fillRGB;
+        style.filled = s.filled;
+        scene.addShape(s.shape, style);
+    }
+    return scene.strokes().size() - before + shapes.size();
+}
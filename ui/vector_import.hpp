@@ -0,0 +1,40 @@
+#pragma once
+#include <QString>
+#include <cstdint>
+#include <vector>
+#include "../core/elements/element.hpp"
+
+class Scene;
+
+// A polyline read from a vector file, in the file's own units.
+struct ImportedPath {
+    std::vector<Vec2> points;
+    double width = 0.0;        // 0 = not specified
+    std::uint32_t colorRGB = 0;
+    bool hasColor = false;
+};
+
+// A <rect>, <circle> or <ellipse>, in the file's own units.
+struct ImportedShape {
+    Shape shape;
+    ImportedPath style; // width and colours only, no points
+    std::uint32_t fillRGB = 0;
+    bool filled = false;
+};
+
+// <path>, <polyline>, <polygon> and <line> elements as paths, <rect>,
+// <circle> and <ellipse> as shapes; stroke, stroke-width and fill are taken
+// from attributes or style, inherited through <g>. Transforms are not applied.
+bool readSvgPaths(const QString& path, std::vector<ImportedPath>& out, QString* error = nullptr,
+                  std::vector<ImportedShape>* shapes = nullptr);
+// LineString, MultiLineString, Polygon and MultiPolygon geometries, at any
+// depth of Feature/FeatureCollection/GeometryCollection. Longitude maps to
+// x and latitude to -y, so north stays up.
+bool readGeoJsonLines(const QString& path, std::vector<ImportedPath>& out, QString* error = nullptr);
+
+// Reads an .svg or (Geo)JSON file, fits it into worldRect and adds it
+// through Scene::addStrokes. Paths without their own width or colour get
+// the defaults. Returns the number of strokes and shapes added.
+std::size_t importVectorFile(const QString& path, Scene& scene, const Rect& worldRect,
+                             double defaultWidthExp, std::uint32_t defaultColorRGB,
+                             QString* error = nullptr);